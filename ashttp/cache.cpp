@@ -0,0 +1,440 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cache.hpp"
+
+#include "diskcache.hpp"
+#include "header.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace ashttp {
+
+namespace {
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+/**
+ * @brief parseSeconds Parses a delta-seconds value; a value too large to represent is taken as the largest.
+ */
+boost::optional<std::int64_t> parseSeconds(boost::string_view value) {
+  if (value.empty())
+    return boost::none;
+
+  std::int64_t seconds = 0;
+
+  for (const auto c : value) {
+    if (!isDigit(c))
+      return boost::none;
+
+    seconds = std::min<std::int64_t>(seconds * 10 + (c - '0'), std::numeric_limits<std::int32_t>::max());
+  }
+
+  return seconds;
+}
+
+bool equalsLower(boost::string_view value, const char* lowerKey) {
+  const auto size = std::strlen(lowerKey);
+
+  return value.size() == size && scan::equalsLower(value.data(), lowerKey, size);
+}
+
+/**
+ * @brief forEachDirective Calls \p f with the name and the (unquoted) value of each directive of a
+ *cache-control field.
+ */
+template <class F>
+void forEachDirective(boost::string_view field, F&& f) {
+  while (!field.empty()) {
+    auto end = field.find(',');
+    auto directive = field.substr(0, end);
+
+    field.remove_prefix(end == boost::string_view::npos ? field.size() : end + 1);
+
+    while (!directive.empty() && (directive.front() == ' ' || directive.front() == '\t'))
+      directive.remove_prefix(1);
+
+    while (!directive.empty() && (directive.back() == ' ' || directive.back() == '\t'))
+      directive.remove_suffix(1);
+
+    const auto equals = directive.find('=');
+    auto value = equals == boost::string_view::npos ? boost::string_view{} : directive.substr(equals + 1);
+
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+      value = value.substr(1, value.size() - 2);
+
+    f(directive.substr(0, equals), value);
+  }
+}
+
+bool storableStatus(unsigned status) {
+  switch (status) {
+  case 200:
+  case 203:
+  case 204:
+  case 300:
+  case 301:
+  case 308:
+  case 404:
+  case 410:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+}
+
+Cache::Cache(std::size_t capacity)
+    : m_capacity{capacity}
+    , m_size{0}
+    , m_hits{0}
+    , m_misses{0}
+    , m_stale{0}
+    , m_notModified{0}
+    , m_stores{0}
+    , m_evictions{0} { }
+
+void Cache::disk(std::shared_ptr<DiskCache> disk) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  m_disk = std::move(disk);
+}
+
+std::shared_ptr<DiskCache> Cache::disk() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return m_disk;
+}
+
+std::size_t Cache::maxEntrySize() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return m_disk ? std::max(m_capacity, m_disk->options().segmentSize) : m_capacity;
+}
+
+Cache::Lookup Cache::find(const std::string& key, bool encoded, std::shared_ptr<const Entry>& entry) {
+  std::unique_lock<std::mutex> l{m_mutex};
+
+  const auto it = m_entries.find(key);
+
+  entry = nullptr;
+
+  if (it != m_entries.end()) {
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+    entry = it->second->second;
+  } else if (const auto disk = m_disk) { // the disk tier is called without the lock
+    l.unlock();
+    entry = disk->find(key);
+    l.lock();
+  }
+
+  if (entry && entry->encoded && !encoded) // not served, it is fetched and stored again
+    entry = nullptr;
+
+  if (!entry) {
+    ++m_misses;
+
+    return Lookup::Miss;
+  }
+
+  if (entry->fresh(Clock::now())) {
+    ++m_hits;
+
+    return Lookup::Fresh;
+  }
+
+  ++m_stale;
+
+  return Lookup::Stale;
+}
+
+std::shared_ptr<Cache::Entry> Cache::entryFor(const Header& header) {
+  if (!storableStatus(header.status()))
+    return nullptr;
+
+  const auto vary = header.field(FieldId::Vary);
+
+  if (vary && vary->find('*') != boost::string_view::npos) // varies on more than the request
+    return nullptr;
+
+  auto entry = std::make_shared<Entry>();
+
+  if (!freshness(header, *entry))
+    return nullptr;
+
+  if (const auto etag = header.field(FieldId::ETag))
+    entry->etag = etag->to_string();
+
+  if (const auto lastModified = header.field(FieldId::LastModified))
+    entry->lastModified = lastModified->to_string();
+
+  if (entry->lifetime == Clock::duration::zero() && !entry->revalidatable()) // would never be used
+    return nullptr;
+
+  const auto encoding = header.field(FieldId::ContentEncoding);
+
+  entry->encoded = encoding && !encoding->empty() && !equalsLower(*encoding, "identity");
+
+  // the framing is given again when the entry is served
+  entry->header.reserve(header.field().size() + header.statusLine().size() + 2);
+  entry->header.append(header.statusLine().data(), header.statusLine().size()).append("\r\n");
+
+  for (std::size_t i = 0; i < header.fieldCount(); ++i) {
+    const auto field = header.fieldAt(i);
+
+    switch (fieldId(field.first.data(), field.first.size())) {
+    case FieldId::Age:
+    case FieldId::Connection:
+    case FieldId::ContentLength:
+    case FieldId::KeepAlive:
+    case FieldId::Trailer:
+    case FieldId::TransferEncoding:
+    case FieldId::Upgrade:
+      break;
+
+    default:
+      entry->header.append(field.first.data(), field.first.size())
+          .append(": ")
+          .append(field.second.data(), field.second.size())
+          .append("\r\n");
+    }
+  }
+
+  return entry;
+}
+
+void Cache::store(const std::string& key, std::shared_ptr<const Entry> entry) {
+  if (const auto disk = this->disk())
+    disk->store(key, entry);
+
+  storeMemory(key, std::move(entry));
+}
+
+void Cache::storeMemory(const std::string& key, std::shared_ptr<const Entry> entry) {
+  if (key.size() + entry->size() > m_capacity)
+    return;
+
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  const auto it = m_entries.find(key);
+
+  if (it != m_entries.end()) {
+    m_size -= key.size() + it->second->second->size();
+
+    it->second->second = std::move(entry);
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+  } else {
+    m_lru.emplace_front(key, std::move(entry));
+    m_entries.emplace(key, m_lru.begin());
+  }
+
+  m_size += key.size() + m_lru.front().second->size();
+  ++m_stores;
+
+  evict();
+}
+
+std::shared_ptr<const Cache::Entry> Cache::revalidated(const std::string& key, const std::shared_ptr<const Entry>& entry,
+                                                       const Header& notModified) {
+  auto refreshed = std::make_shared<Entry>(*entry);
+
+  refreshed->storedAt = Clock::now();
+
+  if (notModified.field(FieldId::CacheControl) || notModified.field(FieldId::Expires)) {
+    if (!freshness(notModified, *refreshed)) { // no-store now
+      erase(key);
+
+      return refreshed;
+    }
+  } else { // the same lifetime again
+    refreshed->initialAge = Clock::duration::zero();
+
+    if (const auto age = notModified.field(FieldId::Age)) {
+      if (const auto seconds = parseSeconds(*age))
+        refreshed->initialAge = std::chrono::seconds{*seconds};
+    }
+  }
+
+  if (const auto etag = notModified.field(FieldId::ETag))
+    refreshed->etag = etag->to_string();
+
+  if (const auto lastModified = notModified.field(FieldId::LastModified))
+    refreshed->lastModified = lastModified->to_string();
+
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    ++m_notModified;
+  }
+
+  if (const auto disk = this->disk())
+    disk->refresh(key, *refreshed);
+
+  storeMemory(key, refreshed);
+
+  return refreshed;
+}
+
+void Cache::erase(const std::string& key) {
+  if (const auto disk = this->disk())
+    disk->erase(key);
+
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  const auto it = m_entries.find(key);
+
+  if (it != m_entries.end()) {
+    m_size -= key.size() + it->second->second->size();
+
+    m_lru.erase(it->second);
+    m_entries.erase(it);
+  }
+}
+
+void Cache::clear() {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  m_lru.clear();
+  m_entries.clear();
+  m_size = 0;
+}
+
+Cache::Stats Cache::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return Stats{m_hits, m_misses, m_stale, m_notModified, m_stores, m_evictions, m_entries.size(), m_size, m_capacity};
+}
+
+boost::optional<std::time_t> Cache::parseDate(boost::string_view date) {
+  // IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+  static const char* const Months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+  if (date.size() != 29 || date[3] != ',' || date[4] != ' ' || date[7] != ' ' || date[11] != ' ' || date[16] != ' ' ||
+      date[19] != ':' || date[22] != ':' || date.substr(25) != " GMT")
+    return boost::none;
+
+  const auto number = [&date](std::size_t begin, std::size_t size) -> int {
+    int value = 0;
+
+    for (auto i = begin; i < begin + size; ++i) {
+      if (!isDigit(date[i]))
+        return -1;
+
+      value = value * 10 + (date[i] - '0');
+    }
+
+    return value;
+  };
+
+  std::tm tm{};
+
+  const auto month = std::search(Months, Months + 36, date.data() + 8, date.data() + 11) - Months;
+
+  tm.tm_mday = number(5, 2);
+  tm.tm_mon = static_cast<int>(month / 3);
+  tm.tm_year = number(12, 4) - 1900;
+  tm.tm_hour = number(17, 2);
+  tm.tm_min = number(20, 2);
+  tm.tm_sec = number(23, 2);
+
+  if (month % 3 != 0 || month >= 36 || tm.tm_mday < 1 || tm.tm_mday > 31 || tm.tm_year < 0 || tm.tm_hour < 0 ||
+      tm.tm_hour > 23 || tm.tm_min < 0 || tm.tm_min > 59 || tm.tm_sec < 0 || tm.tm_sec > 60)
+    return boost::none;
+
+  return timegm(&tm);
+}
+
+bool Cache::freshness(const Header& header, Entry& entry) {
+  bool noCache = false;
+  bool hasMaxAge = false;
+  std::int64_t maxAge = 0;
+
+  if (const auto cacheControl = header.field(FieldId::CacheControl)) {
+    bool noStore = false;
+
+    forEachDirective(*cacheControl, [&](boost::string_view name, boost::string_view value) {
+      if (equalsLower(name, "no-store"))
+        noStore = true;
+      else if (equalsLower(name, "no-cache"))
+        noCache = true;
+      else if (equalsLower(name, "max-age")) {
+        hasMaxAge = true;
+        maxAge = parseSeconds(value).value_or(0);
+      }
+    });
+
+    if (noStore)
+      return false;
+  } else if (const auto pragma = header.field(FieldId::Pragma)) {
+    noCache = equalsLower(*pragma, "no-cache");
+  }
+
+  entry.storedAt = Clock::now();
+  entry.initialAge = Clock::duration::zero();
+  entry.lifetime = Clock::duration::zero();
+
+  if (const auto age = header.field(FieldId::Age)) {
+    if (const auto seconds = parseSeconds(*age))
+      entry.initialAge = std::chrono::seconds{*seconds};
+  }
+
+  if (noCache) // stored, but revalidated every time
+    return true;
+
+  if (hasMaxAge) {
+    entry.lifetime = std::chrono::seconds{maxAge};
+  } else if (const auto expiresField = header.field(FieldId::Expires)) {
+    // an invalid date means already expired
+    if (const auto expires = parseDate(*expiresField)) {
+      const auto dateField = header.field(FieldId::Date);
+      const auto date = dateField ? parseDate(*dateField) : boost::none;
+      const auto lifetime = *expires - date.value_or(std::time(nullptr));
+
+      if (lifetime > 0)
+        entry.lifetime = std::chrono::seconds{lifetime};
+    }
+  }
+
+  return true;
+}
+
+void Cache::evict() {
+  while (m_size > m_capacity && !m_lru.empty()) {
+    const auto& last = m_lru.back();
+
+    m_size -= last.first.size() + last.second->size();
+    ++m_evictions;
+
+    m_entries.erase(last.first);
+    m_lru.pop_back();
+  }
+}
+
+}
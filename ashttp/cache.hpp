@@ -0,0 +1,213 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ashttp {
+
+class DiskCache;
+class Header;
+
+/**
+ * @brief Cache Keeps responses in memory to serve the following requests of the same resource.
+ *
+ * A private cache after RFC 9111: a response is stored if its status is cacheable, it has no
+ *"cache-control: no-store" and it is either fresh for a while (max-age or expires) or it can be revalidated
+ *(etag or last-modified). A stale entry is revalidated with if-none-match / if-modified-since and its body is
+ *reused if the server answers 304.
+ *
+ * The bodies are stored as framed by the server but before any content coding is decoded. The least recently
+ *used entries are evicted to stay below the capacity.
+ *
+ * With a DiskCache the responses are also written to the disk, and looked up there when they are not in
+ *memory; a response found on the disk is served from its mapping and is not brought into memory.
+ *
+ * Thread-safe; one cache may be shared by several clients.
+ */
+class Cache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    std::string header; // the status line and the fields, without the framing fields and the empty line
+    boost::string_view body;
+    std::shared_ptr<const void> bodyOwner; // keeps the memory of body
+
+    Clock::time_point storedAt; // when the entry was received or revalidated
+    Clock::duration initialAge; // the age the response already had then
+    Clock::duration lifetime;   // fresh until its age reaches this
+
+    std::string etag;
+    std::string lastModified;
+    bool encoded; // has a content-encoding
+
+    /**
+     * @brief age
+     * @return The current age of the response, as sent in the age field when it is served.
+     */
+    Clock::duration age(Clock::time_point now) const { return initialAge + (now - storedAt); }
+
+    bool fresh(Clock::time_point now) const { return age(now) < lifetime; }
+
+    bool revalidatable() const { return !etag.empty() || !lastModified.empty(); }
+
+    std::size_t size() const { return header.size() + body.size(); }
+  };
+
+  struct Stats {
+    std::uint64_t hits;        // served while fresh
+    std::uint64_t misses;      // not found
+    std::uint64_t stale;       // found stale, revalidated
+    std::uint64_t notModified; // revalidated with 304, the body was reused
+    std::uint64_t stores;
+    std::uint64_t evictions;
+    std::size_t entries;
+    std::size_t size;
+    std::size_t capacity;
+  };
+
+  enum class Lookup {
+    Miss,
+    Fresh,
+    Stale
+  };
+
+public:
+  /**
+   * @brief Cache
+   * @param capacity The most bytes of headers and bodies to keep.
+   */
+  explicit Cache(std::size_t capacity = 64 * 1024 * 1024);
+
+  Cache(const Cache&) = delete;
+  Cache& operator=(const Cache&) = delete;
+
+  std::size_t capacity() const { return m_capacity; }
+
+  /**
+   * @brief disk Sets the disk tier, nullptr for none.
+   */
+  void disk(std::shared_ptr<DiskCache> disk);
+
+  std::shared_ptr<DiskCache> disk() const;
+
+  /**
+   * @brief maxEntrySize
+   * @return The size of the largest response that can be stored in either tier.
+   */
+  std::size_t maxEntrySize() const;
+
+  /**
+   * @brief find Looks an entry up, and counts it as a hit, a miss or a stale entry.
+   * @param key
+   * @param encoded Whether an entry with a content-encoding can be served; one that can not is a miss.
+   * @param entry Set to the entry if found.
+   * @return
+   */
+  Lookup find(const std::string& key, bool encoded, std::shared_ptr<const Entry>& entry);
+
+  /**
+   * @brief entryFor Makes an entry for a response, to be filled with the body and stored.
+   * @param header
+   * @return nullptr if the response may not be stored.
+   */
+  static std::shared_ptr<Entry> entryFor(const Header& header);
+
+  /**
+   * @brief store Stores \p entry with \p key, replacing the one that is there.
+   */
+  void store(const std::string& key, std::shared_ptr<const Entry> entry);
+
+  /**
+   * @brief revalidated Refreshes \p entry with the header of a 304 response.
+   * @return The refreshed entry, which replaces \p entry.
+   */
+  std::shared_ptr<const Entry> revalidated(const std::string& key, const std::shared_ptr<const Entry>& entry,
+                                           const Header& notModified);
+
+  void erase(const std::string& key);
+
+  /**
+   * @brief clear Removes all the entries from memory, the disk tier is kept.
+   */
+  void clear();
+
+  Stats stats() const;
+
+  /**
+   * @brief parseDate Parses an HTTP date in the preferred format, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+   * @return The time, empty if the date is not valid.
+   */
+  static boost::optional<std::time_t> parseDate(boost::string_view date);
+
+private:
+  using Lru = std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+  /**
+   * @brief freshness Sets the lifetime and the initial age of \p entry from the fields of \p header.
+   * @return false if the response must not be stored.
+   */
+  static bool freshness(const Header& header, Entry& entry);
+
+  /**
+   * @brief storeMemory Stores \p entry in memory only.
+   */
+  void storeMemory(const std::string& key, std::shared_ptr<const Entry> entry);
+
+  /**
+   * @brief evict Evicts the least recently used entries until the size is within the capacity.
+   */
+  void evict();
+
+private:
+  const std::size_t m_capacity;
+
+  mutable std::mutex m_mutex;
+  std::shared_ptr<DiskCache> m_disk;
+  Lru m_lru; // the most recently used first
+  std::unordered_map<std::string, Lru::iterator> m_entries;
+  std::size_t m_size;
+
+  std::uint64_t m_hits;
+  std::uint64_t m_misses;
+  std::uint64_t m_stale;
+  std::uint64_t m_notModified;
+  std::uint64_t m_stores;
+  std::uint64_t m_evictions;
+};
+
+}
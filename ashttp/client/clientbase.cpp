@@ -26,11 +26,11 @@
 #include "client.hpp"
 #include "request.hpp"
 
+#include <algorithm>
+
 namespace ashttp {
 namespace client {
 
-using namespace std::placeholders;
-
 template <Protocol p>
 ClientCRTPBase<p>::ClientCRTPBase(std::string host, std::string service, asio::io_service& is, Millisec resolveTimeout)
     : m_is{is}
@@ -38,7 +38,15 @@ ClientCRTPBase<p>::ClientCRTPBase(std::string host, std::string service, asio::i
     , m_resolver{m_is}
     , m_service{std::move(service)}
     , m_resolveTimeout{std::move(resolveTimeout)}
-    , m_resolveTimer{m_is} {
+    , m_resolveTimer{m_is}
+    , m_memoryBudget{std::make_shared<MemoryBudget>()}
+    , m_decompress{false}
+    , m_coalesce{false}
+    , m_balancer{std::make_shared<EndpointBalancer>()}
+    , m_outstanding{false}
+    , m_connected{false}
+    , m_metrics{Metrics::global()}
+    , m_hostMetrics{m_metrics->host(m_host)} {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>";
 }
 
@@ -55,27 +63,74 @@ ClientCRTPBase<p>::~ClientCRTPBase() {
   // note that this does not guarantee that all the requests are destructed,
   // it will skip the active requests and let them handle themselves
 
+  clearRequestQueue(error::canceled);
+
   std::lock_guard<std::mutex> l{m_requestQueueMtx};
 
-  clearRequestQueue(error::canceled);
+  // the active request outlived the client
+  if (m_slot)
+    m_slot->release(ConcurrencyLimiter::Clock::now(), ConcurrencyLimiter::Outcome::Ignored);
+
+  if (m_outstanding)
+    m_balancer->finished(m_endpoint, EndpointBalancer::Outcome::Ignored);
 }
 
 template <Protocol p>
-void ClientCRTPBase<p>::connect(ConnectCallback callback) {
+void ClientCRTPBase<p>::connect(InplaceCallback<ConnectCallback> callback) {
+  m_timing = Timing{};
+
   auto onResolve = [ self = static_cast<ClientImpl<p>*>(this)->shared_from_this(), callback = std::move(callback) ](
-      const ErrorCode& ec, const tcp::resolver::iterator& it) {
+      const ErrorCode& ec, const tcp::resolver::iterator& it) mutable {
     TEMPLOG_DEVLOG(templog::sev_debug) << self.get() << " ClientCRTPBase<p>::connect onResolve ec: " << ec;
 
-    if (!ec) {
-      auto& connection = self->connection();
+    if (ec) {
+      self->onConnect_(ec, std::move(callback));
+
+      return;
+    }
+
+    if (self->connection().socket().lowest_layer().is_open()) { // already connected
+      callback(error::success);
 
-      connection.connect(it, std::bind(&ClientImpl<p>::onConnect_, self.get(), _1, std::move(callback)));
-    } else {
-      self->connectCompleted(ec);
+      return;
     }
+
+    self->m_candidates = self->m_balancer->candidates();
+
+    if (self->m_candidates.empty()) // no address of this resolution is known to the balancer
+      self->m_candidates.assign(it, tcp::resolver::iterator{});
+
+    if (self->m_candidates.size() > 1 && self->m_candidates.front() == self->m_avoid)
+      std::rotate(self->m_candidates.begin(), self->m_candidates.begin() + 1, self->m_candidates.end());
+
+    self->connectTo_(0, std::move(callback));
   };
 
-  resolve(onResolve);
+  resolve(std::move(onResolve));
+}
+
+template <Protocol p>
+void ClientCRTPBase<p>::connectTo_(std::size_t candidate, InplaceCallback<ConnectCallback> callback) {
+  auto& connection = static_cast<ClientImpl<p>*>(this)->connection();
+
+  connection.connect(m_candidates[candidate], [this, candidate, callback = std::move(callback)](const ErrorCode& ec) mutable {
+    if (!ec) {
+      m_endpoint = m_candidates[candidate];
+      m_connected = true;
+
+      m_hostMetrics->connectionOpened();
+    } else if (ec != asio::error::operation_aborted) {
+      m_balancer->failed(m_candidates[candidate]);
+
+      if (candidate + 1 < m_candidates.size()) {
+        connectTo_(candidate + 1, std::move(callback));
+
+        return;
+      }
+    }
+
+    onConnect_(ec, std::move(callback));
+  });
 }
 
 template <Protocol p>
@@ -87,41 +142,303 @@ std::shared_ptr<Request<p>> ClientCRTPBase<p>::get(std::string resource) {
 
 template <Protocol p>
 void ClientCRTPBase<p>::schedule(std::weak_ptr<Request<p>> request) {
-  std::lock_guard<std::mutex> l{m_requestQueueMtx};
+  if (const auto r = request.lock()) {
+    r->m_timing = Timing{};
+    r->m_timing.scheduled = Timing::Clock::now();
+
+    if (!r->m_pending) { // not when an attached request is scheduled again
+      r->m_pending = true;
+      r->m_metrics->started();
+    }
+
+    if (!r->armDeadline_()) // the budget is spent, failed without the connection
+      return;
+
+    r->m_retries = 0;
+
+    if (m_retrying)
+      m_retrying->requested();
+
+    if (r->lookupCache_()) // served from the cache, the connection is not needed
+      return;
+
+    if (m_hedging && r->hedgeable_()) {
+      r->hedge_(*static_cast<ClientImpl<p>*>(this));
+
+      return;
+    }
+
+    if (m_coalesce && r->coalescable_()) {
+      asio::post(m_is, [ self = static_cast<ClientImpl<p>*>(this)->shared_from_this(), r ]() { self->coalesce_(r); });
+
+      return;
+    }
+  }
+
+  enqueue_(std::move(request));
+}
 
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::schedule";
+template <Protocol p>
+void ClientCRTPBase<p>::enqueue_(std::weak_ptr<Request<p>> request) {
+  {
+    std::lock_guard<std::mutex> l{m_requestQueueMtx};
+
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::enqueue_";
+
+    m_requestQueue.push_back(std::move(request));
 
-  m_requestQueue.push_back(std::move(request));
+    if (m_requestActive)
+      return;
 
-  if (m_requestActive == false) {
     m_requestActive = true;
+  }
+
+  acquire_();
+}
 
-    auto onConnect = [this](const ErrorCode& ec) {
-      TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::schedule onConnect";
+template <Protocol p>
+void ClientCRTPBase<p>::acquire_() {
+  if (!takeSlot_()) // the requests wait in the queue for a slot
+    return;
+
+  auto onConnect = [this](const ErrorCode& ec) {
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::acquire_ onConnect";
 
+    std::vector<std::shared_ptr<Request<p>>> failed;
+
+    {
       std::lock_guard<std::mutex> l{m_requestQueueMtx};
 
       if (!ec) {
-        if (const auto request = m_requestQueue.front().lock())
-          request->start();
-        else
-          m_requestActive = false;
+        if (const auto request = nextRequest_()) {
+          start_(*request);
+
+          return;
+        }
       }
-      else
-        m_requestActive = false;
-    };
 
-    connect(std::move(onConnect));
+      m_requestActive = false;
+
+      if (ec) // the request at the front was left in the queue for the connection
+        failed = takeQueue_();
+
+      releaseSlot_(nullptr, ec);
+    }
+
+    // finished outside the lock, their callbacks may schedule requests again
+    for (const auto& request : failed)
+      request->finish(ec);
+  };
+
+  // connect without holding the queue lock, the callback runs synchronously when already connected
+  connect(std::move(onConnect));
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::hedgeClient_() {
+  if (!m_hedgeClient) {
+    const auto noopTimeout = static_cast<ClientImpl<p>*>(this)->connection().noopTimeout();
+
+    // the attempts are made like those of this client
+    m_hedgeClient = ClientImpl<p>::create(m_host, m_is, noopTimeout, m_resolveTimeout);
+    m_hedgeClient->memoryBudget(m_memoryBudget).cache(m_cache).balancer(m_balancer).decompress(m_decompress).metrics(m_metrics);
+
+    if (m_limiter)
+      m_hedgeClient->limiter(m_limiter);
+  }
+
+  m_hedgeClient->m_avoid = m_endpoint;
+
+  // an idle connection to the same address as this one is made again to another one
+  if (m_hedgeClient->requestCount() == 0 && m_hedgeClient->m_endpoint == m_endpoint) {
+    ErrorCode ignored;
+
+    m_hedgeClient->connection().socket().lowest_layer().close(ignored);
+  }
+
+  return *m_hedgeClient;
+}
+
+template <Protocol p>
+void ClientCRTPBase<p>::start_(Request<p>& request) {
+  m_balancer->started(m_endpoint);
+  m_outstanding = true;
+
+  auto& timing = request.m_timing;
+
+  if (m_connected) { // the connection was made for this request
+    const auto& connectionTiming = static_cast<ClientImpl<p>*>(this)->connection().timing();
+
+    timing.resolveStart = m_timing.resolveStart;
+    timing.resolveEnd = m_timing.resolveEnd;
+    timing.connectStart = connectionTiming.connectStart;
+    timing.connectEnd = connectionTiming.connectEnd;
+    timing.handshakeEnd = connectionTiming.handshakeEnd;
+  } else {
+    m_hostMetrics->connectionReused();
+
+    timing.resolveStart = timing.resolveEnd = Timing::Clock::time_point{};
+    timing.connectStart = timing.connectEnd = timing.handshakeEnd = Timing::Clock::time_point{};
   }
+
+  m_connected = false;
+
+  request.start();
 }
 
 template <Protocol p>
-ClientImpl<p>& ClientCRTPBase<p>::onConnect(ConnectCallback callback) {
+void ClientCRTPBase<p>::endpointDone_(const Request<p>* request, const ErrorCode& ec) {
+  if (!m_outstanding)
+    return;
+
+  m_outstanding = false;
+
+  auto outcome = EndpointBalancer::Outcome::Success;
+
+  if (ec == error::canceled)
+    outcome = EndpointBalancer::Outcome::Ignored;
+  else if (ec)
+    outcome = EndpointBalancer::Outcome::Failure;
+  else if (request && request->m_timing.header != Timing::Clock::time_point{} && request->m_header.status() >= 500)
+    outcome = EndpointBalancer::Outcome::Failure;
+
+  m_balancer->finished(m_endpoint, outcome);
+}
+
+template <Protocol p>
+bool ClientCRTPBase<p>::takeSlot_() {
+  if (!m_limiter || m_slot)
+    return true;
+
+  const std::weak_ptr<ClientImpl<p>> self = static_cast<ClientImpl<p>*>(this)->shared_from_this();
+
+  const auto acquired = m_limiter->tryAcquire([self]() {
+    const auto client = self.lock();
+
+    if (!client) // destroyed while waiting
+      return false;
+
+    asio::post(client->m_is, makeAllocHandler(client->connection().handlerMemory(), [client]() {
+                 client->acquire_();
+               }));
+
+    return true;
+  });
+
+  if (!acquired) {
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::takeSlot_ waiting for a slot";
+
+    return false;
+  }
+
+  m_slot = m_limiter;
+
+  return true;
+}
+
+template <Protocol p>
+void ClientCRTPBase<p>::releaseSlot_(const Request<p>* request, const ErrorCode& ec) {
+  if (!m_slot)
+    return;
+
+  const auto slot = std::move(m_slot);
+
+  if (!request || request->m_timing.started == ConcurrencyLimiter::Clock::time_point{}) { // not started
+    slot->release(ConcurrencyLimiter::Clock::now(), ConcurrencyLimiter::Outcome::Ignored);
+
+    return;
+  }
+
+  const auto headerReceived = request->m_timing.header != ConcurrencyLimiter::Clock::time_point{};
+
+  if (ec == error::timeout || (headerReceived && request->m_header.status() == 503))
+    slot->release(request->m_timing.started, ConcurrencyLimiter::Outcome::Dropped);
+  else if (!ec && headerReceived)
+    slot->release(request->m_timing.started, ConcurrencyLimiter::Outcome::Success, request->m_timing.header - request->m_timing.started);
+  else
+    slot->release(request->m_timing.started, ConcurrencyLimiter::Outcome::Ignored);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::onConnect(InplaceCallback<ConnectCallback> callback) {
   m_connectCallback = std::move(callback);
 
   return *static_cast<ClientImpl<p>*>(this);
 }
 
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::memoryBudget(std::shared_ptr<MemoryBudget> budget) {
+  assert(budget);
+
+  m_memoryBudget = std::move(budget);
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::decompress(bool enable) {
+  m_decompress = enable;
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::cache(std::shared_ptr<Cache> cache) {
+  m_cache = std::move(cache);
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::coalesce(bool enable) {
+  m_coalesce = enable;
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::limiter(std::shared_ptr<ConcurrencyLimiter> limiter) {
+  m_limiter = std::move(limiter);
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::hedging(std::shared_ptr<HedgePolicy> policy) {
+  m_hedging = std::move(policy);
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::retrying(std::shared_ptr<RetryPolicy> policy) {
+  m_retrying = std::move(policy);
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::metrics(std::shared_ptr<Metrics> metrics) {
+  assert(metrics);
+
+  m_metrics = std::move(metrics);
+  m_hostMetrics = m_metrics->host(m_host);
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
+template <Protocol p>
+ClientImpl<p>& ClientCRTPBase<p>::balancer(std::shared_ptr<EndpointBalancer> balancer) {
+  assert(balancer);
+
+  m_balancer = std::move(balancer);
+
+  if (m_endpointIterator != tcp::resolver::iterator{})
+    m_balancer->update({m_endpointIterator, tcp::resolver::iterator{}});
+
+  return *static_cast<ClientImpl<p>*>(this);
+}
+
 template <Protocol p>
 std::size_t ClientCRTPBase<p>::requestCount() const {
   std::lock_guard<std::mutex> l{m_requestQueueMtx};
@@ -130,18 +447,26 @@ std::size_t ClientCRTPBase<p>::requestCount() const {
 }
 
 template <Protocol p>
-void ClientCRTPBase<p>::resolve(ResolveCallback callback) {
+void ClientCRTPBase<p>::resolve(InplaceCallback<ResolveCallback, 128> callback) {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::resolve";
 
   if (m_endpointIterator == tcp::resolver::iterator{}) { // if endpoint is not yet resolved
     TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::resolve endpoint not resolved";
 
+    const auto& handlerMemory = static_cast<ClientImpl<p>*>(this)->connection().handlerMemory();
+
+    m_timing.resolveStart = Timing::Clock::now();
+
     m_resolveTimer.expires_from_now(m_resolveTimeout);
-    m_resolveTimer.async_wait(std::bind(&ClientCRTPBase<p>::onResolveTimeout_, this, _1));
+    m_resolveTimer.async_wait(makeAllocHandler(handlerMemory, [this](const ErrorCode& ec) { onResolveTimeout_(ec); }));
 
     tcp::resolver::query query{m_host, m_service};
 
-    m_resolver.async_resolve(query, std::bind(&ClientCRTPBase<p>::onResolve_, this, _1, _2, std::move(callback)));
+    m_resolver.async_resolve(query, makeAllocHandler(handlerMemory, [this, callback = std::move(callback)](
+                                                                        const ErrorCode& ec,
+                                                                        tcp::resolver::iterator it) mutable {
+      onResolve_(ec, std::move(it), std::move(callback));
+    }));
   } else {
     TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::resolve endpoint already resolved";
 
@@ -151,19 +476,23 @@ void ClientCRTPBase<p>::resolve(ResolveCallback callback) {
 
 template <Protocol p>
 void ClientCRTPBase<p>::onResolve_(const ErrorCode& ec, tcp::resolver::iterator endpointIt,
-                               ResolveCallback callback) {
+                               InplaceCallback<ResolveCallback, 128> callback) {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::onResolve_ ec: " << ec;
 
   m_resolveTimer.cancel();
 
-  if (!ec)
+  if (!ec) {
+    m_timing.resolveEnd = Timing::Clock::now();
     m_endpointIterator = std::move(endpointIt);
 
+    m_balancer->update({m_endpointIterator, tcp::resolver::iterator{}});
+  }
+
   callback(ec, m_endpointIterator);
 }
 
 template <Protocol p>
-void ClientCRTPBase<p>::onConnect_(const ErrorCode& ec, ConnectCallback callback) {
+void ClientCRTPBase<p>::onConnect_(const ErrorCode& ec, InplaceCallback<ConnectCallback> callback) {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::onConnect_ " << ec;
 
   connectCompleted(ec);
@@ -175,15 +504,18 @@ template <Protocol p>
 void ClientCRTPBase<p>::onResolveTimeout_(const ErrorCode& ec) {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::onResolveTimeout_ " << ec;
 
-  if (!ec)
+  if (!ec) {
+    m_hostMetrics->resolveTimeout();
+
     m_resolver.cancel();
+  }
 }
 
 template <Protocol p>
 void ClientCRTPBase<p>::onNoopTimeout_() {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientBase<C>::onNoopTimeout_ ";
 
-  std::lock_guard<std::mutex> l{m_requestQueueMtx};
+  m_hostMetrics->noopTimeout();
 
   clearRequestQueue(error::timeout);
 }
@@ -196,11 +528,8 @@ void ClientCRTPBase<p>::connectCompleted(const ErrorCode& ec) {
     m_connectCallback(ec);
   }
 
-  if (ec) {
-    std::lock_guard<std::mutex> l{m_requestQueueMtx};
-
+  if (ec)
     clearRequestQueue(ec);
-  }
 }
 
 template <Protocol p>
@@ -212,32 +541,83 @@ void ClientCRTPBase<p>::requestCompleted(const ErrorCode& ec) {
 
   assert(m_requestQueue.size() > 0);
 
+  // an abandoned hedging attempt fails as its connection is closed, which says nothing about the others
+  bool abandoned = false;
+
+  {
+    const auto request = m_requestQueue.front().lock();
+
+    abandoned = request && request->m_hedgeLost;
+
+    endpointDone_(request.get(), abandoned ? error::canceled : ec);
+    releaseSlot_(request.get(), abandoned ? error::canceled : ec);
+  }
+
   // pop the processed request
   m_requestQueue.pop_front();
   m_requestActive = false;
 
-  if (!ec) {
-TRY_NEXT_REQUEST:
-    if (m_requestQueue.size() > 0) {
+  auto& socket = static_cast<ClientImpl<p>*>(this)->connection().socket().lowest_layer();
 
-      if (const auto request = m_requestQueue.front().lock()) {
-        m_requestActive = true;
+  if (ec) { // the rest of the response may still come, the next request is sent on a new connection
+    ErrorCode ignored;
 
-        request->start();
-      } else {// the request no longer exists
-        m_requestQueue.pop_front();
+    socket.close(ignored);
+  }
 
-        goto TRY_NEXT_REQUEST;
-      }
+  if (const auto request = nextRequest_()) {
+    m_requestActive = true;
+
+    if (!socket.is_open()) {
+      // connected again outside of the queue lock
+      asio::post(m_is, [self = static_cast<ClientImpl<p>*>(this)->shared_from_this()]() { self->acquire_(); });
+
+      return;
     }
-  } else {// if error happened
-    // TODO: is this behavior correct? maybe propogate the same error?
-    clearRequestQueue(error::canceled);
+
+    if (!takeSlot_()) // started by acquire_() once there is a slot
+      return;
+
+    start_(*request);
+  }
+}
+
+template <Protocol p>
+std::shared_ptr<Request<p>> ClientCRTPBase<p>::nextRequest_() {
+  while (!m_requestQueue.empty()) {
+    const auto request = m_requestQueue.front().lock();
+
+    if (request && !request->m_expired && !request->deadlinePassed_())
+      return request;
+
+    if (request) // not sent once its deadline has passed
+      request->expire_();
+
+    m_requestQueue.pop_front();
   }
+
+  return nullptr;
 }
 
 template <Protocol p>
 void ClientCRTPBase<p>::clearRequestQueue(const ErrorCode& ec) {
+  std::vector<std::shared_ptr<Request<p>>> requests;
+
+  {
+    std::lock_guard<std::mutex> l{m_requestQueueMtx};
+
+    requests = takeQueue_();
+  }
+
+  // finished outside the lock, their callbacks may schedule requests again
+  for (const auto& request : requests)
+    request->finish(ec);
+}
+
+template <Protocol p>
+std::vector<std::shared_ptr<Request<p>>> ClientCRTPBase<p>::takeQueue_() {
+  std::vector<std::shared_ptr<Request<p>>> requests;
+
   // leave the active request in queue
   const std::size_t requestsToLeave = m_requestActive;
 
@@ -248,11 +628,54 @@ void ClientCRTPBase<p>::clearRequestQueue(const ErrorCode& ec) {
     std::advance(requestIt, requestsToLeave);
 
     if (const auto request = requestIt->lock()) {
-      request->finish(ec);
+      if (!request->m_expired) // completing already
+        requests.push_back(request);
     }
 
     m_requestQueue.erase(requestIt);
   }
+
+  return requests;
+}
+
+template <Protocol p>
+void ClientCRTPBase<p>::coalesce_(std::shared_ptr<Request<p>> request) {
+  auto key = request->coalescingKey_();
+
+  {
+    std::lock_guard<std::mutex> l{m_leadersMtx};
+
+    auto& leader = m_leaders[key];
+
+    // attached under the lock, a leader stops taking requests in leaderDone_ before it fans its response out
+    if (const auto r = leader.lock()) {
+      r->attach_(std::move(request));
+
+      return;
+    }
+
+    leader = request;
+    request->m_leading = true;
+    request->m_coalescingKey = std::move(key);
+  }
+
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " ClientCRTPBase<p>::coalesce_ leader: " << request.get();
+
+  enqueue_(std::move(request));
+}
+
+template <Protocol p>
+void ClientCRTPBase<p>::leaderDone_(const std::string& key, const Request<p>* leader) {
+  std::lock_guard<std::mutex> l{m_leadersMtx};
+
+  const auto it = m_leaders.find(key);
+
+  if (it != m_leaders.end()) {
+    const auto r = it->second.lock();
+
+    if (!r || r.get() == leader)
+      m_leaders.erase(it);
+  }
 }
 
 template class ClientCRTPBase<Protocol::HTTP>;
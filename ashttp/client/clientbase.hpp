@@ -24,12 +24,25 @@
 #pragma once
 
 #include "../type.hpp"
+#include "../function.hpp"
+#include "../postedhandler.hpp"
+#include "../memorybudget.hpp"
+#include "../cache.hpp"
+#include "../concurrencylimiter.hpp"
+#include "../endpointbalancer.hpp"
+#include "../hedgepolicy.hpp"
+#include "../retrypolicy.hpp"
+#include "../metrics.hpp"
+#include "../timing.hpp"
 
 #include <boost/asio.hpp>
 
 #include <functional>
 #include <deque>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace ashttp {
 namespace client {
@@ -47,6 +60,7 @@ class ClientCRTPBase
     : public std::enable_shared_from_this<ClientImpl<p>> {
   friend class Request<p>;
 public:
+  // the callbacks are stored in place when they fit, see InplaceCallback
   using ResolveCallback = std::function<void (const ErrorCode&, const tcp::resolver::iterator&)>;
   using ConnectCallback = std::function<void (const ErrorCode&)>;
 
@@ -69,7 +83,7 @@ public:
    * @brief connect Tries to connect to the client's host.
    * @param callback Callback to call with the connect result.
    */
-  void connect(ConnectCallback callback);
+  void connect(InplaceCallback<ConnectCallback> callback);
 
 
   /**
@@ -90,6 +104,21 @@ public:
   std::shared_ptr<Request<p>> get(std::string resource);
 
 
+  /**
+   * @brief asyncGet Creates and schedules a request to retrieve the resource.
+   * @param resource
+   * @param token Completion token, e.g. a callback or boost::asio::use_awaitable.
+   *
+   * Completes with (ErrorCode, std::shared_ptr<Request<p>>) once the header is received, so
+   *`co_await client->asyncGet("/", use_awaitable)` gives the request with its header. The body is then
+   *read with Request<p>::asyncReadSome().
+   *
+   * The handler is called on its associated executor, the io_service of the client if it has none.
+   */
+  template <class CompletionToken>
+  auto asyncGet(std::string resource, CompletionToken&& token);
+
+
   /**
    * @brief schedule Schedules a request object for processing.
    * @param request Request to schedule.
@@ -105,7 +134,154 @@ public:
    * The callback registered with this method will live until the end of lifetime of this object.
    *This means that if you bind the this client's shared_ptr object to this callback, the object will live forever.
    */
-  ClientImpl<p>& onConnect(ConnectCallback callback);
+  ClientImpl<p>& onConnect(InplaceCallback<ConnectCallback> callback);
+
+
+  /**
+   * @brief memoryBudget
+   * @return The budget the receive buffers of the requests of this client are accounted in.
+   *
+   * Every client has its own budget, unlimited unless MemoryBudget::limit() is set, whose parent is
+   *MemoryBudget::global().
+   */
+  const std::shared_ptr<MemoryBudget>& memoryBudget() const { return m_memoryBudget; }
+
+  /**
+   * @brief memoryBudget Sets the budget to account the receive buffers in, e.g. to share one among several
+   *clients.
+   * @param budget
+   * @return Self.
+   *
+   * Applies to the requests created after.
+   */
+  ClientImpl<p>& memoryBudget(std::shared_ptr<MemoryBudget> budget);
+
+
+  /**
+   * @brief decompress Sets whether the requests created after ask for compressed bodies, see
+   *Request<p>::decompress().
+   * @param enable
+   * @return Self.
+   *
+   * The requests created by asyncGet() can only be set up this way.
+   */
+  ClientImpl<p>& decompress(bool enable);
+
+  bool decompress() const { return m_decompress; }
+
+
+  /**
+   * @brief cache Sets the cache to serve the requests from and to store their responses in.
+   * @param cache nullptr to not use a cache, which is the default.
+   * @return Self.
+   *
+   * A request found fresh in the cache is completed from it without using the connection; one found stale is
+   *sent with its validators and completed from the cache if the server answers 304 (the header callback is
+   *given the cached header then). Applies to the requests created after.
+   */
+  ClientImpl<p>& cache(std::shared_ptr<Cache> cache);
+
+  const std::shared_ptr<Cache>& cache() const { return m_cache; }
+
+
+  /**
+   * @brief coalesce Sets whether a request is attached to an identical one in flight instead of being sent
+   *again.
+   * @param enable
+   * @return Self.
+   *
+   * Requests for the same resource with the same decompress() setting are identical, if their response is
+   *given to the header, body chunk or body span callbacks. The first one is sent and the others attached to it
+   *are given its header and its body from the same buffer as it is received; they complete with it. They are
+   *not paused by pause(). A request can be attached until the header of the first one is received.
+   *
+   * While enabled such requests are scheduled on the io_service rather than in schedule(). Off by default.
+   */
+  ClientImpl<p>& coalesce(bool enable);
+
+  bool coalesce() const { return m_coalesce; }
+
+
+  /**
+   * @brief limiter Sets the limiter to take a slot from before starting a request.
+   * @param limiter nullptr to not limit, which is the default.
+   * @return Self.
+   *
+   * While the limiter has no free slot the requests wait in the queue of the client. The requests are given
+   *to the limiter as a sample of the latency of the host until their header is received; timeouts and 503
+   *answers make it back off. Share one limiter among the clients of a host.
+   */
+  ClientImpl<p>& limiter(std::shared_ptr<ConcurrencyLimiter> limiter);
+
+  const std::shared_ptr<ConcurrencyLimiter>& limiter() const { return m_limiter; }
+
+
+  /**
+   * @brief balancer
+   * @return The balancer that picks the address of the host to connect to.
+   *
+   * Every client has its own, so clients that are not given a shared one still spread over the addresses.
+   */
+  const std::shared_ptr<EndpointBalancer>& balancer() const { return m_balancer; }
+
+  /**
+   * @brief balancer Sets the balancer to pick the address to connect to, e.g. to share one among the clients
+   *of a host.
+   * @param balancer
+   * @return Self.
+   *
+   * Applies to the connections made after.
+   */
+  ClientImpl<p>& balancer(std::shared_ptr<EndpointBalancer> balancer);
+
+  /**
+   * @brief hedging Sets the policy to send a request once more when its header is late.
+   * @param policy nullptr to not hedge, which is the default.
+   * @return Self.
+   *
+   * The request is sent as an attempt in the queue; if the attempt has not received its header after the delay
+   *of the policy, another attempt is sent through a second client of the same host, on another address if
+   *there are several. The request is given the response of the first attempt to receive a header, like an
+   *attached request (see coalesce()), and the other attempt is dropped, closing its connection if it is sent.
+   *Requests that are hedged are not coalesced; the ones that read into buffers, to files or with
+   *asyncReadSome() are not hedged.
+   */
+  ClientImpl<p>& hedging(std::shared_ptr<HedgePolicy> policy);
+
+  const std::shared_ptr<HedgePolicy>& hedging() const { return m_hedging; }
+
+  /**
+   * @brief retrying Sets the policy to send a request again when it fails for a transient reason.
+   * @param policy nullptr to not retry, which is the default.
+   * @return Self.
+   *
+   * A request is retried if it failed as the policy allows before its header is given to the callbacks, and
+   *its deadline is not passed by the end of the backoff; it is put at the back of the queue then. A response
+   *with a retryable status is given up after its header, closing the connection. Attached and hedged requests
+   *are not retried on their own. The budget of the policy is shared by the clients it is set on.
+   */
+  ClientImpl<p>& retrying(std::shared_ptr<RetryPolicy> policy);
+
+  const std::shared_ptr<RetryPolicy>& retrying() const { return m_retrying; }
+
+
+  /**
+   * @brief metrics Sets the registry the requests of this client are recorded into, under its host.
+   * @param metrics Metrics::global() by default.
+   * @return Self.
+   *
+   * The requests created before are recorded into the registry they were created with.
+   */
+  ClientImpl<p>& metrics(std::shared_ptr<Metrics> metrics);
+
+  const std::shared_ptr<Metrics>& metrics() const { return m_metrics; }
+
+
+  /**
+   * @brief endpoint
+   * @return The address of the host the connection was last made to.
+   */
+  const tcp::endpoint& endpoint() const { return m_endpoint; }
 
 
   /**
@@ -122,20 +298,20 @@ public:
    * This method caches the result and directly calls the callback if already resolved.
    * Also, this method will be automatically called by other methods if the other method requires resolving.
    */
-  void resolve(ResolveCallback callback);
+  void resolve(InplaceCallback<ResolveCallback, 128> callback);
 
 
 protected:
   ClientCRTPBase(std::string host, std::string service, asio::io_service& is, Millisec resolveTimeout);
 
-  void onResolve_(const ErrorCode& ec, tcp::resolver::iterator endpointIt, ResolveCallback callback);
+  void onResolve_(const ErrorCode& ec, tcp::resolver::iterator endpointIt, InplaceCallback<ResolveCallback, 128> callback);
   /**
    * @brief onConnect_ Internal method called after trying to connect.
    * @param ec Error code.
    * @param endpointIt The endpoint that is successfully connected.
    * @param callback Callback to call on connect.
    */
-  void onConnect_(const ErrorCode& ec, ConnectCallback callback);
+  void onConnect_(const ErrorCode& ec, InplaceCallback<ConnectCallback> callback);
 
   void onNoopTimeout_();
   void onResolveTimeout_(const ErrorCode& ec);
@@ -158,8 +334,10 @@ private:
    *because this will delete the request.
    *
    * This method is always called after a request started. If connection failure occurs before the request
-   *processing starts, then this is not called. So failed requests will be cleaned-up but not-yet-started
-   *requests will remain to be reprocessed using ClientBase<C>::restartProcessing().
+   *processing starts, then this is not called and the queued requests fail with the connection error.
+   *
+   * A failed request does not affect the ones queued after it: its connection is closed, as it may still
+   *carry the rest of its response, and they are sent on a new one.
    */
   void requestCompleted(const ErrorCode& ec);
 
@@ -167,9 +345,91 @@ private:
   /**
    * @brief clearRequestQueue
    * @param ec Error code to notify the requests in queue.
+   *
+   * Takes the queue lock, the requests are finished after it is released.
    */
   void clearRequestQueue(const ErrorCode& ec);
 
+  /**
+   * @brief takeQueue_ Removes the requests in queue but the active one.
+   * @return The removed requests that are not completing already, to be finished without the queue lock.
+   *
+   * Called holding the queue lock.
+   */
+  std::vector<std::shared_ptr<Request<p>>> takeQueue_();
+
+
+  /**
+   * @brief nextRequest_ Pops the requests that no longer exist or whose deadline has passed off the front of
+   *the queue; the latter complete with error::timeout.
+   * @return The request at the front of the queue, nullptr if it is empty.
+   *
+   * Called holding the queue lock.
+   */
+  std::shared_ptr<Request<p>> nextRequest_();
+
+  /**
+   * @brief enqueue_ Adds a request to the queue and starts processing it if the client is idle.
+   */
+  void enqueue_(std::weak_ptr<Request<p>> request);
+
+  /**
+   * @brief connectTo_ Connects to the address \p candidate of m_candidates, trying the following ones if it
+   *fails.
+   */
+  void connectTo_(std::size_t candidate, InplaceCallback<ConnectCallback> callback);
+
+  /**
+   * @brief hedgeClient_
+   * @return The client to send the hedges of the requests of this one through, set up to connect to another
+   *address than this one.
+   */
+  ClientImpl<p>& hedgeClient_();
+
+  /**
+   * @brief start_ Starts \p request on the connection.
+   */
+  void start_(Request<p>& request);
+
+  /**
+   * @brief endpointDone_ Tells the balancer how \p request, which completed with \p ec, went.
+   */
+  void endpointDone_(const Request<p>* request, const ErrorCode& ec);
+
+  /**
+   * @brief acquire_ Takes a slot from the limiter, then connects and starts the request at the front of the
+   *queue.
+   *
+   * Called with m_requestActive set and without holding the queue lock. Without a free slot a waiter calls
+   *it again on the io_service.
+   */
+  void acquire_();
+
+  /**
+   * @brief takeSlot_
+   * @return true if there is no limiter or a slot is taken from it.
+   */
+  bool takeSlot_();
+
+  /**
+   * @brief releaseSlot_ Gives back the slot of \p request, which completed with \p ec, to the limiter with the
+   *sample it makes.
+   */
+  void releaseSlot_(const Request<p>* request, const ErrorCode& ec);
+
+  /**
+   * @brief coalesce_ Attaches \p request to the identical request in flight, or enqueues it as one that the
+   *following identical requests attach to.
+   *
+   * Called on the io_service, which may be run by several threads.
+   */
+  void coalesce_(std::shared_ptr<Request<p>> request);
+
+  /**
+   * @brief leaderDone_ Removes the request in flight with \p key if it is \p leader or if it no longer exists.
+   */
+  void leaderDone_(const std::string& key, const Request<p>* leader);
+
 
 private:
   asio::io_service& m_is;
@@ -178,16 +438,61 @@ private:
   std::string m_service;
   tcp::resolver::iterator m_endpointIterator;
 
-  ConnectCallback m_connectCallback;
+  InplaceCallback<ConnectCallback> m_connectCallback;
 
   boost::posix_time::millisec m_resolveTimeout;
   boost::asio::deadline_timer m_resolveTimer;
 
+  std::shared_ptr<MemoryBudget> m_memoryBudget;
+  bool m_decompress;
+  std::shared_ptr<Cache> m_cache;
+
+  bool m_coalesce;
+
+  // not under m_requestQueueMtx: the requests finished while it is held leave m_leaders
+  std::mutex m_leadersMtx;
+  std::unordered_map<std::string, std::weak_ptr<Request<p>>> m_leaders;
+
+  std::shared_ptr<ConcurrencyLimiter> m_limiter;
+  std::shared_ptr<ConcurrencyLimiter> m_slot; // the limiter the slot of the active request is taken from
+
+  std::shared_ptr<EndpointBalancer> m_balancer;
+  std::vector<tcp::endpoint> m_candidates; // of the connect in progress
+  tcp::endpoint m_endpoint;
+  tcp::endpoint m_avoid; // tried last if there are other addresses
+  bool m_outstanding;    // the active request is counted on m_endpoint
+
+  Timing m_timing;  // resolve phases of the last connect
+  bool m_connected; // a connection was made since the last request was started
+
+  std::shared_ptr<HedgePolicy> m_hedging;
+  std::shared_ptr<RetryPolicy> m_retrying;
+  std::shared_ptr<ClientImpl<p>> m_hedgeClient;
+
+  std::shared_ptr<Metrics> m_metrics;
+  std::shared_ptr<Metrics::Host> m_hostMetrics; // of m_host in m_metrics
+
   mutable std::mutex m_requestQueueMtx;
   std::deque<std::weak_ptr<Request<p>>> m_requestQueue;
   bool m_requestActive;
 };
 
+template <Protocol p>
+template <class CompletionToken>
+auto ClientCRTPBase<p>::asyncGet(std::string resource, CompletionToken&& token) {
+  auto initiation = [this](auto&& handler, std::string resource) {
+    auto request = get(std::move(resource));
+
+    request->pull([handler = makePostedHandler(std::move(handler), m_is.get_executor()), request](
+        const ErrorCode& ec) mutable { handler(ec, std::move(request)); });
+
+    schedule(request);
+  };
+
+  return asio::async_initiate<CompletionToken, void(ErrorCode, std::shared_ptr<Request<p>>)>(
+      std::move(initiation), token, std::move(resource));
+}
+
 extern template class ClientCRTPBase<Protocol::HTTP>;
 extern template class ClientCRTPBase<Protocol::HTTPS>;
 
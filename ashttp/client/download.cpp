@@ -0,0 +1,468 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "download.hpp"
+
+#include "request.hpp"
+#include "../parser.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace ashttp {
+namespace client {
+
+template <Protocol p>
+constexpr std::uint64_t Download<p>::ToEnd;
+
+template <Protocol p>
+std::shared_ptr<Download<p>> Download<p>::create(std::string host, std::string resource, asio::io_service& is,
+                                                 Options options) {
+  return std::shared_ptr<Download<p>>(new Download<p>{std::move(host), std::move(resource), is, options});
+}
+
+template <Protocol p>
+Download<p>::Download(std::string host, std::string resource, asio::io_service& is, Options options)
+    : m_is(is)
+    , m_host{std::move(host)}
+    , m_resource{std::move(resource)}
+    , m_options{options}
+    , m_balancer{std::make_shared<EndpointBalancer>()}
+    , m_probed{false}
+    , m_ranged{false}
+    , m_next{0}
+    , m_delivered{0}
+    , m_completed{false}
+    , m_rate{0}
+    , m_received{0}
+    , m_fetched{0}
+    , m_retries{0} {
+  assert(m_options.connections > 0 && m_options.attempts > 0);
+  assert(m_options.minSegmentSize > 0 && m_options.minSegmentSize <= m_options.maxSegmentSize);
+  assert(m_options.maxAhead > 0);
+}
+
+template <Protocol p>
+Download<p>& Download<p>::onData(InplaceCallback<DataCallback> callback) {
+  m_dataCallback = std::move(callback);
+
+  return *this;
+}
+
+template <Protocol p>
+Download<p>& Download<p>::toFile(std::string path, FileSink::Options options) {
+  m_path = std::move(path);
+  m_sinkOptions = options;
+  m_sinkOptions.truncate = false;
+
+  return *this;
+}
+
+template <Protocol p>
+Download<p>& Download<p>::onComplete(InplaceCallback<CompleteCallback> callback) {
+  m_completeCallback = std::move(callback);
+
+  return *this;
+}
+
+template <Protocol p>
+void Download<p>::start() {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Download<p>::start " << m_host << m_resource;
+
+  if (!m_path.empty()) { // truncate the file once, the segments write into it
+    ErrorCode ec;
+
+    if (!FileSink::open(m_path, ec)) {
+      asio::post(m_is, [self = this->shared_from_this(), ec]() { self->complete_(ec); });
+
+      return;
+    }
+  }
+
+  m_clients.push_back(newClient_());
+
+  // the first range tells the size and whether ranges are supported
+  issue_(0);
+}
+
+template <Protocol p>
+typename Download<p>::Stats Download<p>::stats() const {
+  return Stats{m_size, m_received, m_fetched, m_retries, m_clients.size(), m_ranged};
+}
+
+template <Protocol p>
+bool Download<p>::issue_(std::size_t client) {
+  if (m_completed || (m_probed && m_size ? m_next >= *m_size : m_next == ToEnd) || ahead_())
+    return false;
+
+  Segment segment{};
+
+  segment.first = m_next;
+  segment.client = client;
+
+  if (!m_probed) {
+    segment.last = m_options.firstSegmentSize - 1;
+  } else if (!m_size) { // the rest, the size is not told
+    segment.last = ToEnd;
+  } else {
+    segment.last = m_next + std::min(segmentSize_(), *m_size - m_next) - 1;
+  }
+
+  m_next = segment.last == ToEnd ? ToEnd : segment.last + 1;
+
+  auto& inserted = m_segments.emplace(segment.first, std::move(segment)).first->second;
+
+  fetch_(inserted);
+
+  return true;
+}
+
+template <Protocol p>
+void Download<p>::fetch_(Segment& segment) {
+  const auto first = segment.first;
+  auto request = m_clients[segment.client]->get(m_resource);
+
+  request->decompress(false).timeout(m_options.timeout).range(first + segment.received, segment.last);
+
+  request->onHeader([this, first](const ErrorCode& ec, const Header& header) {
+    if (!ec)
+      onHeader_(first, header);
+  });
+
+  if (m_path.empty()) {
+    request->onBodySpan([this, first](const ErrorCode& ec, const asio::const_buffer& data) {
+      if (!ec)
+        onData_(first, data);
+
+      return data.size();
+    });
+  }
+
+  // the request keeps itself until it completes
+  request->onComplete([ self = this->shared_from_this(), request, first ](const ErrorCode& ec) {
+    self->onComplete_(first, ec);
+  });
+
+  segment.request = request;
+  segment.sink = nullptr;
+  segment.started = Clock::now();
+  segment.startedAt = segment.received;
+  segment.valid = false;
+
+  m_clients[segment.client]->schedule(request);
+}
+
+template <Protocol p>
+void Download<p>::issueIdle_() {
+  while (!m_completed && !ahead_()) {
+    if (!m_idle.empty()) {
+      if (!issue_(m_idle.back()))
+        break;
+
+      m_idle.pop_back();
+    } else if (m_clients.size() < m_options.connections) {
+      m_clients.push_back(newClient_());
+
+      if (!issue_(m_clients.size() - 1)) {
+        m_clients.pop_back();
+
+        break;
+      }
+    } else {
+      break;
+    }
+  }
+}
+
+template <Protocol p>
+bool Download<p>::ahead_() const {
+  return m_path.empty() && m_ranged && m_next - m_delivered >= m_options.maxAhead;
+}
+
+template <Protocol p>
+std::uint64_t Download<p>::segmentSize_() const {
+  auto size = m_rate > 0
+                  ? static_cast<std::uint64_t>(m_rate * std::chrono::duration<double>{m_options.segmentDuration}.count())
+                  : m_options.firstSegmentSize;
+
+  size = std::max(m_options.minSegmentSize, std::min(m_options.maxSegmentSize, size));
+
+  // near the end the rest is shared by the connections so that they finish together
+  if (m_size) {
+    const auto share = (*m_size - m_next + m_options.connections - 1) / m_options.connections;
+
+    size = std::min(size, std::max(m_options.minSegmentSize, share));
+  }
+
+  // nor beyond what may be held for the data callback
+  if (m_path.empty())
+    size = std::min(size, std::max(m_options.minSegmentSize, m_delivered + m_options.maxAhead - m_next));
+
+  return size;
+}
+
+template <Protocol p>
+void Download<p>::onHeader_(std::uint64_t first, const Header& header) {
+  const auto it = m_segments.find(first);
+
+  if (it == m_segments.end() || m_completed)
+    return;
+
+  auto& segment = it->second;
+  const auto validator = header.field(FieldId::ETag) ? header.field(FieldId::ETag) : header.field(FieldId::LastModified);
+
+  switch (header.status()) {
+  case 206: {
+    const auto contentRange = header.field(FieldId::ContentRange);
+    const auto range = contentRange ? parseContentRange(*contentRange) : boost::none;
+
+    if (!range || range->first != first + segment.received || range->last > segment.last)
+      return;
+
+    if (!m_probed) {
+      m_probed = true;
+      m_ranged = true;
+      m_size = range->size;
+      m_validator = validator.value_or(boost::string_view{}).to_string();
+
+      // the resource may be shorter than the range asked for
+      segment.last = range->last;
+      m_next = range->last + 1;
+    } else if (m_validator != validator.value_or(boost::string_view{})) { // the resource has changed
+      complete_(error::unexpectedResponse);
+
+      return;
+    }
+
+    break;
+  }
+
+  case 200: // ranges are not supported, this is the whole resource
+    if (m_probed || first != 0)
+      return;
+
+    m_probed = true;
+    m_size = header.contentLength();
+    segment.last = ToEnd;
+    m_next = ToEnd;
+    break;
+
+  case 416: { // only an empty resource has no first range
+    const auto contentRange = header.field(FieldId::ContentRange);
+
+    if (m_probed || !contentRange || parseUnsatisfiedRange(*contentRange) != std::uint64_t{0})
+      return;
+
+    m_probed = true;
+    m_ranged = true;
+    m_size = std::uint64_t{0};
+    m_next = 0;
+    segment.empty = true;
+
+    return;
+  }
+
+  default:
+    return;
+  }
+
+  segment.valid = true;
+
+  if (!m_path.empty()) {
+    ErrorCode ec;
+
+    segment.sink = FileSink::open(m_path, ec, first + segment.received, m_sinkOptions);
+
+    if (!segment.sink) {
+      complete_(ec);
+
+      return;
+    }
+
+    segment.request->bodyToFile(segment.sink);
+  }
+
+  if (m_ranged) // the rest over the other connections
+    issueIdle_();
+}
+
+template <Protocol p>
+void Download<p>::onData_(std::uint64_t first, const asio::const_buffer& data) {
+  const auto it = m_segments.find(first);
+
+  if (it == m_segments.end() || m_completed || !it->second.valid || data.size() == 0)
+    return;
+
+  auto& segment = it->second;
+
+  const auto next = first + segment.received == m_delivered;
+
+  if (next) { // next in order, given straight from the receive buffer
+    m_delivered += data.size();
+
+    if (m_dataCallback)
+      m_dataCallback(data);
+  } else {
+    segment.held.append(static_cast<const char*>(data.data()), data.size());
+  }
+
+  segment.received += data.size();
+  m_received += data.size();
+
+  if (next && !m_idle.empty()) // the delivery has moved on, the idle clients may fetch further
+    issueIdle_();
+}
+
+template <Protocol p>
+void Download<p>::onComplete_(std::uint64_t first, const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Download<p>::onComplete_ " << first << " ec: " << ec;
+
+  const auto it = m_segments.find(first);
+
+  if (it == m_segments.end() || m_completed)
+    return;
+
+  auto& segment = it->second;
+
+  segment.request = nullptr;
+
+  if (segment.sink) { // what reached the file counts, a failed segment continues after it
+    const auto flushEc = segment.sink->flush();
+
+    if (flushEc) {
+      complete_(flushEc);
+
+      return;
+    }
+
+    segment.received = segment.startedAt + segment.sink->size();
+    m_received += segment.sink->size();
+    segment.sink = nullptr;
+  }
+
+  const auto whole = segment.last == ToEnd || first + segment.received == segment.last + 1;
+
+  if (segment.empty || (!ec && segment.valid && whole)) {
+    const auto elapsed = std::chrono::duration<double>{Clock::now() - segment.started}.count();
+    const auto client = segment.client;
+
+    if (elapsed > 0 && segment.received > segment.startedAt) {
+      const auto rate = (segment.received - segment.startedAt) / elapsed;
+
+      m_rate = m_rate > 0 ? 0.7 * m_rate + 0.3 * rate : rate;
+    }
+
+    segment.done = true;
+    ++m_fetched;
+
+    m_idle.push_back(client);
+
+    deliver_();
+    issueIdle_();
+    tryComplete_();
+
+    return;
+  }
+
+  if (++segment.attempts >= m_options.attempts) {
+    complete_(ec ? ec : error::unexpectedResponse);
+
+    return;
+  }
+
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Download<p>::onComplete_ retrying from " << first + segment.received;
+
+  ++m_retries;
+
+  // the connection may be broken, the segment continues on a new one
+  m_clients[segment.client] = newClient_();
+
+  fetch_(segment);
+}
+
+template <Protocol p>
+void Download<p>::deliver_() {
+  while (!m_segments.empty()) {
+    auto& segment = m_segments.begin()->second;
+
+    if (m_path.empty()) {
+      if (segment.first + segment.received - segment.held.size() != m_delivered)
+        break;
+
+      if (!segment.held.empty()) {
+        m_delivered += segment.held.size();
+
+        if (m_dataCallback)
+          m_dataCallback(asio::buffer(segment.held));
+
+        std::string{}.swap(segment.held);
+      }
+    }
+
+    if (!segment.done)
+      break;
+
+    m_segments.erase(m_segments.begin());
+  }
+}
+
+template <Protocol p>
+void Download<p>::tryComplete_() {
+  if (!m_completed && m_segments.empty())
+    complete_(error::success);
+}
+
+template <Protocol p>
+void Download<p>::complete_(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Download<p>::complete_ ec: " << ec;
+
+  m_completed = true;
+
+  // the requests still running are cancelled by closing their connections, out of their callbacks
+  asio::post(m_is, [self = this->shared_from_this()]() {
+    self->m_clients.clear();
+    self->m_segments.clear();
+  });
+
+  if (m_completeCallback) {
+    m_completeCallback(ec);
+
+    m_completeCallback = [](const ErrorCode&) {};
+  }
+}
+
+template <Protocol p>
+std::shared_ptr<ClientImpl<p>> Download<p>::newClient_() {
+  auto client = ClientImpl<p>::create(m_host, m_is);
+
+  client->balancer(m_balancer);
+
+  return client;
+}
+
+template class Download<Protocol::HTTP>;
+template class Download<Protocol::HTTPS>;
+
+}
+}
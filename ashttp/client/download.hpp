@@ -0,0 +1,246 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "client.hpp"
+#include "../filesink.hpp"
+#include "../function.hpp"
+#include "../type.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/optional.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ashttp {
+namespace client {
+
+template <Protocol p>
+class Request;
+
+/**
+ * @brief Download Fetches a large resource in byte ranges over several connections at once.
+ *
+ * The first range tells the size of the resource and whether the server supports ranges; if it does not, the
+ *resource is received as one response. Otherwise the rest is split into segments which are fetched
+ *concurrently, each connection taking the next segment when it is done with one. Segments are sized from the
+ *measured throughput to take about Options::segmentDuration, and become smaller towards the end so that the
+ *connections finish together. A segment that fails is fetched again from its first missing byte on a new
+ *connection.
+ *
+ * The body is either given to the data callback in order, segments received ahead being held in memory until
+ *then, or written at the offsets of the segments to a file (see toFile()). With the data callback no segment is
+ *fetched beyond Options::maxAhead bytes after the delivered part, so a slow connection does not make the rest
+ *of the body pile up in memory.
+ *
+ * The callbacks are called on the io_service.
+ */
+template <Protocol p>
+class Download
+    : public std::enable_shared_from_this<Download<p>> {
+public:
+  using DataCallback = std::function<void(const asio::const_buffer& data)>;
+  using CompleteCallback = std::function<void(const ErrorCode&)>;
+
+  struct Options {
+    Options() { }
+
+    std::size_t connections = 8;
+    std::uint64_t firstSegmentSize = 1024 * 1024;        // of the first range, which tells the size
+    std::uint64_t minSegmentSize = 256 * 1024;
+    std::uint64_t maxSegmentSize = 64 * 1024 * 1024;
+    std::chrono::milliseconds segmentDuration{2000};     // what a segment is sized to take
+    unsigned attempts = 3;                               // to fetch a segment
+    Millisec timeout{30000};                             // of the request of a segment
+    std::uint64_t maxAhead = 128 * 1024 * 1024;          // fetched ahead of the data given to the data callback
+  };
+
+  struct Stats {
+    boost::optional<std::uint64_t> size; // of the resource, once known
+    std::uint64_t received;
+    std::uint64_t segments; // fetched
+    std::uint64_t retries;
+    std::size_t connections;
+    bool ranged; // the server supports ranges
+  };
+
+public:
+  /**
+   * @brief create
+   * @param host
+   * @param resource
+   * @param is
+   * @param options
+   * @return The download, which is started by start().
+   */
+  static std::shared_ptr<Download> create(std::string host, std::string resource, asio::io_service& is,
+                                          Options options = Options{});
+
+  Download(const Download&) = delete;
+  Download& operator=(const Download&) = delete;
+
+  /**
+   * @brief onData Registers the callback to be given the body in order.
+   * @param callback
+   * @return Self.
+   */
+  Download& onData(InplaceCallback<DataCallback> callback);
+
+  /**
+   * @brief toFile Makes the body to be written to the file at \p path, which is truncated, instead.
+   * @param path
+   * @param options Of the sinks of the segments; truncate is not used.
+   * @return Self.
+   */
+  Download& toFile(std::string path, FileSink::Options options = FileSink::Options{});
+
+  /**
+   * @brief onComplete Registers the callback to be called once the whole body is received or the download
+   *fails.
+   * @param callback
+   * @return Self.
+   */
+  Download& onComplete(InplaceCallback<CompleteCallback> callback);
+
+  /**
+   * @brief start Starts the download.
+   */
+  void start();
+
+  Stats stats() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::uint64_t ToEnd = std::numeric_limits<std::uint64_t>::max();
+
+  struct Segment {
+    std::uint64_t first;
+    std::uint64_t last; // inclusive, ToEnd if not known
+    std::uint64_t received;
+    unsigned attempts;
+    std::size_t client;
+
+    std::shared_ptr<Request<p>> request;
+    std::shared_ptr<FileSink> sink;
+    Clock::time_point started;
+    std::uint64_t startedAt; // the received bytes when the request started
+
+    bool valid; // the response is for this segment
+    bool empty; // the resource turned out to be empty
+    bool done;
+    std::string held; // received ahead of the delivered part, the last bytes of [first, first + received)
+  };
+
+  Download(std::string host, std::string resource, asio::io_service& is, Options options);
+
+  /**
+   * @brief issue_ Fetches the next segment on the client at \p client.
+   * @return false if there is no segment left to fetch.
+   */
+  bool issue_(std::size_t client);
+
+  /**
+   * @brief fetch_ Sends a request for the bytes of \p segment not received yet.
+   */
+  void fetch_(Segment& segment);
+
+  /**
+   * @brief issueIdle_ Fetches the next segments on the idle clients, and on new ones up to the connections.
+   */
+  void issueIdle_();
+
+  /**
+   * @brief ahead_
+   * @return true if the data callback is so far behind that no segment is fetched for now.
+   */
+  bool ahead_() const;
+
+  /**
+   * @brief segmentSize_
+   * @return The size of the next segment.
+   */
+  std::uint64_t segmentSize_() const;
+
+  void onHeader_(std::uint64_t first, const Header& header);
+  void onData_(std::uint64_t first, const asio::const_buffer& data);
+  void onComplete_(std::uint64_t first, const ErrorCode& ec);
+
+  /**
+   * @brief deliver_ Gives the held data that is next in order to the data callback.
+   */
+  void deliver_();
+
+  /**
+   * @brief tryComplete_ Completes the download if all the segments are done.
+   */
+  void tryComplete_();
+
+  void complete_(const ErrorCode& ec);
+
+  std::shared_ptr<ClientImpl<p>> newClient_();
+
+private:
+  asio::io_service& m_is;
+  const std::string m_host;
+  const std::string m_resource;
+  const Options m_options;
+
+  std::string m_path;
+  FileSink::Options m_sinkOptions;
+  InplaceCallback<DataCallback> m_dataCallback;
+  InplaceCallback<CompleteCallback> m_completeCallback;
+
+  std::vector<std::shared_ptr<ClientImpl<p>>> m_clients;
+  std::vector<std::size_t> m_idle; // the clients done with their segment, waiting for the delivery to catch up
+  std::shared_ptr<EndpointBalancer> m_balancer; // shared by the clients, to spread them over the addresses
+  std::map<std::uint64_t, Segment> m_segments; // by first byte; in flight, or done and not yet delivered
+
+  bool m_probed; // the first response is received
+  bool m_ranged;
+  boost::optional<std::uint64_t> m_size;
+  std::string m_validator; // the etag or last-modified of the first response, the others must have the same
+  std::uint64_t m_next;    // the first byte not in a segment yet
+  std::uint64_t m_delivered;
+  bool m_completed;
+
+  double m_rate; // bytes per second of a connection, averaged over the segments
+  std::uint64_t m_received;
+  std::uint64_t m_fetched;
+  std::uint64_t m_retries;
+};
+
+extern template class Download<Protocol::HTTP>;
+extern template class Download<Protocol::HTTPS>;
+
+}
+}
@@ -27,30 +27,109 @@
 
 #include <boost/chrono.hpp>
 
-#include <array>
+#include <algorithm>
+#include <chrono>
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <string>
 
 namespace ashttp {
 namespace client {
 
-using namespace std::placeholders;
+namespace {
+
+/**
+ * @brief ViewStreambuf A read-only stream buffer over memory that is not copied.
+ */
+class ViewStreambuf : public std::streambuf {
+public:
+  ViewStreambuf(const char* data, std::size_t size) {
+    const auto begin = const_cast<char*>(data);
+
+    setg(begin, begin, begin + size);
+  }
+};
+
+}
 
 template <Protocol p>
 Request<p>::Request(std::weak_ptr<ClientImpl<p>> client, std::string host, std::string resource, Millisec timeout)
     : m_client{std::move(client)}
     , m_host{std::move(host)}
     , m_resource{std::move(resource)}
+    , m_chunkLeft{0}
+    , m_bodyLeft{0}
+    , m_bodySliceSize{DefaultBodySliceSize}
+    , m_paused{false}
+    , m_bodyStalled{false}
+    , m_memoryBudget{m_client.lock()->memoryBudget()}
+    , m_maxBufferSize{DefaultMaxBufferSize}
+    , m_memoryReserved{0}
+    , m_memoryStalled{false}
+    , m_decompress{m_client.lock()->decompress()}
+    , m_ranged{false}
+    , m_rangeFirst{0}
+    , m_rangeLast{0}
+    , m_decoding{false}
+    , m_decodeLeft{0}
+    , m_decodeMore{false}
+    , m_cache{m_client.lock()->cache()}
+    , m_replaying{false}
+    , m_replayOffset{0}
+    , m_detached{false}
+    , m_leading{false}
+    , m_following{false}
+    , m_hedgeTimer{m_client.lock()->connection().socket().get_executor()}
+    , m_hedgeWinner{nullptr}
+    , m_hedgeArmed{false}
+    , m_hedgeAttempt{false}
+    , m_hedgeLost{false}
+    , m_metrics{m_client.lock()->m_hostMetrics}
+    , m_pending{false}
     , m_timeout{timeout}
-    , m_timeoutTimer{m_client.lock()->connection().socket().get_io_service()} {
+    , m_queued{false}
+    , m_expired{false}
+    , m_timeoutTimer{m_client.lock()->connection().socket().get_executor()}
+    , m_retries{0}
+    , m_answered{false}
+    , m_retrying{false}
+    , m_handlerMemory{m_client.lock()->connection().handlerMemory()}
+    , m_pullMode{false}
+    , m_pullResume{false}
+    , m_pullEnd{false}
+    , m_pullAvailable{0} {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request";
 }
 
 template <Protocol p>
 Request<p>::~Request() {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ~Request";
+
+  releaseMemory_();
+
+  if (m_pending) // dropped before it completed
+    m_metrics->completed(error::canceled);
+
+  if (m_leading) { // dropped before it was started, the attached requests are scheduled again
+    if (const auto client = m_client.lock()) {
+      asio::post(m_timeoutTimer.get_executor(), [ client, key = std::move(m_coalescingKey), followers = std::move(m_followers) ]() {
+        client->leaderDone_(key, nullptr);
+
+        for (const auto& follower : followers) {
+          if (follower->m_following) {
+            follower->m_following = false;
+
+            client->schedule(follower);
+          }
+        }
+      });
+    }
+  }
 }
 
 template <Protocol p>
-Request<p>& Request<p>::onComplete(CompleteCallback callback) {
+Request<p>& Request<p>::onComplete(InplaceCallback<CompleteCallback> callback) {
   m_completeCallback = std::move(callback);
 
   return *this;
@@ -64,21 +143,110 @@ Request<p>& Request<p>::timeout(Millisec timeout) {
 }
 
 template <Protocol p>
-Request<p>& Request<p>::onHeader(HeaderCallback callback) {
+Request<p>& Request<p>::deadline(std::chrono::steady_clock::time_point deadline) {
+  m_deadline = deadline;
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::bodySliceSize(std::size_t size) {
+  assert(size > 0);
+
+  m_bodySliceSize = size;
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::maxBufferSize(std::size_t size) {
+  assert(size > 0);
+
+  m_maxBufferSize = size;
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::decompress(bool enable) {
+  m_decompress = enable;
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::range(std::uint64_t first, std::uint64_t last) {
+  assert(first <= last);
+
+  m_ranged = true;
+  m_rangeFirst = first;
+  m_rangeLast = last;
+
+  return *this;
+}
+
+template <Protocol p>
+void Request<p>::pause() {
+  m_paused = true;
+}
+
+template <Protocol p>
+void Request<p>::resume() {
+  m_paused = false;
+
+  if (m_bodyStalled) {
+    m_bodyStalled = false;
+
+    continueBody_();
+  }
+}
+
+template <Protocol p>
+Request<p>& Request<p>::onHeader(InplaceCallback<HeaderCallback> callback) {
   m_headerCallback = std::move(callback);
 
   return *this;
 }
 
 template <Protocol p>
-Request<p>& Request<p>::onBodyChunk(BodyChunkCallback callback) {
+Request<p>& Request<p>::onBodyChunk(InplaceCallback<BodyChunkCallback> callback) {
   m_bodyChunkCallback = std::move(callback);
 
   return *this;
 }
 
 template <Protocol p>
-Request<p>& Request<p>::onTimeout(TimeoutCallback callback) {
+Request<p>& Request<p>::onBodySpan(InplaceCallback<BodySpanCallback> callback) {
+  m_bodySpanCallback = std::move(callback);
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::readBodyInto(InplaceCallback<BodyBufferProvider> provider, InplaceCallback<BodyDataCallback> callback) {
+  assert(!m_pullMode);
+
+  m_bodyBufferProvider = std::move(provider);
+  m_bodyDataCallback = std::move(callback);
+  m_fileSink = nullptr;
+  m_decoding = false; // given as it is received, even if called from the header callback
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::bodyToFile(std::shared_ptr<FileSink> sink) {
+  auto& sinkRef = *sink;
+
+  readBodyInto([&sinkRef](std::size_t) { return sinkRef.buffer(); }, nullptr);
+
+  m_fileSink = std::move(sink);
+
+  return *this;
+}
+
+template <Protocol p>
+Request<p>& Request<p>::onTimeout(InplaceCallback<TimeoutCallback> callback) {
   m_timeoutCallback = std::move(callback);
 
   return *this;
@@ -88,341 +256,1600 @@ template <Protocol p>
 void Request<p>::start() {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::start";
 
-  // start the timeout
-  m_timedOut = false;
-  m_timeoutTimer.expires_from_now(m_timeout);
-  m_timeoutTimer.async_wait(std::bind(&Request<p>::onTimeout_, this, _1));
+  prepare_();
+
+  m_timing.started = Timing::Clock::now();
+  m_timing.sent = m_timing.firstByte = m_timing.header = m_timing.end = Timing::Clock::time_point{};
+
+  if (const auto hedged = m_hedgeOf.lock())
+    hedged->armHedge_();
 
   std::ostream os(&m_recvBuf);
 
   os << "GET " << m_resource << " HTTP/1.1\r\n"
-     << "Host: " << m_host << "\r\n"
+     << "Host: " << m_host << "\r\n";
                                        //         << "Connection: close\r\n"
-                                       "\r\n";
+
+  if (m_decompress && !m_bodyBufferProvider)
+    os << "Accept-Encoding: " << ContentDecoder::acceptEncoding() << "\r\n";
+
+  if (m_ranged) {
+    os << "Range: bytes=" << m_rangeFirst << '-';
+
+    if (m_rangeLast != std::numeric_limits<std::uint64_t>::max())
+      os << m_rangeLast;
+
+    os << "\r\n";
+  }
+
+  if (m_cacheEntry) { // revalidate the stale entry
+    if (!m_cacheEntry->etag.empty())
+      os << "If-None-Match: " << m_cacheEntry->etag << "\r\n";
+
+    if (!m_cacheEntry->lastModified.empty())
+      os << "If-Modified-Since: " << m_cacheEntry->lastModified << "\r\n";
+  }
+
+  os << "\r\n";
 
   if (const auto client = m_client.lock()) {
-    async_write(client->connection().socket(), m_recvBuf, std::bind(&Request<p>::onRequestSent_, this, _1, _2));
+    async_write(client->connection().socket(), m_recvBuf,
+                makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec, std::size_t bt) {
+                  onRequestSent_(ec, bt);
+                }));
   } else {
     tryCompleteRequest(error::canceled);
   }
 }
 
 template <Protocol p>
-void Request<p>::headerCompleted(const ErrorCode& ec, const Header& header) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::headerCompleted ec: " << ec;
+void Request<p>::prepare_() {
+  m_bodyStalled = false;
+  m_bodyDestination = asio::mutable_buffer{};
+  m_bodySpanKept.clear();
+  m_decoding = false;
+  m_decodedBuf.consume(m_decodedBuf.size());
+  m_decodeLeft = 0;
+  m_decodeMore = false;
+  m_cacheStore = nullptr;
+  m_cacheBody = nullptr;
+  m_replaying = false;
+  m_detached = false;
+  m_following = false;
+  m_answered = false;
+
+  // start the timeout, in place of the wait for the deadline
+  m_queued = false;
+  m_timedOut = false;
+  m_timeoutTimer.expires_from_now(timeLeft_());
+  m_timeoutTimer.async_wait(makeAllocHandler(m_handlerMemory, [this](const ErrorCode& ec) { onTimeout_(ec); }));
+}
 
-  if (!ec) {
-    if (m_headerCallback) {
-      m_headerCallback(ec, header);
-//      m_headerCallback = nullptr;
-    }
-  } else {// clear out other callbacks if there is an error (they will not be called in that case)
-    tryCompleteRequest(ec);
+template <Protocol p>
+bool Request<p>::armDeadline_() {
+  m_queued = false;
+  m_expired = false;
+
+  if (m_deadline == std::chrono::steady_clock::time_point{})
+    return true;
+
+  if (deadlinePassed_()) { // the budget is spent before the request is sent
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::armDeadline_ passed";
+
+    expire_();
+
+    return false;
   }
+
+  m_queued = true;
+
+  m_timeoutTimer.expires_from_now(timeLeft_());
+  m_timeoutTimer.async_wait(makeAllocHandler(m_handlerMemory, [self = std::weak_ptr<Request<p>>{this->shared_from_this()}](
+                                                                  const ErrorCode& ec) {
+    const auto request = self.lock();
+
+    if (!ec && request && request->m_queued)
+      request->expire_();
+  }));
+
+  return true;
 }
 
 template <Protocol p>
-void Request<p>::bodyChunkCompleted(const ErrorCode& ec, std::size_t chunkSize) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::bodyChunkCompleted ec: " << ec
-                           << ", chunk size: " << chunkSize;
+void Request<p>::expire_() {
+  if (m_expired)
+    return;
 
-  if (!ec) {// no error
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::expire_";
 
-    // call the chunk callback if it exists
-    if (m_bodyChunkCallback) {
-      std::istream is{&m_recvBuf};
+  m_queued = false;
+  m_expired = true;
+  m_timeoutTimer.cancel();
 
-      m_bodyChunkCallback(ec, is, chunkSize);
-    } else {
-      m_recvBuf.consume(chunkSize);
-    }
+  // not completed in place, the client may hold its queue lock
+  asio::post(m_timeoutTimer.get_executor(), makeAllocHandler(m_handlerMemory, [self = this->shared_from_this()]() {
+               if (self->m_timeoutCallback)
+                 self->m_timeoutCallback();
 
-    if (chunkSize == 0) { // it was last chunk
-//      m_bodyChunkCallback = nullptr;
+               self->finish(error::timeout);
+             }));
+}
 
-      tryCompleteRequest(ec);
-    }
+template <Protocol p>
+bool Request<p>::deadlinePassed_() const {
+  return m_deadline != std::chrono::steady_clock::time_point{} && std::chrono::steady_clock::now() >= m_deadline;
+}
 
-  } else { // error
-//    m_bodyChunkCallback = nullptr;
+template <Protocol p>
+boost::posix_time::time_duration Request<p>::timeLeft_() const {
+  if (m_deadline == std::chrono::steady_clock::time_point{})
+    return m_timeout;
 
-    tryCompleteRequest(ec);
-  }
+  const auto left = std::chrono::duration_cast<std::chrono::microseconds>(m_deadline - std::chrono::steady_clock::now());
+
+  return std::min<boost::posix_time::time_duration>(m_timeout, boost::posix_time::microseconds(std::max<std::int64_t>(left.count(), 0)));
 }
 
 template <Protocol p>
-void Request<p>::timeoutCompleted(const ErrorCode& ec) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::timeoutCompleted ec: " << ec;
+bool Request<p>::tryRetry_(const ErrorCode& ec) {
+  // a response given to the callbacks, even in part, can not be taken back
+  if (m_answered || m_following || m_replaying || m_hedgePolicy || !m_hedgeOf.expired() || m_hedgeLost)
+    return false;
 
-  if (!ec) { // if timeout actually occurred
-    if (m_timeoutCallback) {
-      m_timeoutCallback();
+  const auto client = m_client.lock();
+  const auto policy = client ? client->retrying() : nullptr;
 
-//      m_timeoutCallback = nullptr;
-    }
+  if (!policy || !(ec ? policy->retryable(ec) : policy->retryable(m_header.status())))
+    return false;
 
-    completeRequest(error::timeout);
-  }
+  const auto retryAfter = ec ? boost::string_view{} : m_header.field(FieldId::RetryAfter).value_or(boost::string_view{});
+  const auto delay = policy->delay(m_retries, retryAfter);
+
+  if (delay == RetryPolicy::Clock::duration::max()) // asked to wait for too long
+    return false;
+
+  if (m_deadline != std::chrono::steady_clock::time_point{} && std::chrono::steady_clock::now() + delay >= m_deadline)
+    return false;
+
+  if (!policy->tryRetry(m_retries))
+    return false;
+
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::tryRetry_ ec: " << ec << ", retries: " << m_retries;
+
+  m_retrying = true;
+  m_retryDelay = delay;
+
+  return true;
 }
 
 template <Protocol p>
-void Request<p>::tryCompleteRequest(const ErrorCode& ec) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::tryCompleteRequest ec: " << ec;
+void Request<p>::retryLater_() {
+  m_retrying = false;
+  ++m_retries;
 
-  // no timeout callback should access members of 'this' in case of error (e.g. cancel)
-  // therefore we must be sure we successfully cancelled the handlers
-  // or else let the timeout happen
+  const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(m_retryDelay);
 
-  if (cancelTimeouts()) {
-    completeRequest(ec);
-  }
+  m_timeoutTimer.expires_from_now(boost::posix_time::microseconds(delay.count()));
+  m_timeoutTimer.async_wait(makeAllocHandler(m_handlerMemory, [self = std::weak_ptr<Request<p>>{this->shared_from_this()}](
+                                                                  const ErrorCode& ec) {
+    const auto request = self.lock();
+
+    if (ec || !request)
+      return;
+
+    const auto client = request->m_client.lock();
+
+    if (!client)
+      request->finish(error::canceled);
+    else if (request->armDeadline_())
+      client->enqueue_(request);
+  }));
 }
 
 template <Protocol p>
-void Request<p>::completeRequest(const ErrorCode& ec) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::completeRequest ec: " << ec;
+bool Request<p>::lookupCache_() {
+  m_cacheEntry = nullptr;
 
-  if (const auto client = m_client.lock()) {
-    // notify the client request has completed
-    client->requestCompleted(ec);
+  if (!m_cache || m_ranged)
+    return false;
+
+  m_cacheKey.assign(p == Protocol::HTTPS ? "https://" : "http://").append(m_host).append(m_resource);
+
+  std::shared_ptr<const Cache::Entry> entry;
+
+  // a compressed body can only be given to a request that decompresses
+  const auto lookup = m_cache->find(m_cacheKey, m_decompress && !m_bodyBufferProvider, entry);
+
+  if (lookup == Cache::Lookup::Miss)
+    return false;
+
+  if (lookup == Cache::Lookup::Stale) {
+    if (entry->revalidatable())
+      m_cacheEntry = std::move(entry);
+
+    return false;
   }
 
-  finish(ec);
-  // no more operations below this point as clearing complete callback may have removed the request
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::lookupCache_ fresh";
+
+  m_cacheEntry = std::move(entry);
+
+  asio::post(m_timeoutTimer.get_executor(), makeAllocHandler(m_handlerMemory, [self = this->shared_from_this()]() {
+               self->prepare_();
+               self->m_detached = true;
+               self->replay_();
+             }));
+
+  return true;
 }
 
 template <Protocol p>
-void Request<p>::tryFinish(const ErrorCode& ec) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::tryFinish ec: " << ec;
+void Request<p>::replay_() {
+  const auto& entry = *m_cacheEntry;
+  const auto age = std::chrono::duration_cast<std::chrono::seconds>(entry.age(Cache::Clock::now()));
+  const auto framing =
+      "Content-Length: " + std::to_string(entry.body.size()) + "\r\nAge: " + std::to_string(age.count()) + "\r\n\r\n";
 
-  // no timeout callback should access members of 'this' in case of error (e.g. cancel)
-  // therefore we must be sure we successfully cancelled the handlers
-  // or else let the timeout happen
+  m_replaying = true;
+  m_replayOffset = 0;
 
-  if (cancelTimeouts()) {
-    finish(ec);
-    // no more operations below this point as clearing complete callback may have removed the request
+  m_recvBuf.consume(m_recvBuf.size());
+  m_header.reset();
+  m_parser.reset();
+
+  const auto data = m_header.prepare(entry.header.size() + framing.size());
+
+  std::copy(framing.begin(), framing.end(), std::copy(entry.header.begin(), entry.header.end(), data));
+  m_header.commit(entry.header.size() + framing.size());
+
+  if (m_parser.parse(m_header) != ResponseParser::Result::Complete) {
+    headerCompleted(error::headerParse, m_header);
+
+    return;
   }
+
+  startBody_();
 }
 
 template <Protocol p>
-void Request<p>::finish(const ErrorCode& ec) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::finish ec: " << ec;
+void Request<p>::replayBody_() {
+  const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(m_bodyLeft, m_bodySliceSize));
+  const auto data = m_cacheEntry->body.data() + m_replayOffset;
 
-  if (m_completeCallback) {
-    m_completeCallback(ec);
+  m_replayOffset += size;
+  m_bodyLeft -= size;
 
-    // NOTE! assigning nullptr here causes double destruction of the callback object
-    // because removal of the callback may trigger object destruction again
-    // clear the callback
-    m_completeCallback = [](const ErrorCode& ec){};
+  if (!m_followers.empty())
+    fanOut_(data, size);
 
-    // no more operations below this point as clearing complete callback may have removed the request
+  deliverView_(data, size);
+
+  // continued like after a read, a large body does not recurse
+  asio::post(m_timeoutTimer.get_executor(),
+             makeAllocHandler(m_handlerMemory, [self = this->shared_from_this()]() { self->streamBody_(); }));
+}
+
+template <Protocol p>
+void Request<p>::deliverView_(const char* data, std::size_t size) {
+  if (m_bodySpanCallback) {
+    bodySpanReceived_(data, size);
+  } else if (m_bodyChunkCallback) {
+    ViewStreambuf buf{data, size};
+    std::istream is{&buf};
+
+    m_bodyChunkCallback(error::success, is, size);
   }
 }
 
 template <Protocol p>
-bool Request<p>::cancelTimeouts() {
-  const auto waitersCancelled = m_timeoutTimer.cancel();
+void Request<p>::attach_(std::shared_ptr<Request<p>> follower) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::attach_ " << follower.get();
 
-  assert(waitersCancelled <= 1); // there can be at most one waiter
+  follower->prepare_();
+  follower->m_detached = true;
+  follower->m_following = true;
+  follower->m_cacheEntry = nullptr;
 
-  return waitersCancelled > 0;
+  m_followers.push_back(std::move(follower));
 }
 
 template <Protocol p>
-void Request<p>::onRequestSent_(const ErrorCode& ec, std::size_t bt) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onRequestSent_ ec: " << ec;
+void Request<p>::stopLeading_() {
+  m_leading = false;
 
-  if (!ec) {
-    if (const auto client = m_client.lock()) {
-      async_read_until(client->connection().socket(), m_recvBuf, "\r\n\r\n",
-                       std::bind(&Request<p>::onHeaderReceived_, this, _1, _2));
-    } else {
-      tryCompleteRequest(error::canceled);
-    }
-  } else {
-    tryCompleteRequest(ec);
+  if (const auto client = m_client.lock())
+    client->leaderDone_(m_coalescingKey, this);
+}
+
+template <Protocol p>
+void Request<p>::fanOut_(const char* data, std::size_t size) {
+  // a follower may complete on its own, e.g. on its timeout
+  for (const auto& follower : m_followers) {
+    if (follower->m_following)
+      follower->deliverView_(data, size);
   }
 }
 
 template <Protocol p>
-void Request<p>::onHeaderReceived_(const ErrorCode& ec, std::size_t bt) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onHeaderReceived_ ec: " << ec;
+void Request<p>::hedge_(ClientImpl<p>& client) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::hedge_";
 
-  std::istream is{&m_recvBuf};
+  prepare_();
+  m_detached = true;
+  m_cacheEntry = nullptr;
 
-  try {
-    if (!ec) {
-      const auto headerSize = bt - 2; // do not include header end
+  m_hedgePolicy = client.hedging();
+  m_hedgePolicy->requested();
+  m_hedgeWinner = nullptr;
+  m_hedgeArmed = false;
 
-      m_header.reset();
-      m_header.load(is, headerSize);
+  attempt_(client);
+}
 
-      // consume the extra \r\n
-      m_recvBuf.consume(2);
+template <Protocol p>
+void Request<p>::attempt_(ClientImpl<p>& client) {
+  auto attempt = client.get(m_resource);
 
-      if (const auto transferEncoding = m_header.field("transfer-encoding")) { // check if chunked
+  attempt->decompress(m_decompress).timeout(m_timeout).deadline(m_deadline).bodySliceSize(m_bodySliceSize).maxBufferSize(m_maxBufferSize);
 
-        // read the chunk size
-        if (const auto client = m_client.lock()) {
-          async_read_until(client->connection().socket(), m_recvBuf, "\r\n",
-                           std::bind(&Request<p>::onChunkSizeReceived_, this, _1, _2));
+  if (m_ranged)
+    attempt->range(m_rangeFirst, m_rangeLast);
 
-          headerCompleted(ec, m_header);
-        } else {
-          headerCompleted(error::canceled, m_header);
-        }
+  attempt->m_hedgeOf = this->shared_from_this();
+  attempt->m_hedgeAttempt = !m_attempts.empty();
 
-      } else if (const auto contentLengthIt = m_header.field("content-length")) { // if content-length exists
+  // lives until it completes, or until it is abandoned before it is sent
+  attempt->onComplete([attempt](const ErrorCode&) { });
 
-        const auto contentLengthLength = std::distance(contentLengthIt->first, contentLengthIt->second);
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::attempt_ " << attempt.get();
 
-        if (contentLengthLength <= MaxRecvbufSize) { // check content-length header
-          std::array<char, std::numeric_limits<unsigned long long>::digits10 + 1> contentLengthStr;
-          std::copy(contentLengthIt->first, contentLengthIt->second, contentLengthStr.begin());
-          contentLengthStr[contentLengthLength] = 0;
+  if (!attempt->armDeadline_()) // fails this request once it completes
+    return;
 
-          const std::size_t contentLength = std::stoul(contentLengthStr.data());
+  m_attempts.push_back(attempt);
+  client.enqueue_(std::move(attempt));
+}
 
-          const auto bytesLeftToReceive = contentLength - std::min(contentLength, m_recvBuf.size());
+template <Protocol p>
+void Request<p>::armHedge_() {
+  if (m_hedgeArmed || !m_hedgePolicy)
+    return;
 
-          TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onHeaderReceived_ bytesLeftToReceive: " << bytesLeftToReceive;
+  m_hedgeArmed = true;
+  m_hedgeStartedAt = std::chrono::steady_clock::now();
 
-          if (const auto client = m_client.lock()) {
-            async_read(client->connection().socket(), m_recvBuf.prepare(bytesLeftToReceive),
-                       std::bind(&Request<p>::onBodyReceived_, this, _1, _2));
+  const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(m_hedgePolicy->delay());
 
-            headerCompleted(ec, m_header);
-          } else {// no client any more
-            headerCompleted(error::canceled, m_header);
-          }
-        } else { // too big content-length
-          headerCompleted(error::fileTooLarge, m_header);
-        }
+  m_hedgeTimer.expires_from_now(boost::posix_time::microseconds(delay.count()));
+  m_hedgeTimer.async_wait(makeAllocHandler(m_handlerMemory, [self = std::weak_ptr<Request<p>>{this->shared_from_this()}](
+                                                                const ErrorCode& ec) {
+    if (const auto request = self.lock())
+      request->onHedgeTimer_(ec);
+  }));
+}
 
-      } else { // no content-length field in header
+template <Protocol p>
+void Request<p>::onHedgeTimer_(const ErrorCode& ec) {
+  if (ec || !m_hedgePolicy || m_hedgeWinner || m_attempts.size() != 1)
+    return;
 
-        // assume connection close is body end
-        if (const auto client = m_client.lock()) {
-          async_read(client->connection().socket(), m_recvBuf, std::bind(&Request<p>::onBodyReceived_, this, _1, _2));
+  const auto client = m_client.lock();
 
-          headerCompleted(ec, m_header);
-        } else {// no client any more
-          headerCompleted(error::canceled, m_header);
-        }
+  if (!client || !m_hedgePolicy->tryHedge())
+    return;
 
-      }
-    } else { // ec exists
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onHedgeTimer_ hedging";
 
-      headerCompleted(ec, m_header);
+  attempt_(client->hedgeClient_());
+}
 
-    }
-  } catch (const std::exception& e) {
+template <Protocol p>
+void Request<p>::hedgeWon_(Request<p>& attempt) {
+  if (!m_hedgePolicy || m_hedgeWinner)
+    return;
 
-    headerCompleted(error::headerParse, m_header);
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::hedgeWon_ " << &attempt;
 
+  m_hedgeWinner = &attempt;
+  m_hedgeTimer.cancel();
+  m_hedgePolicy->answered(std::chrono::steady_clock::now() - m_hedgeStartedAt, attempt.m_hedgeAttempt);
+
+  m_following = true;
+  attempt.m_followers.push_back(this->shared_from_this());
+
+  const auto attempts = std::move(m_attempts);
+
+  m_attempts.clear();
+
+  for (const auto& weak : attempts) {
+    if (const auto other = weak.lock()) {
+      if (other.get() == &attempt)
+        m_attempts.push_back(other);
+      else
+        other->abandon_();
+    }
   }
 }
 
 template <Protocol p>
-void Request<p>::onBodyReceived_(const ErrorCode& ec, std::size_t bt) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onBodyReceived_ ec: " << ec;
+void Request<p>::attemptDone_(const Request<p>& attempt, const ErrorCode& ec) {
+  m_attempts.erase(std::remove_if(m_attempts.begin(), m_attempts.end(),
+                                  [&attempt](const std::weak_ptr<Request<p>>& weak) {
+                                    const auto other = weak.lock();
+
+                                    return !other || other.get() == &attempt;
+                                  }),
+                   m_attempts.end());
+
+  // the winner completes this request as its follower; a failed one leaves it to the others
+  if (!m_hedgeWinner && m_attempts.empty() && m_hedgePolicy)
+    tryCompleteRequest(ec ? ec : error::canceled);
+}
+
+template <Protocol p>
+void Request<p>::abandon_() {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::abandon_";
 
-  m_recvBuf.commit(bt);
+  m_hedgeOf.reset();
 
-  if (!ec) {
-    bodyChunkCompleted(ec, bt);
-    bodyChunkCompleted(ec, 0);
-  } else {
-    bodyChunkCompleted(ec, bt);
+  if (m_timing.started == Timing::Clock::time_point{}) { // still queued, its client skips it once it is gone
+    // the callback holds the last reference to this request
+    m_completeCallback = nullptr;
+
+    return;
+  }
+
+  m_hedgeLost = true;
+
+  // the response can only be stopped with its connection; the read fails and completes the request
+  if (const auto client = m_client.lock()) {
+    ErrorCode ignored;
+
+    client->connection().socket().lowest_layer().close(ignored);
   }
 }
 
 template <Protocol p>
-void Request<p>::onTimeout_(const ErrorCode& ec) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onTimeout_ ec: " << ec;
+void Request<p>::cacheBody_(const char* data, std::size_t size) {
+  if (m_cacheBody->size() + size > m_cache->maxEntrySize()) { // too large to be cached
+    m_cacheStore = nullptr;
+    m_cacheBody = nullptr;
 
-  if (!ec) {
-    m_timedOut = true;
+    return;
   }
 
-  timeoutCompleted(ec);
+  m_cacheBody->append(data, size);
 }
 
 template <Protocol p>
-void Request<p>::onChunkSizeReceived_(const ErrorCode& ec, std::size_t bt) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onChunkSizeReceived_ ec: " << ec;
-
-  if (!ec) {
-    // move the chunk size data to input sequence
-    std::istream is{&m_recvBuf};
+ContentDecoder& Request<p>::contentDecoder_(ClientImpl<p>& client) {
+  if (!m_detached)
+    return client.connection().contentDecoder();
 
-    // read the chunk size
-    std::size_t chunkSize;
-    is >> std::hex >> chunkSize;
+  if (!m_contentDecoder)
+    m_contentDecoder.reset(new ContentDecoder);
 
-    // skip \r\n
-    is.ignore(2);
+  return *m_contentDecoder;
+}
 
-    const auto totalChunkSize = chunkSize + 2; // assume chunk size includes the \r\n
+template <Protocol p>
+void Request<p>::headerCompleted(const ErrorCode& ec, const Header& header) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::headerCompleted ec: " << ec;
 
-    const auto alreadyInBuffer = m_recvBuf.size();
+  if (m_leading)
+    stopLeading_();
 
-    // maximum receive buf size is exceeded (a chunk is held at a time here)
-    if (alreadyInBuffer + chunkSize <= MaxRecvbufSize) {
-      const auto chunkBytesLeftToReceive =
-          totalChunkSize -
-          std::min(totalChunkSize,
-                   alreadyInBuffer); /* extract the already fetched part (by async_read_until before coming here) */
+  if (!ec) {
+    m_answered = true;
 
-      TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onChunkSizeReceived_ " << alreadyInBuffer << '-'
-                                         << totalChunkSize << '-' << chunkBytesLeftToReceive;
+    if (const auto hedged = m_hedgeOf.lock())
+      hedged->hedgeWon_(*this);
 
-      if (const auto client = m_client.lock()) {
-        async_read(client->connection().socket(), m_recvBuf.prepare(chunkBytesLeftToReceive),
-                   std::bind(&Request<p>::onChunkDataReceived_, this, _1, _2, chunkSize));
-      } else {
-        tryCompleteRequest(error::canceled);
+    for (const auto& follower : m_followers) {
+      if (follower->m_following) {
+        follower->m_header = header;
+        follower->headerCompleted(ec, follower->m_header);
       }
+    }
 
-    } else { // max recvbuf size exceeded
+    if (m_headerCallback) {
+      m_headerCallback(ec, header);
+//      m_headerCallback = nullptr;
+    }
+
+    if (m_pullHeaderHandler) {
+      auto handler = std::move(m_pullHeaderHandler);
+
+      handler(error::success); // posted to its executor
+    }
+  } else {// clear out other callbacks if there is an error (they will not be called in that case)
+    tryCompleteRequest(ec);
+  }
+}
+
+template <Protocol p>
+void Request<p>::bodyChunkCompleted(const ErrorCode& ec, std::size_t chunkSize) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::bodyChunkCompleted ec: " << ec
+                           << ", chunk size: " << chunkSize;
+
+  if (!ec) {// no error
+
+    if (m_cacheStore && chunkSize > 0)
+      cacheBody_(static_cast<const char*>(m_recvBuf.data().data()), chunkSize);
+
+    if (m_decoding) {
+      if (!decodeBody_(chunkSize))
+        return;
+    } else {
+      deliverBody_(m_recvBuf, chunkSize);
+    }
+
+    if (chunkSize == 0) { // it was last chunk
+      if (m_cacheStore) {
+        m_cacheStore->body = *m_cacheBody;
+        m_cacheStore->bodyOwner = std::move(m_cacheBody);
+
+        m_cache->store(m_cacheKey, std::move(m_cacheStore));
+      }
+
+//      m_bodyChunkCallback = nullptr;
+
+      tryCompleteRequest(ec);
+    }
+
+  } else { // error
+//    m_bodyChunkCallback = nullptr;
+
+    tryCompleteRequest(ec);
+  }
+}
+
+template <Protocol p>
+void Request<p>::deliverBody_(boost::asio::streambuf& buf, std::size_t size) {
+  if (!m_followers.empty() && (size == 0 || !m_bodyBufferProvider))
+    fanOut_(static_cast<const char*>(buf.data().data()), size);
+
+  if (m_pullMode) { // leave the chunk in the buffer for asyncReadSome()
+    m_pullAvailable += size;
+  } else if (m_bodyBufferProvider) { // the data is given by bodyDataReceived_(), only the end comes here
+    assert(size == 0);
+
+    if (m_fileSink) {
+      const auto sinkEc = m_fileSink->flush();
+
+      if (sinkEc) {
+        tryCompleteRequest(sinkEc);
+
+        return;
+      }
+    }
+
+    if (m_bodyDataCallback)
+      m_bodyDataCallback(error::success, asio::mutable_buffer{});
+  } else if (m_bodySpanCallback) {
+    bodySpanReceived_(static_cast<const char*>(buf.data().data()), size);
+
+    buf.consume(size);
+  } else if (m_bodyChunkCallback) { // call the chunk callback if it exists
+    std::istream is{&buf};
+
+    m_bodyChunkCallback(error::success, is, size);
+  } else {
+    buf.consume(size);
+  }
+}
+
+template <Protocol p>
+bool Request<p>::decodeBody_(std::size_t size) {
+  if (size == 0) { // the end of the body
+    const auto client = m_client.lock();
+
+    if (!client) {
+      tryCompleteRequest(error::canceled);
+
+      return false;
+    }
+
+    if (!contentDecoder_(*client).finished()) { // truncated
+      tryCompleteRequest(error::contentDecode);
+
+      return false;
+    }
+
+    deliverBody_(m_decodedBuf, 0);
+
+    return true;
+  }
+
+  m_decodeLeft = size;
+  m_decodeMore = true;
+
+  return decodeSlice_();
+}
+
+template <Protocol p>
+bool Request<p>::decodeSlice_() {
+  const auto client = m_client.lock();
+
+  if (!client) {
+    tryCompleteRequest(error::canceled);
+
+    return false;
+  }
+
+  auto& decoder = contentDecoder_(*client);
+
+  for (;;) {
+    if (m_pullMode) { // held until the reader consumes a slice, a highly compressed body must not grow it unbounded
+      m_pullAvailable = m_decodedBuf.size();
+
+      if (m_decodedBuf.size() >= m_bodySliceSize)
+        return true;
+    } else { // given in slices as it is decoded, the rest is kept while paused
+      while (m_decodedBuf.size() > 0 && !m_paused)
+        deliverBody_(m_decodedBuf, std::min(m_decodedBuf.size(), m_bodySliceSize));
+
+      if (m_paused)
+        return true;
+    }
+
+    if (!m_decodeMore)
+      return true;
+
+    const auto inBegin = static_cast<const char*>(m_recvBuf.data().data());
+    const auto inEnd = inBegin + m_decodeLeft;
+    auto in = inBegin;
+
+    const auto room = m_decodedBuf.prepare(DecodeSize);
+    const auto outBegin = static_cast<char*>(room.data());
+    const auto outEnd = outBegin + room.size();
+    auto out = outBegin;
+
+    const auto result = decoder.decode(in, inEnd, out, outEnd);
+
+    m_decodedBuf.commit(out - outBegin);
+
+    if (result == ContentDecoder::Result::Error) {
+      tryCompleteRequest(error::contentDecode);
+
+      return false;
+    }
+
+    m_recvBuf.consume(in - inBegin);
+    m_decodeLeft -= in - inBegin;
+
+    if (result == ContentDecoder::Result::End) { // anything after the end of the compressed stream is dropped
+      m_recvBuf.consume(m_decodeLeft);
+      m_decodeLeft = 0;
+      m_decodeMore = false;
+    } else if (m_decodeLeft == 0 && out != outEnd) { // the decoder needs more input, it has not filled the output
+      m_decodeMore = false;
+    }
+  }
+}
+
+template <Protocol p>
+void Request<p>::timeoutCompleted(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::timeoutCompleted ec: " << ec;
+
+  if (!ec) { // if timeout actually occurred
+    if (m_timeoutCallback) {
+      m_timeoutCallback();
+
+//      m_timeoutCallback = nullptr;
+    }
+
+    const auto client = m_client.lock();
+
+    if (client && !m_detached) {
+      // the operation running on the connection fails once it is closed; completed after it, as the request
+      // may be destroyed on completion
+      ErrorCode ignored;
+
+      client->connection().socket().lowest_layer().close(ignored);
+
+      asio::post(m_timeoutTimer.get_executor(), makeAllocHandler(m_handlerMemory, [self = this->shared_from_this()]() {
+                   self->completeRequest(error::timeout);
+                 }));
+
+      return;
+    }
+
+    completeRequest(error::timeout);
+  }
+}
+
+template <Protocol p>
+void Request<p>::tryCompleteRequest(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::tryCompleteRequest ec: " << ec;
+
+  // no timeout callback should access members of 'this' in case of error (e.g. cancel)
+  // therefore we must be sure we successfully cancelled the handlers
+  // or else let the timeout happen
+
+  if (cancelTimeouts()) {
+    completeRequest(ec);
+  }
+}
+
+template <Protocol p>
+void Request<p>::completeRequest(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::completeRequest ec: " << ec;
+
+  if (const auto client = m_client.lock()) {
+    // notify the client request has completed
+    if (!m_detached)
+      client->requestCompleted(ec);
+  }
+
+  finish(ec);
+  // no more operations below this point as clearing complete callback may have removed the request
+}
+
+template <Protocol p>
+void Request<p>::tryFinish(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::tryFinish ec: " << ec;
+
+  // no timeout callback should access members of 'this' in case of error (e.g. cancel)
+  // therefore we must be sure we successfully cancelled the handlers
+  // or else let the timeout happen
+
+  if (cancelTimeouts()) {
+    finish(ec);
+    // no more operations below this point as clearing complete callback may have removed the request
+  }
+}
+
+template <Protocol p>
+void Request<p>::finish(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::finish ec: " << ec;
+
+  releaseMemory_();
+
+  if (m_queued) { // completed by its client before it is started
+    m_queued = false;
+    m_timeoutTimer.cancel();
+  }
+
+  if (m_retrying || (ec && tryRetry_(ec))) {
+    retryLater_();
+
+    return;
+  }
+
+  m_timing.end = Timing::Clock::now();
+
+  if (!ec && m_timing.header != Timing::Clock::time_point{})
+    m_metrics->bodyLatency(m_timing.end - m_timing.header);
+
+  if (m_pending) {
+    m_pending = false;
+    m_metrics->completed(ec);
+  }
+
+  m_following = false;
+
+  if (m_leading)
+    stopLeading_();
+
+  if (const auto hedged = m_hedgeOf.lock()) {
+    m_hedgeOf.reset();
+
+    hedged->attemptDone_(*this, ec);
+  }
+
+  if (m_hedgePolicy) { // the attempts still running are of no use any more
+    m_hedgePolicy = nullptr;
+    m_hedgeTimer.cancel();
+
+    const auto attempts = std::move(m_attempts);
+
+    m_attempts.clear();
+
+    for (const auto& weak : attempts) {
+      if (const auto attempt = weak.lock())
+        attempt->abandon_();
+    }
+  }
+
+  if (!m_followers.empty()) { // the attached requests complete with this one
+    const auto followers = std::move(m_followers);
+
+    m_followers.clear();
+
+    for (const auto& follower : followers) {
+      if (follower->m_following)
+        follower->tryCompleteRequest(ec);
+    }
+  }
+
+  if (m_pullMode) {
+    m_pullEnd = true;
+    m_pullResume = false;
+    m_pullError = ec;
+
+    if (m_pullHeaderHandler) { // failed before the header is received
+      auto handler = std::move(m_pullHeaderHandler);
+
+      handler(ec); // posted to its executor
+    }
+
+    servePull_();
+  }
+
+  if (m_completeCallback) {
+    m_completeCallback(ec);
+
+    // NOTE! assigning nullptr here causes double destruction of the callback object
+    // because removal of the callback may trigger object destruction again
+    // clear the callback
+    m_completeCallback = [](const ErrorCode& ec){};
+
+    // no more operations below this point as clearing complete callback may have removed the request
+  }
+}
+
+template <Protocol p>
+void Request<p>::pull(PullHeaderHandler handler) {
+  m_pullMode = true;
+  m_pullHeaderHandler = std::move(handler);
+}
+
+template <Protocol p>
+void Request<p>::servePull_() {
+  if (!m_pullReadHandler)
+    return;
+
+  if (m_pullAvailable > 0) {
+    auto& buf = bodyBuf_();
+    const auto bytesRead = asio::buffer_copy(m_pullBuffer, buf.data(), m_pullAvailable);
+
+    buf.consume(bytesRead);
+    m_pullAvailable -= bytesRead;
+
+    postPull_(error::success, bytesRead);
+
+    if (m_pullAvailable == 0 && m_pullResume) { // everything is consumed, continue with the body
+      m_pullResume = false;
+
+      continueBody_();
+    }
+  } else if (m_pullEnd) {
+    postPull_(m_pullError ? m_pullError : ErrorCode{asio::error::eof}, 0);
+  }
+}
+
+template <Protocol p>
+void Request<p>::postPull_(const ErrorCode& ec, std::size_t bytesRead) {
+  auto handler = std::move(m_pullReadHandler);
+
+  // posted to the executor of the reader, never called inline; it may resume a coroutine that destroys this request
+  handler(ec, bytesRead);
+}
+
+template <Protocol p>
+bool Request<p>::holdBody_() {
+  if (decodeHeld_() && !decodeSlice_()) // the rest of the slice being decoded comes first
+    return true;
+
+  if (m_pullMode && m_pullAvailable > 0) { // wait for the reader to consume what it has
+    m_pullResume = true;
+
+    servePull_();
+
+    return true;
+  }
+
+  if (m_paused) {
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::holdBody_ paused";
+
+    m_bodyStalled = true;
+
+    return true;
+  }
+
+  return false;
+}
+
+template <Protocol p>
+void Request<p>::continueBody_() {
+  if (m_parser.framing() == ResponseParser::Framing::Chunked)
+    decodeChunks_();
+  else
+    streamBody_();
+}
+
+template <Protocol p>
+bool Request<p>::reserveMemory_(std::size_t size) {
+  if (size > m_maxBufferSize) {
+    tryCompleteRequest(error::fileTooLarge);
+
+    return false;
+  }
+
+  if (m_decoding) // the decoded body is held next to it, see decodeSlice_()
+    size += DecodeSize + (m_pullMode ? m_bodySliceSize : 0);
+
+  if (!m_memoryBudget->fits(size)) {
+    tryCompleteRequest(error::fileTooLarge);
+
+    return false;
+  }
+
+  if (size <= m_memoryReserved) {
+    m_memoryBudget->release(m_memoryReserved - size);
+    m_memoryReserved = size;
+
+    return true;
+  }
+
+  // the waiter may be called on any thread, it only posts to the io_service of this request
+  std::weak_ptr<Request> self = this->shared_from_this();
+
+  if (!m_memoryBudget->tryReserve(size - m_memoryReserved, [self]() {
+        if (const auto request = self.lock()) {
+          asio::post(request->m_timeoutTimer.get_executor(), makeAllocHandler(request->m_handlerMemory, [self]() {
+                       if (const auto request = self.lock())
+                         request->onMemoryAvailable_();
+                     }));
+        }
+      })) {
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::reserveMemory_ waiting for " << size << " bytes";
+
+    m_memoryStalled = true;
+
+    return false;
+  }
+
+  m_memoryReserved = size;
+
+  return true;
+}
+
+template <Protocol p>
+void Request<p>::releaseMemory_() {
+  m_memoryStalled = false;
+
+  m_memoryBudget->release(m_memoryReserved);
+  m_memoryReserved = 0;
+}
+
+template <Protocol p>
+void Request<p>::onMemoryAvailable_() {
+  if (!m_memoryStalled) // finished meanwhile
+    return;
+
+  m_memoryStalled = false;
+
+  continueBody_();
+}
+
+template <Protocol p>
+void Request<p>::decodeChunks_() {
+  for (;;) {
+    if (holdBody_())
+      return;
+
+    if (m_chunkLeft > 0 && m_bodyBufferProvider) { // the data goes to the destination as it comes
+      if (m_recvBuf.size() == 0) {
+        readChunks_();
+
+        return;
+      }
+
+      const auto copied = copyToDestination_(std::min(m_recvBuf.size(), m_chunkLeft));
+
+      if (copied == 0)
+        return;
+
+      m_chunkLeft -= copied;
+
+      if (!bodyDataReceived_(copied))
+        return;
+
+      continue;
+    }
+
+    if (m_chunkLeft > 0) { // the data of the current chunk is at the front of the buffer
+      if (m_recvBuf.size() < m_chunkLeft) {
+        readChunks_();
+
+        return;
+      }
+
+      const auto chunkSize = m_chunkLeft;
+
+      m_chunkLeft = 0;
+
+      bodyChunkCompleted(error::success, chunkSize);
+
+      continue;
+    }
+
+    const auto data = static_cast<const char*>(m_recvBuf.data().data());
+
+    std::size_t consumed;
+    std::uint64_t chunkSize;
+
+    const auto result = m_chunkDecoder.decode(data, data + m_recvBuf.size(), consumed, chunkSize);
+
+    m_recvBuf.consume(consumed);
+
+    switch (result) {
+    case ChunkDecoder::Result::Incomplete:
+      if (m_recvBuf.size() < MaxHeaderSize) { // a size line or a trailer field never gets this long
+        readChunks_();
+      } else {
+        tryCompleteRequest(error::headerParse);
+      }
+      return;
+
+    case ChunkDecoder::Result::Error:
+      tryCompleteRequest(error::headerParse);
+      return;
+
+    case ChunkDecoder::Result::Chunk:
+      // a chunk is held at a time here
+      if (!m_bodyBufferProvider && chunkSize > m_maxBufferSize) {
+        tryCompleteRequest(error::fileTooLarge);
+
+        return;
+      }
+
+      m_chunkLeft = chunkSize;
+      break;
+
+    case ChunkDecoder::Result::Done: // the last chunk
+      bodyChunkCompleted(error::success, 0);
+      return;
+    }
+  }
+}
+
+template <Protocol p>
+void Request<p>::readChunks_() {
+  const auto client = m_client.lock();
+
+  if (!client) {
+    tryCompleteRequest(error::canceled);
+
+    return;
+  }
+
+  if (m_chunkLeft > 0 && m_bodyBufferProvider) { // read the chunk data straight into the destination
+    if (!nextDestination_(m_chunkLeft))
+      return;
+
+    client->connection().socket().async_read_some(
+        asio::buffer(m_bodyDestination, m_chunkLeft),
+        makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec, std::size_t bt) {
+          onChunkDataReceived_(ec, bt);
+        }));
+
+    return;
+  }
+
+  const std::size_t needed = m_chunkLeft > m_recvBuf.size() ? m_chunkLeft - m_recvBuf.size() : 1;
+  const auto room = m_maxBufferSize - std::min(m_maxBufferSize, m_recvBuf.size());
+  const auto readSize = std::max(needed, std::min(room, std::size_t{ChunkReadSize}));
+
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::readChunks_ needed: " << needed;
+
+  if (!reserveMemory_(m_recvBuf.size() + readSize))
+    return;
+
+  // whatever else is already there comes along, the following chunks are then decoded without a read
+  async_read(client->connection().socket(), m_recvBuf.prepare(readSize),
+             asio::transfer_at_least(needed),
+             makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec, std::size_t bt) {
+               onChunkDataReceived_(ec, bt);
+             }));
+}
+
+template <Protocol p>
+void Request<p>::streamBody_() {
+  for (;;) {
+    if (m_bodyLeft == 0 && !decodeHeld_()) { // the whole body is delivered
+      bodyChunkCompleted(error::success, 0);
+
+      return;
+    }
+
+    if (holdBody_())
+      return;
+
+    if (m_recvBuf.size() == 0) {
+      readBody_();
+
+      return;
+    }
+
+    const auto sliceSize =
+        static_cast<std::size_t>(std::min<std::uint64_t>({m_recvBuf.size(), m_bodyLeft, m_bodySliceSize}));
+
+    if (m_bodyBufferProvider) {
+      const auto copied = copyToDestination_(sliceSize);
+
+      if (copied == 0)
+        return;
+
+      m_bodyLeft -= copied;
+
+      if (!bodyDataReceived_(copied))
+        return;
+    } else {
+      m_bodyLeft -= sliceSize;
+
+      bodyChunkCompleted(error::success, sliceSize);
+    }
+  }
+}
+
+template <Protocol p>
+void Request<p>::readBody_() {
+  const auto client = m_client.lock();
+
+  if (!client) {
+    tryCompleteRequest(error::canceled);
+
+    return;
+  }
+
+  if (m_replaying && !m_decoding && !m_pullMode && !m_bodyBufferProvider &&
+      (m_bodySpanCallback || m_bodyChunkCallback)) { // from the cache without a copy
+    replayBody_();
+
+    return;
+  }
+
+  if (m_replaying) { // from the cache
+    const auto size =
+        static_cast<std::size_t>(std::min<std::uint64_t>({m_bodyLeft, m_bodySliceSize, m_maxBufferSize}));
+
+    if (!reserveMemory_(size))
+      return;
+
+    m_recvBuf.commit(asio::buffer_copy(m_recvBuf.prepare(size), asio::buffer(m_cacheEntry->body.data() + m_replayOffset, size)));
+    m_replayOffset += size;
+
+    // continued like after a read, a large body does not recurse
+    asio::post(m_timeoutTimer.get_executor(),
+               makeAllocHandler(m_handlerMemory, [self = this->shared_from_this()]() { self->streamBody_(); }));
+
+    return;
+  }
+
+  if (p == Protocol::HTTP && m_fileSink && m_fileSink->canSplice() && m_followers.empty()) { // from the socket to the file directly
+    // the bytes that came along with the header are written first
+    const auto ec = m_fileSink->flush();
+
+    if (ec) {
+      tryCompleteRequest(ec);
+
+      return;
+    }
+
+    m_bodyDestination = asio::mutable_buffer{};
+    m_cacheStore = nullptr; // the body does not pass through
+
+    spliceBody_();
+
+    return;
+  }
+
+  if (m_bodyBufferProvider) { // read straight into the destination
+    if (!nextDestination_(m_bodyLeft))
+      return;
+
+    client->connection().socket().async_read_some(
+        asio::buffer(m_bodyDestination, static_cast<std::size_t>(std::min<std::uint64_t>(
+                                            m_bodyLeft, std::numeric_limits<std::size_t>::max()))),
+        makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec, std::size_t bt) {
+          onBodyReceived_(ec, bt);
+        }));
+
+    return;
+  }
+
+  const auto readSize =
+      static_cast<std::size_t>(std::min<std::uint64_t>({m_bodyLeft, m_bodySliceSize, m_maxBufferSize}));
+
+  // the receive buffer is empty here
+  if (!reserveMemory_(readSize))
+    return;
+
+  client->connection().socket().async_read_some(
+      m_recvBuf.prepare(readSize),
+      makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec, std::size_t bt) {
+        onBodyReceived_(ec, bt);
+      }));
+}
+
+template <Protocol p>
+bool Request<p>::nextDestination_(std::uint64_t sizeHint) {
+  if (m_bodyDestination.size() == 0) {
+    m_bodyDestination =
+        m_bodyBufferProvider(static_cast<std::size_t>(std::min<std::uint64_t>(sizeHint, std::numeric_limits<std::size_t>::max())));
+
+    if (m_bodyDestination.size() == 0) { // the body does not fit
       tryCompleteRequest(error::fileTooLarge);
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <Protocol p>
+std::size_t Request<p>::copyToDestination_(std::size_t size) {
+  if (!nextDestination_(size))
+    return 0;
+
+  const auto copied = asio::buffer_copy(m_bodyDestination, m_recvBuf.data(), size);
+
+  m_recvBuf.consume(copied);
+
+  return copied;
+}
+
+template <Protocol p>
+void Request<p>::bodySpanReceived_(const char* data, std::size_t size) {
+  if (size == 0) { // the end of the body
+    m_bodySpanKept.clear();
+
+    m_bodySpanCallback(error::success, asio::const_buffer{});
+  } else if (m_bodySpanKept.empty()) { // given straight from the receive buffer
+    const auto consumed = std::min(m_bodySpanCallback(error::success, asio::buffer(data, size)), size);
+
+    m_bodySpanKept.assign(data + consumed, data + size);
+  } else { // only when the callback left some bytes, they are given again together with the new ones
+    m_bodySpanKept.insert(m_bodySpanKept.end(), data, data + size);
+
+    const auto consumed = std::min(m_bodySpanCallback(error::success, asio::buffer(m_bodySpanKept)), m_bodySpanKept.size());
+
+    m_bodySpanKept.erase(m_bodySpanKept.begin(), m_bodySpanKept.begin() + consumed);
+  }
+}
+
+template <Protocol p>
+bool Request<p>::bodyDataReceived_(std::size_t size) {
+  const auto data = asio::buffer(m_bodyDestination, size);
+
+  m_bodyDestination += size;
+
+  if (m_cacheStore)
+    cacheBody_(static_cast<const char*>(data.data()), size);
+
+  if (!m_followers.empty())
+    fanOut_(static_cast<const char*>(data.data()), size);
+
+  if (m_fileSink) {
+    const auto ec = m_fileSink->commit(size);
+
+    if (ec) {
+      tryCompleteRequest(ec);
+
+      return false;
     }
+  }
+
+  if (m_bodyDataCallback)
+    m_bodyDataCallback(error::success, data);
+
+  return true;
+}
+
+template <Protocol p>
+void Request<p>::spliceBody_() {
+  if (const auto client = m_client.lock()) {
+    client->connection().socket().lowest_layer().async_wait(
+        tcp::socket::wait_read, makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec) {
+          onSpliceReady_(ec);
+        }));
+  } else {
+    tryCompleteRequest(error::canceled);
+  }
+}
+
+template <Protocol p>
+void Request<p>::onSpliceReady_(const ErrorCode& ec) {
+  if (ec) {
+    bodyChunkCompleted(ec, 0);
+
+    return;
+  }
+
+  const auto client = m_client.lock();
+
+  if (!client) {
+    tryCompleteRequest(error::canceled);
+
+    return;
+  }
+
+  ErrorCode spliceEc;
+
+  const auto spliced = m_fileSink->splice(client->connection().socket().lowest_layer().native_handle(), m_bodyLeft, spliceEc);
+
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onSpliceReady_ spliced: " << spliced << ", ec: " << spliceEc;
+
+  if (spliceEc == asio::error::would_block) { // woken up without data
+    spliceBody_();
+  } else if (spliceEc) {
+    tryCompleteRequest(spliceEc);
+  } else if (spliced == 0) { // the connection is closed
+    if (m_parser.framing() == ResponseParser::Framing::UntilClose)
+      bodyChunkCompleted(error::success, 0);
+    else
+      bodyChunkCompleted(asio::error::eof, 0);
+  } else {
+    m_bodyLeft -= spliced;
+    m_metrics->received(spliced);
+
+    if (resetNoopTimer_()) // if not reset, let the timeout happen
+      streamBody_();
+  }
+}
+
+template <Protocol p>
+bool Request<p>::resetNoopTimer_() {
+  const auto client = m_client.lock();
+
+  if (!client) {
+    tryCompleteRequest(error::canceled);
+
+    return false;
+  }
+
+  if (!client->connection().stopNoopTimer())
+    return false;
+
+  client->connection().startNoopTimer();
+
+  return true;
+}
+
+template <Protocol p>
+bool Request<p>::cancelTimeouts() {
+  const auto waitersCancelled = m_timeoutTimer.cancel();
+
+  assert(waitersCancelled <= 1); // there can be at most one waiter
+
+  return waitersCancelled > 0;
+}
+
+template <Protocol p>
+void Request<p>::onRequestSent_(const ErrorCode& ec, std::size_t bt) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onRequestSent_ ec: " << ec;
+
+  if (!ec) {
+    m_timing.sent = Timing::Clock::now();
+    m_metrics->sent(bt);
+
+    m_header.reset();
+    m_parser.reset();
+
+    readHeader_();
   } else {
     tryCompleteRequest(ec);
   }
 }
 
 template <Protocol p>
-void Request<p>::onChunkDataReceived_(const ErrorCode& ec, std::size_t bt, std::size_t chunkSize) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onChunkDataReceived_ chunk size: " << chunkSize
-                           << ", ec: " << ec;
+void Request<p>::readHeader_() {
+  if (const auto client = m_client.lock()) {
+    // read straight into the header storage, the parser works on it in place
+    client->connection().socket().async_read_some(
+        asio::buffer(m_header.prepare(HeaderReadSize), HeaderReadSize),
+        makeAllocHandler(m_handlerMemory, [this, hold = client->connection().socketHold()](const ErrorCode& ec, std::size_t bt) {
+          onHeaderReceived_(ec, bt);
+        }));
+  } else {
+    headerCompleted(error::canceled, m_header);
+  }
+}
+
+template <Protocol p>
+void Request<p>::onHeaderReceived_(const ErrorCode& ec, std::size_t bt) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onHeaderReceived_ ec: " << ec;
 
   if (!ec) {
-    // reset the noop timeout on chunk data received
-    if (const auto client = m_client.lock()) {
-      if (client->connection().stopNoopTimer()) {
-        client->connection().startNoopTimer();
+    if (m_timing.firstByte == Timing::Clock::time_point{}) // also of an interim response
+      m_timing.firstByte = Timing::Clock::now();
+
+    m_metrics->received(bt);
+    m_header.commit(bt);
+
+    switch (m_parser.parse(m_header)) {
+    case ResponseParser::Result::Incomplete:
+      if (m_header.size() < MaxHeaderSize)
+        readHeader_();
+      else
+        headerCompleted(error::fileTooLarge, m_header);
+      break;
+
+    case ResponseParser::Result::Error:
+      headerCompleted(error::headerParse, m_header);
+      break;
+
+    case ResponseParser::Result::Complete: {
+      m_timing.header = Timing::Clock::now();
+      m_metrics->headerLatency(m_timing.header - m_timing.started);
 
-        // read the next chunk size
-        if (chunkSize > 0) {
-          m_recvBuf.commit(bt);
+      if (tryRetry_(error::success)) { // given up, the rest of the response is not read
+        tryCompleteRequest(error::unexpectedResponse);
 
-          bodyChunkCompleted(ec, chunkSize);
+        break;
+      }
+
+      // the beginning of the body may have been received along with the header
+      const auto headerLength = m_parser.headerLength();
+      const auto bodyLength = m_header.size() - headerLength;
+
+      m_recvBuf.commit(asio::buffer_copy(m_recvBuf.prepare(bodyLength),
+                                         asio::buffer(m_header.m_data.data() + headerLength, bodyLength)));
+      m_header.truncate(headerLength);
+
+      if (m_cacheEntry && m_header.status() == 304) { // the cached response is still valid
+        const auto client = m_client.lock();
 
-          m_recvBuf.consume(2);
+        if (!client) {
+          headerCompleted(error::canceled, m_header);
 
-          // see if there are more chunks
-          async_read_until(client->connection().socket(), m_recvBuf, "\r\n",
-                           std::bind(&Request<p>::onChunkSizeReceived_, this, _1, _2));
-        } else { // this is the last chunk (empty chunk)
-          bodyChunkCompleted(ec, chunkSize);
+          break;
         }
-      }// if not reset, let the timeout happen
+
+        m_cacheEntry = m_cache->revalidated(m_cacheKey, m_cacheEntry, m_header);
+
+        // the connection is free for the next request while the body is given from the cache
+        m_detached = true;
+        client->requestCompleted(error::success);
+
+        replay_();
+        break;
+      }
+
+      m_cacheEntry = nullptr;
+
+      // the response to a range request is not stored, even if the server sent the whole body
+      if (m_cache && !m_ranged && (m_cacheStore = Cache::entryFor(m_header)))
+        m_cacheBody = std::make_shared<std::string>();
+
+      startBody_();
+      break;
+    }
+    }
+  } else { // ec exists
+
+    headerCompleted(ec, m_header);
+
+  }
+}
+
+template <Protocol p>
+void Request<p>::startBody_() {
+  const auto client = m_client.lock();
+
+  if (!client) { // no client any more
+    headerCompleted(error::canceled, m_header);
+
+    return;
+  }
+
+  m_decoding = false;
+
+  if (m_decompress && !m_bodyBufferProvider && m_parser.framing() != ResponseParser::Framing::None) {
+    const auto coding = ContentDecoder::coding(m_header.field(FieldId::ContentEncoding).value_or(boost::string_view{}));
+
+    if (coding != ContentDecoder::Coding::Identity && coding != ContentDecoder::Coding::Unsupported) {
+      contentDecoder_(*client).reset(coding);
+
+      m_decoding = true;
+    }
+  }
+
+  switch (m_parser.framing()) {
+  case ResponseParser::Framing::None:
+    headerCompleted(error::success, m_header);
+    bodyChunkCompleted(error::success, 0);
+    break;
+
+  case ResponseParser::Framing::Chunked:
+    m_chunkDecoder.reset();
+    m_chunkLeft = 0;
+
+    headerCompleted(error::success, m_header);
+
+    // the header may have come with some chunks already
+    decodeChunks_();
+    break;
+
+  case ResponseParser::Framing::Length:
+  case ResponseParser::Framing::UntilClose:
+    // the body is delivered in slices as it is received; for the latter the connection close is body end
+    m_bodyLeft = m_parser.framing() == ResponseParser::Framing::Length ? m_parser.contentLength()
+                                                                       : std::numeric_limits<std::uint64_t>::max();
+
+    TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::startBody_ body length: " << m_bodyLeft;
+
+    headerCompleted(error::success, m_header);
+
+    if (m_fileSink && m_parser.framing() == ResponseParser::Framing::Length) {
+      const auto ec = m_fileSink->preallocate(m_bodyLeft);
+
+      if (ec) {
+        tryCompleteRequest(ec);
+
+        break;
+      }
+    }
+
+    // the header may have come with the beginning of the body
+    streamBody_();
+    break;
+  }
+}
+
+template <Protocol p>
+void Request<p>::onBodyReceived_(const ErrorCode& ec, std::size_t bt) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onBodyReceived_ bt: " << bt << ", ec: " << ec;
+
+  if (!ec) {
+    m_metrics->received(bt);
+
+    if (!resetNoopTimer_()) // if not reset, let the timeout happen
+      return;
+
+    if (m_bodyBufferProvider) { // read into the destination
+      m_bodyLeft -= bt;
+
+      if (!bodyDataReceived_(bt))
+        return;
     } else {
-      tryCompleteRequest(error::canceled);
+      m_recvBuf.commit(bt);
+    }
+
+    streamBody_();
+  } else if (ec == asio::error::eof && m_parser.framing() == ResponseParser::Framing::UntilClose) {
+    bodyChunkCompleted(error::success, 0);
+  } else {
+    bodyChunkCompleted(ec, 0);
+  }
+}
+
+template <Protocol p>
+void Request<p>::onTimeout_(const ErrorCode& ec) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onTimeout_ ec: " << ec;
+
+  if (!ec) {
+    m_timedOut = true;
+  }
+
+  timeoutCompleted(ec);
+}
+
+template <Protocol p>
+void Request<p>::onChunkDataReceived_(const ErrorCode& ec, std::size_t bt) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " Request<p>::onChunkDataReceived_ bt: " << bt << ", ec: " << ec;
+
+  if (!ec) {
+    m_metrics->received(bt);
+
+    // reset the noop timeout on chunk data received
+    if (!resetNoopTimer_()) // if not reset, let the timeout happen
+      return;
+
+    if (m_chunkLeft > 0 && m_bodyBufferProvider) { // chunk data is read into the destination, see readChunks_()
+      m_chunkLeft -= bt;
+
+      if (!bodyDataReceived_(bt))
+        return;
+    } else {
+      m_recvBuf.commit(bt);
     }
+
+    decodeChunks_();
   } else {
     tryCompleteRequest(ec);
   }
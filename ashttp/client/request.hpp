@@ -26,11 +26,25 @@
 #include "../type.hpp"
 #include "../header.hpp"
 #include "../connection.hpp"
+#include "../parser.hpp"
+#include "../function.hpp"
+#include "../handlermemory.hpp"
+#include "../postedhandler.hpp"
+#include "../filesink.hpp"
+#include "../memorybudget.hpp"
+#include "../cache.hpp"
+#include "../hedgepolicy.hpp"
+#include "../metrics.hpp"
+#include "../retrypolicy.hpp"
+#include "../timing.hpp"
 
 #include <boost/asio.hpp>
 
+#include <chrono>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace ashttp {
@@ -45,14 +59,19 @@ template <Protocol p>
 class ClientCRTPBase;
 
 template <Protocol p>
-class Request {
+class Request
+    : public std::enable_shared_from_this<Request<p>> {
   template <Protocol p_>
   friend class ClientCRTPBase;
 public:
+  // the callbacks are stored in place when they fit, see InplaceCallback
   using HeaderCallback = std::function<void(const ErrorCode&, const Header&)>;
   using BodyChunkCallback = std::function<void(const ErrorCode&, std::istream&, std::size_t chunkSize)>;
+  using BodySpanCallback = std::function<std::size_t(const ErrorCode&, const asio::const_buffer& data)>;
   using TimeoutCallback = std::function<void()>;
   using CompleteCallback = std::function<void (const ErrorCode&)>;
+  using BodyBufferProvider = std::function<asio::mutable_buffer(std::size_t sizeHint)>;
+  using BodyDataCallback = std::function<void(const ErrorCode&, const asio::mutable_buffer& data)>;
 
 public:
   Request(std::weak_ptr<ClientImpl<p>> client, std::string host, std::string resource, Millisec timeout = Millisec{10000});
@@ -66,7 +85,7 @@ public:
    * This callback can be used to keep the object alive. The registered \p callback is guaranteed to be called
    *at the end of request processing. The \p callback will be released after being called once.
    */
-  Request& onComplete(CompleteCallback callback);
+  Request& onComplete(InplaceCallback<CompleteCallback> callback);
 
 
   /**
@@ -79,7 +98,7 @@ public:
    *also is not guaranteed to be called at all. Use Request<C>::onComplete() to track the state
    *of the object.
    */
-  Request& onHeader(HeaderCallback callback);
+  Request& onHeader(InplaceCallback<HeaderCallback> callback);
 
   /**
    * @brief onBodyChunk Registers the given callback to be called when a chunk of the body is received.
@@ -91,15 +110,73 @@ public:
    *stream and callback must not read beyond the given chunk size in the parameter.
    *
    * If transfer-encoding: chunked is used for the response, this function will be called multiple times
-   * for each chunk. If the error code is success and chunk size parameter is 0, then it means the received
-   *chunk is the last chunk.
+   * for each chunk. Other bodies are given in slices of at most bodySliceSize() bytes as they are received.
+   *If the error code is success and chunk size parameter is 0, then it means the received chunk is the last
+   *chunk.
    *
    * The given \p callback will live until the lifetime of this object ends. This callback should not be
    *used to keep the object alive as it will cause the object to keep itself alive forever. This callback
    *also is not guaranteed to be called at all. Use Request<C>::onComplete() to track the state
    *of the object.
    */
-  Request& onBodyChunk(BodyChunkCallback callback);
+  Request& onBodyChunk(InplaceCallback<BodyChunkCallback> callback);
+
+  /**
+   * @brief onBodySpan Registers the given callback to be called with the received parts of the body.
+   * @param callback Returns the number of bytes of the given data it has consumed.
+   * @return Self.
+   *
+   * Used instead of onBodyChunk(); the data is given as a contiguous buffer, no stream is constructed. The
+   *bytes that are not consumed are given again, followed by the next received data, in the next call. An empty
+   *buffer with success means the end of the body; bytes that are still not consumed then are dropped.
+   *
+   * The given \p callback will live until the lifetime of this object ends. This callback should not be
+   *used to keep the object alive as it will cause the object to keep itself alive forever.
+   */
+  Request& onBodySpan(InplaceCallback<BodySpanCallback> callback);
+
+  /**
+   * @brief readBodyInto Makes the body to be read straight into the memory given by \p provider.
+   * @param provider Called when the memory given before is full, with the number of bytes of the body (or of
+   *the current chunk) that are known to be left. Returns where to read the body next. Returning an empty
+   *buffer fails the request with error::fileTooLarge.
+   * @param callback Called with the part of the given memory that each read has filled. An empty buffer with
+   *success means the end of the body.
+   * @return Self.
+   *
+   * Used instead of onBodyChunk(); the body is not copied through the receive buffer, except for the bytes
+   *that come along with the header (or with a chunk size line). The chunk boundaries of chunked bodies are not
+   *kept. Can be called from the header callback, e.g. to size the memory with Header::contentLength().
+   *
+   * The given \p callback will live until the lifetime of this object ends. This callback should not be
+   *used to keep the object alive as it will cause the object to keep itself alive forever.
+   */
+  Request& readBodyInto(InplaceCallback<BodyBufferProvider> provider, InplaceCallback<BodyDataCallback> callback);
+
+  /**
+   * @brief readBodyInto Makes the body to be read straight into the given buffers, one after the other.
+   * @param buffers A mutable buffer sequence. The memory must be valid until the request completes.
+   * @param callback See readBodyInto(BodyBufferProvider, BodyDataCallback).
+   * @return Self.
+   *
+   * The request fails with error::fileTooLarge if the body does not fit into \p buffers.
+   */
+  template <class MutableBufferSequence,
+            class = typename std::enable_if<asio::is_mutable_buffer_sequence<MutableBufferSequence>::value>::type>
+  Request& readBodyInto(const MutableBufferSequence& buffers, InplaceCallback<BodyDataCallback> callback);
+
+  /**
+   * @brief bodyToFile Makes the body to be written to the file of \p sink.
+   * @param sink
+   * @return Self.
+   *
+   * Used instead of onBodyChunk(). The body is read into the buffer of the sink and written from there; on
+   *plaintext connections a body that is not chunked is spliced to the file if the sink allows it. Space for
+   *the body is reserved when its length is known. Failures of the file are given to the complete callback.
+   *
+   * Can be called from the header callback.
+   */
+  Request& bodyToFile(std::shared_ptr<FileSink> sink);
 
   /**
    * @brief onTimeout Registers the given callback to be called on receive timeout.
@@ -111,7 +188,7 @@ public:
    *also is not guaranteed to be called at all. Use Request<C>::onComplete() to track the state
    *of the object.
    */
-  Request& onTimeout(TimeoutCallback callback);
+  Request& onTimeout(InplaceCallback<TimeoutCallback> callback);
 
 
   /**
@@ -121,6 +198,271 @@ public:
    */
   Request& timeout(Millisec timeout);
 
+  /**
+   * @brief deadline Sets the time by which the request must be completed.
+   * @param deadline
+   * @return Self.
+   *
+   * Unlike the timeout, which starts when the request is sent, the deadline also covers the time the request
+   *waits in the queue of its client and for its connection to be made. A request that is not sent by its
+   *deadline completes with error::timeout without using the connection, and the timeout of a sent one is
+   *cut to the deadline. Set it before the request is scheduled, e.g. to the deadline of the work it is done
+   *for.
+   */
+  Request& deadline(std::chrono::steady_clock::time_point deadline);
+
+  std::chrono::steady_clock::time_point deadline() const { return m_deadline; }
+
+  /**
+   * @brief bodySliceSize Sets the most bytes of a body given to the body chunk callback at once.
+   * @param size
+   * @return Self.
+   *
+   * Only one slice is held in memory at a time, so this bounds the memory used for bodies that are not
+   *chunked. Defaults to DefaultBodySliceSize.
+   */
+  Request& bodySliceSize(std::size_t size);
+
+  /**
+   * @brief maxBufferSize Sets the most bytes the receive buffer of this request may hold.
+   * @param size
+   * @return Self.
+   *
+   * A chunk is held whole in the receive buffer unless readBodyInto() is used, so a larger chunk fails the
+   *request with error::fileTooLarge. Defaults to DefaultMaxBufferSize.
+   *
+   * The receive buffer is also accounted in the memory budget of the client (see
+   *ClientCRTPBase<p>::memoryBudget()). While the budget has no room, the request stops reading the body like
+   *pause() does and continues once memory is released by the other requests.
+   */
+  Request& maxBufferSize(std::size_t size);
+
+  /**
+   * @brief decompress Asks for a compressed body and decompresses it before it is delivered.
+   * @param enable
+   * @return Self.
+   *
+   * The supported codings (see ContentDecoder) are sent in accept-encoding. The body callbacks and
+   *asyncReadSome() are then given the decompressed body; the header still describes the compressed one, e.g.
+   *its content-length. A body with a coding that is not supported is given as it is.
+   *
+   * Not applied to the bodies read by readBodyInto() or bodyToFile(), which must be set before the request is
+   *scheduled not to ask for a compressed body.
+   */
+  Request& decompress(bool enable = true);
+
+  /**
+   * @brief range Asks for the bytes from \p first to \p last (inclusive) of the resource.
+   * @param first
+   * @param last The default is up to the end of the resource.
+   * @return Self.
+   *
+   * The server answers 206 with a content-range field, or 200 with the whole resource if it does not support
+   *ranges. Requests for a range are not served from nor stored in the cache.
+   */
+  Request& range(std::uint64_t first, std::uint64_t last = std::numeric_limits<std::uint64_t>::max());
+
+
+  /**
+   * @brief pause Stops reading the body after the current read completes.
+   *
+   * The connection is not read while the request is paused, which lets TCP apply backpressure to the
+   *server. Can be called from the body chunk callback. Note that the timeout of the request keeps running.
+   *
+   * Must be called from a thread running the io_service.
+   */
+  void pause();
+
+  /**
+   * @brief resume Continues reading the body after pause().
+   *
+   * Must be called from a thread running the io_service.
+   */
+  void resume();
+
+
+  /**
+   * @brief header
+   * @return The received header. Only valid after the header is received.
+   */
+  const Header& header() const { return m_header; }
+
+  /**
+   * @brief timing
+   * @return When the phases of the request happened. Complete in the completion callback.
+   */
+  const Timing& timing() const { return m_timing; }
+
+
+  /**
+   * @brief asyncReadSome Reads some of the body into \p buffer.
+   * @param buffer The buffer to read the body into.
+   * @param token Completion token, e.g. a callback or boost::asio::use_awaitable.
+   *
+   * Completes with (ErrorCode, std::size_t bytesRead). boost::asio::error::eof is given after the whole
+   *body has been read.
+   *
+   * Only usable on requests created by ClientCRTPBase<p>::asyncGet(). The connection is not read further
+   *while the current chunk is not completely consumed by the reader.
+   *
+   * The completion handler is stored in place so it must fit into an InplaceFunction; handlers of the
+   *asio tokens (use_awaitable, use_future, yield_context) do. It is called on its associated executor, the
+   *io_service of the request if it has none, which is kept busy until then.
+   */
+  template <class CompletionToken>
+  auto asyncReadSome(const asio::mutable_buffer& buffer, CompletionToken&& token);
+
+
+private:
+  // large enough for an asio awaitable handler (with redirect_error), a work guard and a shared_ptr; these post
+  // the handlers to their executors themselves, see PostedHandler
+  using PullHeaderHandler = InplaceFunction<void(const ErrorCode&), 192>;
+  using PullReadHandler = InplaceFunction<void(const ErrorCode&, std::size_t), 192>;
+
+
+  /**
+   * @brief pull Switches the request to pull mode; the body is then read using asyncReadSome().
+   * @param handler Handler to call once the header is received or the request fails.
+   */
+  void pull(PullHeaderHandler handler);
+
+  /**
+   * @brief servePull_ Satisfies the pending read of asyncReadSome() if data or a result is available.
+   */
+  void servePull_();
+
+  /**
+   * @brief postPull_ Posts the pending read handler with the given result.
+   */
+  void postPull_(const ErrorCode& ec, std::size_t bytesRead);
+
+  /**
+   * @brief holdBody_ Checks whether the body must not be read further for now.
+   * @return true if the reader has not yet consumed what it has or the request is paused.
+   *
+   * continueBody_() is called once the body can be read again.
+   */
+  bool holdBody_();
+
+  /**
+   * @brief continueBody_ Continues receiving the body after it was held.
+   */
+  void continueBody_();
+
+  /**
+   * @brief reserveMemory_ Sets the reservation in the memory budget to \p size bytes before a read into the
+   *receive buffer, and to the room of the decoded body if it is decompressed.
+   * @return false if the request is failed as \p size never fits, or if the budget has no room now; the
+   *body is continued once it has.
+   */
+  bool reserveMemory_(std::size_t size);
+
+  /**
+   * @brief releaseMemory_ Gives back the whole reservation.
+   */
+  void releaseMemory_();
+
+  /**
+   * @brief onMemoryAvailable_ Called on the io_service after memory is released in the budget.
+   */
+  void onMemoryAvailable_();
+
+  /**
+   * @brief decodeChunks_ Delivers all the complete chunks in the receive buffer, then reads more if needed.
+   */
+  void decodeChunks_();
+
+  /**
+   * @brief streamBody_ Delivers the received part of a body that is not chunked, then reads more if needed.
+   */
+  void streamBody_();
+
+  /**
+   * @brief readBody_ Reads up to a slice of a body that is not chunked.
+   */
+  void readBody_();
+
+  /**
+   * @brief nextDestination_ Makes sure there is room in the destination memory given by readBodyInto().
+   * @param sizeHint The number of bytes known to be left.
+   * @return false if the request is failed as the provider gave no more memory.
+   */
+  bool nextDestination_(std::uint64_t sizeHint);
+
+  /**
+   * @brief copyToDestination_ Moves up to \p size received bytes from the receive buffer to the destination.
+   * @return The number of bytes moved, 0 if the request is failed.
+   */
+  std::size_t copyToDestination_(std::size_t size);
+
+  /**
+   * @brief bodyBuf_
+   * @return The buffer the delivered body is taken from, the receive buffer unless the body is decompressed.
+   */
+  boost::asio::streambuf& bodyBuf_() { return m_decoding ? m_decodedBuf : m_recvBuf; }
+
+  /**
+   * @brief deliverBody_ Hands the \p size bytes at the front of \p buf to the reader, 0 meaning the end of
+   *the body.
+   */
+  void deliverBody_(boost::asio::streambuf& buf, std::size_t size);
+
+  /**
+   * @brief decodeBody_ Decompresses the \p size bytes at the front of the receive buffer and delivers the
+   *result as it is decoded.
+   * @return false if the request is failed.
+   */
+  bool decodeBody_(std::size_t size);
+
+  /**
+   * @brief decodeSlice_ Decodes the rest of the slice given to decodeBody_() and delivers it, until the
+   *reader holds a slice of decoded body in pull mode or the request is paused.
+   * @return false if the request is failed.
+   *
+   * The input that is not decoded yet stays at the front of the receive buffer, holdBody_() continues with
+   *it.
+   */
+  bool decodeSlice_();
+
+  /**
+   * @brief decodeHeld_
+   * @return true if the slice given to decodeBody_() is not completely decoded, or not completely delivered
+   *outside pull mode.
+   */
+  bool decodeHeld_() const { return m_decodeMore || (!m_pullMode && m_decodedBuf.size() > 0); }
+
+  /**
+   * @brief bodySpanReceived_ Hands \p size bytes at \p data to the span callback.
+   */
+  void bodySpanReceived_(const char* data, std::size_t size);
+
+  /**
+   * @brief bodyDataReceived_ Hands the \p size bytes at the front of the destination to the file sink or the
+   *data callback.
+   * @return false if the request is failed by the file sink.
+   */
+  bool bodyDataReceived_(std::size_t size);
+
+  /**
+   * @brief spliceBody_ Waits for the socket to have data to splice to the file sink.
+   */
+  void spliceBody_();
+
+  void onSpliceReady_(const ErrorCode& ec);
+
+  /**
+   * @brief resetNoopTimer_ Restarts the idle timer of the connection as data is received.
+   * @return false if the timer has already expired (the connection is being closed then) or the client is
+   *gone.
+   */
+  bool resetNoopTimer_();
+
+  /**
+   * @brief readChunks_ Reads at least enough to complete the current chunk, or some more bytes if its size is
+   *not yet known.
+   */
+  void readChunks_();
+
 
 private:
   /**
@@ -129,6 +471,147 @@ private:
     */
   void start();
 
+  /**
+   * @brief prepare_ Resets the state of a previous run and starts the timeout.
+   */
+  void prepare_();
+
+
+  /**
+   * @brief armDeadline_ Starts waiting for the deadline of the request when it is scheduled.
+   * @return false if the deadline has already passed, the request is completed then.
+   */
+  bool armDeadline_();
+
+  /**
+   * @brief expire_ Completes the request that is not sent with error::timeout on the io_service; its client
+   *skips it.
+   */
+  void expire_();
+
+  bool deadlinePassed_() const;
+
+  /**
+   * @brief timeLeft_
+   * @return The timeout, or the time until the deadline if it is sooner.
+   */
+  boost::posix_time::time_duration timeLeft_() const;
+
+  /**
+   * @brief tryRetry_ Decides to send the request again after it failed with \p ec, or after it is answered with
+   *a retryable status if \p ec is 0, as the retry policy of the client allows.
+   * @return true if it is retried; it is then completed with an error on its connection without finishing.
+   */
+  bool tryRetry_(const ErrorCode& ec);
+
+  /**
+   * @brief retryLater_ Puts the request back in the queue of its client after the delay of the retry.
+   */
+  void retryLater_();
+
+  /**
+   * @brief lookupCache_ Looks the request up in the cache of the client when it is scheduled.
+   * @return true if the request is served from the cache without the connection.
+   */
+  bool lookupCache_();
+
+  /**
+   * @brief replay_ Gives the cached response as if it is received, then the body in slices.
+   */
+  void replay_();
+
+  /**
+   * @brief replayBody_ Gives the next slice of a cached body to the span or the chunk callback straight from
+   *the memory of the entry, which may be a mapped file.
+   */
+  void replayBody_();
+
+  /**
+   * @brief deliverView_ Gives \p size bytes at \p data to the span or the chunk callback without copying them.
+   */
+  void deliverView_(const char* data, std::size_t size);
+
+  /**
+   * @brief coalescable_
+   * @return true if the request can be given the response of an identical one, see
+   *ClientCRTPBase<p>::coalesce().
+   */
+  bool coalescable_() const { return !m_pullMode && !m_bodyBufferProvider && !m_fileSink && !m_ranged; }
+
+  /**
+   * @brief coalescingKey_
+   * @return What an identical request must have the same of.
+   */
+  std::string coalescingKey_() const { return m_resource + (m_decompress ? "\n+" : "\n-"); }
+
+  /**
+   * @brief attach_ Makes \p follower to be given the response of this request.
+   */
+  void attach_(std::shared_ptr<Request<p>> follower);
+
+  /**
+   * @brief stopLeading_ Stops requests from attaching to this one, once its header is received.
+   */
+  void stopLeading_();
+
+  /**
+   * @brief fanOut_ Gives \p size bytes of the body at \p data to the attached requests.
+   */
+  void fanOut_(const char* data, std::size_t size);
+
+  /**
+   * @brief hedgeable_
+   * @return true if the request can be given the response of one of its attempts, see
+   *ClientCRTPBase<p>::hedging().
+   */
+  bool hedgeable_() const { return !m_pullMode && !m_bodyBufferProvider && !m_fileSink; }
+
+  /**
+   * @brief hedge_ Sends the request as an attempt on \p client and gives it the response of the first of its
+   *attempts to receive a header.
+   */
+  void hedge_(ClientImpl<p>& client);
+
+  /**
+   * @brief attempt_ Queues one more attempt of this request on \p client.
+   */
+  void attempt_(ClientImpl<p>& client);
+
+  /**
+   * @brief armHedge_ Starts the hedge delay, once the first attempt is sent.
+   */
+  void armHedge_();
+
+  void onHedgeTimer_(const ErrorCode& ec);
+
+  /**
+   * @brief hedgeWon_ Follows \p attempt, the first to receive its header, and abandons the others.
+   */
+  void hedgeWon_(Request<p>& attempt);
+
+  /**
+   * @brief attemptDone_ Forgets \p attempt, which completed with \p ec; fails if it was the last one before any
+   *header.
+   */
+  void attemptDone_(const Request<p>& attempt, const ErrorCode& ec);
+
+  /**
+   * @brief abandon_ Drops an attempt that lost; closes its connection if it is sent.
+   */
+  void abandon_();
+
+  /**
+   * @brief cacheBody_ Adds a received part of the body, as framed but not decoded, to the response being
+   *cached.
+   */
+  void cacheBody_(const char* data, std::size_t size);
+
+  /**
+   * @brief contentDecoder_
+   * @return The decoder of the connection, or one of this request while it does not use the connection.
+   */
+  ContentDecoder& contentDecoder_(ClientImpl<p>& client);
+
 
   /**
    * @brief addNextRequest Adds a new request to be started when this request finishes.
@@ -208,6 +691,16 @@ private:
   void onHeaderReceived_(const ErrorCode& ec, std::size_t bt);
   void onBodyReceived_(const ErrorCode& ec, std::size_t bt);
 
+  /**
+   * @brief readHeader_ Reads more of the header into the header storage.
+   */
+  void readHeader_();
+
+  /**
+   * @brief startBody_ Starts receiving the body as framed by the parsed header.
+   */
+  void startBody_();
+
   /**
    * @brief onTimeout_
    * @param ec
@@ -216,8 +709,7 @@ private:
    */
   void onTimeout_(const ErrorCode& ec);
 
-  void onChunkSizeReceived_(const ErrorCode& ec, std::size_t bt);
-  void onChunkDataReceived_(const ErrorCode& ec, std::size_t bt, std::size_t chunkSize);
+  void onChunkDataReceived_(const ErrorCode& ec, std::size_t bt);
 
 private:
   std::weak_ptr<ClientImpl<p>> m_client;
@@ -225,21 +717,136 @@ private:
   std::string m_resource;
 
   Header m_header;
+  ResponseParser m_parser;
+
+  ChunkDecoder m_chunkDecoder;
+  std::size_t m_chunkLeft; // data bytes of the current chunk, at the front of m_recvBuf when received
+  std::uint64_t m_bodyLeft; // bytes of a body that is not chunked that are not yet delivered
+  std::size_t m_bodySliceSize;
+
+  bool m_paused;
+  bool m_bodyStalled; // the body was held by pause() and waits for resume()
+
+  std::shared_ptr<MemoryBudget> m_memoryBudget;
+  std::size_t m_maxBufferSize;
+  std::size_t m_memoryReserved; // bytes reserved in m_memoryBudget for m_recvBuf and m_decodedBuf
+  bool m_memoryStalled;         // the body waits for memory in m_memoryBudget
 
   boost::asio::streambuf m_recvBuf;
 
-  HeaderCallback m_headerCallback;
-  BodyChunkCallback m_bodyChunkCallback;
-  TimeoutCallback m_timeoutCallback;
-  CompleteCallback m_completeCallback;
+  bool m_decompress;
+  bool m_ranged;
+  std::uint64_t m_rangeFirst;
+  std::uint64_t m_rangeLast;
+  bool m_decoding; // the body is decompressed by the decoder of the connection
+  boost::asio::streambuf m_decodedBuf;
+  std::size_t m_decodeLeft; // input of the slice being decoded, at the front of m_recvBuf
+  bool m_decodeMore;        // the decoder has more output for the slice being decoded
+
+  InplaceCallback<HeaderCallback> m_headerCallback;
+  InplaceCallback<BodyChunkCallback> m_bodyChunkCallback;
+  InplaceCallback<BodySpanCallback> m_bodySpanCallback;
+  std::vector<char> m_bodySpanKept; // the bytes the span callback did not consume
+  InplaceCallback<TimeoutCallback> m_timeoutCallback;
+  InplaceCallback<CompleteCallback> m_completeCallback;
+  InplaceCallback<BodyBufferProvider> m_bodyBufferProvider;
+  InplaceCallback<BodyDataCallback> m_bodyDataCallback;
+
+  asio::mutable_buffer m_bodyDestination; // the unused part of the memory given by m_bodyBufferProvider
+  std::shared_ptr<FileSink> m_fileSink;
+
+  std::shared_ptr<Cache> m_cache;
+  std::string m_cacheKey;
+  std::shared_ptr<const Cache::Entry> m_cacheEntry; // the stale entry revalidated, or the entry replayed
+  std::shared_ptr<Cache::Entry> m_cacheStore;       // the response being stored
+  std::shared_ptr<std::string> m_cacheBody;
+  bool m_replaying;
+  std::size_t m_replayOffset;
+  bool m_detached; // not using the connection (any more), the client is not notified on completion
+  std::unique_ptr<ContentDecoder> m_contentDecoder;
+
+  bool m_leading;   // identical requests may attach to this one
+  bool m_following; // attached to an identical request, given its response
+  std::string m_coalescingKey;
+  std::vector<std::shared_ptr<Request<p>>> m_followers;
+
+  std::shared_ptr<HedgePolicy> m_hedgePolicy; // set while the response is raced over attempts
+  boost::asio::deadline_timer m_hedgeTimer;
+  std::vector<std::weak_ptr<Request<p>>> m_attempts; // in flight
+  const Request<p>* m_hedgeWinner;
+  std::chrono::steady_clock::time_point m_hedgeStartedAt; // when the first attempt was sent
+  bool m_hedgeArmed;
+  std::weak_ptr<Request<p>> m_hedgeOf; // of an attempt: the request it is made for
+  bool m_hedgeAttempt;                 // of an attempt: a hedge, not the first one
+  bool m_hedgeLost;                    // of an attempt: abandoned, its connection is closed
+
+  Timing m_timing; // started is unset while queued, header until the header is received
+
+  std::shared_ptr<Metrics::Host> m_metrics; // of its client
+  bool m_pending;                           // counted as started in m_metrics and not yet as completed
 
   bool m_timedOut;
   Millisec m_timeout;
-  boost::asio::deadline_timer m_timeoutTimer;
+  std::chrono::steady_clock::time_point m_deadline; // none if the epoch
+  bool m_queued;  // scheduled and not started, m_timeoutTimer waits for the deadline
+  bool m_expired; // completed at its deadline before it was started
+  boost::asio::deadline_timer m_timeoutTimer; // also waits for the delay of a retry
+
+  unsigned m_retries; // since it was scheduled
+  bool m_answered;    // its header was given to the callbacks
+  bool m_retrying;    // completed on its connection only, to be sent again after m_retryDelay
+  RetryPolicy::Clock::duration m_retryDelay;
+
+  // operation state of this request is allocated from its connection's memory
+  std::shared_ptr<HandlerMemory> m_handlerMemory;
+
+  // pull mode (asyncGet / asyncReadSome) state
+  bool m_pullMode;
+  bool m_pullResume; // the body is held until the reader consumes what it has
+  bool m_pullEnd;
+  std::size_t m_pullAvailable; // bytes of the current chunk at the front of bodyBuf_()
+  ErrorCode m_pullError;
+  asio::mutable_buffer m_pullBuffer;
+  PullHeaderHandler m_pullHeaderHandler;
+  PullReadHandler m_pullReadHandler;
+
+  static const constexpr std::size_t MaxHeaderSize{64 * 1024};
+  static const constexpr std::size_t HeaderReadSize{4096};
+  static const constexpr std::size_t ChunkReadSize{16 * 1024};
+  static const constexpr std::size_t DecodeSize{64 * 1024};
 
-  static const constexpr std::size_t MaxRecvbufSize{20 * 1024 * 1024};
+public:
+  static const constexpr std::size_t DefaultBodySliceSize{64 * 1024};
+  static const constexpr std::size_t DefaultMaxBufferSize{20 * 1024 * 1024};
 };
 
+template <Protocol p>
+template <class MutableBufferSequence, class>
+Request<p>& Request<p>::readBodyInto(const MutableBufferSequence& buffers, InplaceCallback<BodyDataCallback> callback) {
+  std::vector<asio::mutable_buffer> sequence{asio::buffer_sequence_begin(buffers), asio::buffer_sequence_end(buffers)};
+
+  return readBodyInto(
+      [ sequence = std::move(sequence), next = std::size_t{0} ](std::size_t) mutable {
+        return next < sequence.size() ? sequence[next++] : asio::mutable_buffer{};
+      },
+      std::move(callback));
+}
+
+template <Protocol p>
+template <class CompletionToken>
+auto Request<p>::asyncReadSome(const asio::mutable_buffer& buffer, CompletionToken&& token) {
+  auto initiation = [this](auto&& handler, const asio::mutable_buffer& buffer) {
+    assert(m_pullMode && !m_pullReadHandler);
+
+    m_pullBuffer = buffer;
+    m_pullReadHandler = PullReadHandler{makePostedHandler(std::move(handler), m_timeoutTimer.get_executor())};
+
+    servePull_();
+  };
+
+  return asio::async_initiate<CompletionToken, void(ErrorCode, std::size_t)>(std::move(initiation), token, buffer);
+}
+
 }
 }
 
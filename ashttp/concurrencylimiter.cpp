@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "concurrencylimiter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ashttp {
+
+ConcurrencyLimiter::ConcurrencyLimiter(Options options)
+    : m_options{std::move(options)}
+    , m_limit{static_cast<double>(std::min(std::max(m_options.initialLimit, m_options.minLimit), m_options.maxLimit))}
+    , m_inFlight{0}
+    , m_minLatency{Clock::duration::max()}
+    , m_previousMinLatency{Clock::duration::max()}
+    , m_windowStart{Clock::now()}
+    , m_lastDrop{}
+    , m_acquired{0}
+    , m_rejected{0}
+    , m_drops{0} {
+  assert(m_options.minLimit > 0 && m_options.minLimit <= m_options.maxLimit);
+  assert(m_options.backoff > 0 && m_options.backoff < 1);
+}
+
+bool ConcurrencyLimiter::tryAcquire(Waiter waiter) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (freeSlots() > 0) {
+    ++m_inFlight;
+    ++m_acquired;
+
+    return true;
+  }
+
+  ++m_rejected;
+  m_waiters.push_back(std::move(waiter));
+
+  return false;
+}
+
+void ConcurrencyLimiter::release(Clock::time_point startedAt, Outcome outcome, Clock::duration latency) {
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    assert(m_inFlight > 0);
+
+    const auto now = Clock::now();
+
+    switch (outcome) {
+    case Outcome::Success:
+      sample(now, latency);
+
+      if (latency > m_options.tolerance * std::min(m_minLatency, m_previousMinLatency))
+        drop(now, startedAt);
+      else if (m_inFlight >= m_limit / 2) // grow only while the limit is used
+        m_limit = std::min(m_limit + 1 / m_limit, static_cast<double>(m_options.maxLimit));
+      break;
+
+    case Outcome::Dropped:
+      drop(now, startedAt);
+      break;
+
+    case Outcome::Ignored:
+      break;
+    }
+
+    --m_inFlight;
+  }
+
+  wake();
+}
+
+ConcurrencyLimiter::Stats ConcurrencyLimiter::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  const auto minLatency = std::min(m_minLatency, m_previousMinLatency);
+
+  return Stats{static_cast<std::size_t>(m_limit),
+               m_inFlight,
+               m_waiters.size(),
+               minLatency == Clock::duration::max() ? std::chrono::microseconds::zero()
+                                                    : std::chrono::duration_cast<std::chrono::microseconds>(minLatency),
+               m_acquired,
+               m_rejected,
+               m_drops};
+}
+
+void ConcurrencyLimiter::sample(Clock::time_point now, Clock::duration latency) {
+  if (now - m_windowStart >= m_options.minLatencyWindow) { // a new window, so the lowest latency can go up
+    m_previousMinLatency = m_minLatency;
+    m_minLatency = latency;
+    m_windowStart = now;
+  } else {
+    m_minLatency = std::min(m_minLatency, latency);
+  }
+}
+
+void ConcurrencyLimiter::drop(Clock::time_point now, Clock::time_point startedAt) {
+  if (startedAt < m_lastDrop) // in flight when the limit was cut for the same overload
+    return;
+
+  m_limit = std::max(m_limit * m_options.backoff, static_cast<double>(m_options.minLimit));
+  m_lastDrop = now;
+  ++m_drops;
+}
+
+void ConcurrencyLimiter::wake() {
+  auto wakeups = std::numeric_limits<std::size_t>::max();
+
+  while (wakeups > 0) {
+    std::vector<Waiter> waiters;
+
+    {
+      std::lock_guard<std::mutex> l{m_mutex};
+
+      // wake up as many waiters as there are slots; the ones that lose the slot to another request wait again
+      for (auto slots = std::min(freeSlots(), wakeups); slots > 0 && !m_waiters.empty(); --slots) {
+        waiters.push_back(std::move(m_waiters.front()));
+        m_waiters.pop_front();
+      }
+    }
+
+    wakeups = 0;
+
+    for (auto& waiter : waiters) {
+      if (!waiter()) // gone, its wakeup goes to the next one
+        ++wakeups;
+    }
+  }
+}
+
+std::size_t ConcurrencyLimiter::freeSlots() const {
+  const auto limit = static_cast<std::size_t>(std::floor(m_limit));
+
+  return limit > m_inFlight ? limit - m_inFlight : 0;
+}
+
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "function.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace ashttp {
+
+/**
+ * @brief ConcurrencyLimiter Limits the number of requests in flight to a host, adapting the limit to how the
+ *host responds.
+ *
+ * The limit grows additively while the latency stays within a tolerance of the lowest latency seen lately and
+ *is cut multiplicatively when a request times out, is answered 503 or takes too long. A request that was
+ *started before the last cut does not cut it again, so a burst of failures of one overload counts once.
+ *
+ * A client given a limiter (see ClientCRTPBase<p>::limiter()) takes a slot before starting each request and
+ *leaves the requests that do not get one in its queue. Several clients of the same host share a limiter to
+ *have several requests in flight.
+ *
+ * Thread-safe.
+ */
+class ConcurrencyLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Waiter = InplaceFunction<bool()>;
+
+  struct Options {
+    Options() { }
+
+    std::size_t initialLimit = 4;
+    std::size_t minLimit = 1;
+    std::size_t maxLimit = 256;
+    double backoff = 0.9;   // the limit is multiplied by this on a drop
+    double tolerance = 2.0; // the latency above this times the lowest one is a drop
+    Clock::duration minLatencyWindow = std::chrono::seconds{30}; // how long the lowest latency is remembered
+  };
+
+  enum class Outcome {
+    Success, // the latency is a sample
+    Dropped, // timed out or rejected by the host
+    Ignored  // says nothing about the host, e.g. canceled
+  };
+
+  struct Stats {
+    std::size_t limit;
+    std::size_t inFlight;
+    std::size_t waiting;                  // waiters at the moment
+    std::chrono::microseconds minLatency; // the lowest latency lately, 0 before the first sample
+    std::uint64_t acquired;
+    std::uint64_t rejected;               // acquisitions that had to wait
+    std::uint64_t drops;                  // times the limit was cut
+  };
+
+public:
+  explicit ConcurrencyLimiter(Options options = Options{});
+
+  ConcurrencyLimiter(const ConcurrencyLimiter&) = delete;
+  ConcurrencyLimiter& operator=(const ConcurrencyLimiter&) = delete;
+
+  /**
+   * @brief tryAcquire Takes a slot for a request.
+   * @param waiter Registered if there is no free slot. It is called once, on any thread, after a slot is freed
+   *or the limit grows, and should try again. It returns false if it no longer waits, the slot is then offered
+   *to the next waiter.
+   * @return true on success.
+   */
+  bool tryAcquire(Waiter waiter);
+
+  /**
+   * @brief release Gives back a slot.
+   * @param startedAt When the request of the slot was started.
+   * @param outcome
+   * @param latency The time until the response header was received, used if \p outcome is Success.
+   */
+  void release(Clock::time_point startedAt, Outcome outcome, Clock::duration latency = Clock::duration::zero());
+
+  const Options& options() const { return m_options; }
+
+  Stats stats() const;
+
+private:
+  void sample(Clock::time_point now, Clock::duration latency);
+  void drop(Clock::time_point now, Clock::time_point startedAt);
+
+  /**
+   * @brief wake Calls as many waiters as there are free slots, and the next ones in place of those that no
+   *longer wait.
+   */
+  void wake();
+
+  std::size_t freeSlots() const;
+
+private:
+  const Options m_options;
+
+  mutable std::mutex m_mutex;
+  double m_limit;
+  std::size_t m_inFlight;
+  std::deque<Waiter> m_waiters;
+
+  // the lowest latency is the lowest of the current and the previous window
+  Clock::duration m_minLatency;
+  Clock::duration m_previousMinLatency;
+  Clock::time_point m_windowStart;
+  Clock::time_point m_lastDrop;
+
+  std::uint64_t m_acquired;
+  std::uint64_t m_rejected;
+  std::uint64_t m_drops;
+};
+
+}
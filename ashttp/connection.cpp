@@ -8,8 +8,6 @@
 
 namespace ashttp {
 
-using namespace std::placeholders;
-
 ConnectionImpl<Protocol::HTTP>::ConnectionImpl(asio::io_service& is, Millisec noopTimeout)
     : ConnectionCRTPBase<ConnectionImpl<Protocol::HTTP>>{is, std::move(noopTimeout)}
     , m_socket{is} {
@@ -18,11 +16,13 @@ ConnectionImpl<Protocol::HTTP>::ConnectionImpl(asio::io_service& is, Millisec no
 
 ConnectionImpl<Protocol::HTTPS>::ConnectionImpl(asio::io_service& is, Millisec noopTimeout)
     : ConnectionCRTPBase<ConnectionImpl<Protocol::HTTPS>>{is, std::move(noopTimeout)}
+    , m_is{is}
     , m_sslContext{asio::ssl::context::tlsv12_client}
-    , m_socket{is, m_sslContext} {
+    , m_socket{std::make_shared<asio::ssl::stream<tcp::socket>>(is, m_sslContext)}
+    , m_handshaken{false} {
   m_sslContext.set_default_verify_paths();
 
-  m_socket.set_verify_mode(asio::ssl::verify_peer);
+  m_socket->set_verify_mode(asio::ssl::verify_peer);
 }
 
 ConnectionImpl<Protocol::HTTP>::~ConnectionImpl() {
@@ -34,24 +34,47 @@ ConnectionImpl<Protocol::HTTPS>::~ConnectionImpl() {
 }
 
 void ConnectionImpl<Protocol::HTTPS>::setHost(const std::string& hostname) {
-  m_socket.set_verify_callback(asio::ssl::rfc2818_verification{hostname});
+  m_hostname = hostname;
+
+  m_socket->set_verify_callback(asio::ssl::rfc2818_verification{hostname});
+}
+
+void ConnectionImpl<Protocol::HTTPS>::resetSocket_() {
+  if (!m_handshaken)
+    return;
+
+  m_handshaken = false;
+  m_socket = std::make_shared<asio::ssl::stream<tcp::socket>>(m_is, m_sslContext); // the old one may be held still
+  m_socket->set_verify_mode(asio::ssl::verify_peer);
+
+  if (!m_hostname.empty())
+    m_socket->set_verify_callback(asio::ssl::rfc2818_verification{m_hostname});
 }
 
 void ConnectionImpl<Protocol::HTTPS>::onConnect_(const ErrorCode& ec,
-                                                 const tcp::resolver::iterator& endpointIt,
-                                                 ConnectCallback callback) {
-  if (!ec)
-    m_socket.async_handshake(
+                                                 const tcp::endpoint& endpoint,
+                                                 InplaceCallback<ConnectCallback, 128> callback) {
+  if (!ec) {
+    m_handshaken = true;
+
+    m_socket->async_handshake(
         asio::ssl::stream<tcp::socket>::client,
-        std::bind(&ConnectionImpl<Protocol::HTTPS>::onHandshake_, this, _1, endpointIt, std::move(callback)));
-  else
+        makeAllocHandler(handlerMemory(), [this, hold = socketHold(), endpoint, callback = std::move(callback)](
+                                              const ErrorCode& ec) mutable {
+          onHandshake_(ec, endpoint, std::move(callback));
+        }));
+  } else {
     callback(ec);
+  }
 }
 
 void ConnectionImpl<Protocol::HTTPS>::onHandshake_(const ErrorCode& ec,
-                                                   const tcp::resolver::iterator& endpointIt,
-                                                   ConnectCallback callback) {
-  ConnectionCRTPBase<ConnectionImpl<Protocol::HTTPS>>::onConnect_(ec, endpointIt, std::move(callback));
+                                                   const tcp::endpoint& endpoint,
+                                                   InplaceCallback<ConnectCallback, 128> callback) {
+  if (!ec)
+    m_timing.handshakeEnd = Timing::Clock::now();
+
+  ConnectionCRTPBase<ConnectionImpl<Protocol::HTTPS>>::onConnect_(ec, endpoint, std::move(callback));
 }
 
 template class ConnectionImpl<Protocol::HTTP>;
@@ -10,6 +10,8 @@
 #include "connectionbase.hpp"
 
 #include <functional>
+#include <memory>
+#include <string>
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
@@ -29,6 +31,12 @@ public:
 
   tcp::socket& socket() { return m_socket; }
 
+  /**
+   * @brief socketHold
+   * @return Nothing, the socket is never replaced.
+   */
+  std::shared_ptr<void> socketHold() const { return nullptr; }
+
 private:
   tcp::socket m_socket;
 };
@@ -50,19 +58,34 @@ public:
    */
   void setHost(const std::string& hostname);
 
-  asio::ssl::stream<tcp::socket>& socket() { return m_socket; }
+  asio::ssl::stream<tcp::socket>& socket() { return *m_socket; }
+
+  /**
+   * @brief socketHold
+   * @return A reference to the current stream, held by the handlers of the operations on it.
+   *
+   * The stream is replaced on a reconnect while the operations aborted by closing it may not have completed
+   *yet; the replaced one lives until their handlers have run.
+   */
+  std::shared_ptr<void> socketHold() const { return m_socket; }
 
 private:
   // override to handle the https handshake
-  void onConnect_(const ErrorCode& ec, const tcp::resolver::iterator& endpointIt, ConnectCallback callback);
+  void onConnect_(const ErrorCode& ec, const tcp::endpoint& endpoint, InplaceCallback<ConnectCallback, 128> callback);
+
+  // override to make a new stream, a TLS session can not be started again on a closed one
+  void resetSocket_();
 
   void onHandshake_(const ErrorCode& ec,
-                    const tcp::resolver::iterator& endpointIt,
-                    ConnectCallback callback);
+                    const tcp::endpoint& endpoint,
+                    InplaceCallback<ConnectCallback, 128> callback);
 
 private:
+  asio::io_service& m_is;
   asio::ssl::context m_sslContext;
-  asio::ssl::stream<tcp::socket> m_socket;
+  std::string m_hostname;
+  std::shared_ptr<asio::ssl::stream<tcp::socket>> m_socket;
+  bool m_handshaken; // a session was started on m_socket
 };
 
 extern template class ConnectionImpl<Protocol::HTTP>;
@@ -10,12 +10,11 @@
 
 namespace ashttp {
 
-using namespace std::placeholders;
-
 template <class C>
 ConnectionCRTPBase<C>::ConnectionCRTPBase(asio::io_service& is, Millisec noopTimeout)
     : m_noopTimeout{noopTimeout}
-    , m_noopTimer{is} {
+    , m_noopTimer{is}
+    , m_handlerMemory{std::make_shared<HandlerMemory>()} {
   TEMPLOG_DEVLOG(templog::sev_debug) << this << " ConnectionCRTPBase<C>";
 }
 
@@ -27,28 +26,47 @@ ConnectionCRTPBase<C>::~ConnectionCRTPBase() {
 }
 
 template <class C>
-void ConnectionCRTPBase<C>::connect(tcp::resolver::iterator iterator, ConnectCallback callback) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " ConnectionCRTPBase<C>::connect";
+void ConnectionCRTPBase<C>::connect(const tcp::endpoint& endpoint, InplaceCallback<ConnectCallback, 128> callback) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " ConnectionCRTPBase<C>::connect " << endpoint;
+
+  if (!static_cast<C*>(this)->socket().lowest_layer().is_open()) {
+    static_cast<C*>(this)->resetSocket_(); // may make the stream again
+
+    auto& socket = static_cast<C*>(this)->socket().lowest_layer();
+
+    m_timing.connectStart = Timing::Clock::now();
+    m_timing.connectEnd = m_timing.handshakeEnd = Timing::Clock::time_point{};
 
-  auto& socket = static_cast<C*>(this)->socket().lowest_layer();
+    auto hold = static_cast<C*>(this)->socketHold(); // the socket is the lowest layer of the held stream
 
-  if (!socket.is_open()) {
-    async_connect(static_cast<C*>(this)->socket().lowest_layer(), iterator,
-                  std::bind(&C::onConnect_, static_cast<C*>(this), _1, _2, std::move(callback)));
+    socket.async_connect(endpoint, makeAllocHandler(m_handlerMemory, [this, hold = std::move(hold), endpoint,
+                                                                      callback = std::move(callback)](
+                                                                         const ErrorCode& ec) mutable {
+                           if (!ec)
+                             m_timing.connectEnd = Timing::Clock::now();
+
+                           if (ec) { // left open by a failed connect
+                             ErrorCode ignored;
+
+                             static_cast<C*>(this)->socket().lowest_layer().close(ignored);
+                           }
+
+                           static_cast<C*>(this)->onConnect_(ec, endpoint, std::move(callback));
+                         }));
   } else {
     callback(error::success);
   }
 }
 
 template <class C>
-void ConnectionCRTPBase<C>::onNoopTimeout(TimeoutCallback callback) {
+void ConnectionCRTPBase<C>::onNoopTimeout(InplaceCallback<TimeoutCallback> callback) {
   m_noopCallback = std::move(callback);
 }
 
 template <class C>
 void ConnectionCRTPBase<C>::startNoopTimer() {
   m_noopTimer.expires_from_now(m_noopTimeout);
-  m_noopTimer.async_wait(std::bind(&ConnectionCRTPBase<C>::onNoopTimeout_, this, _1));
+  m_noopTimer.async_wait(makeAllocHandler(m_handlerMemory, [this](const ErrorCode& ec) { onNoopTimeout_(ec); }));
 }
 
 template <class C>
@@ -62,18 +80,22 @@ bool ConnectionCRTPBase<C>::stopNoopTimer() {
 }
 
 template <class C>
-void ConnectionCRTPBase<C>::connectCompleted(const ErrorCode& ec, const tcp::resolver::iterator& endpointIt) {
-  TEMPLOG_DEVLOG(templog::sev_debug) << this << " ConnectionCRTPBase<C>::connectCompleted " << ec;
+void ConnectionCRTPBase<C>::connectCompleted(const ErrorCode& ec, const tcp::endpoint& endpoint) {
+  TEMPLOG_DEVLOG(templog::sev_debug) << this << " ConnectionCRTPBase<C>::connectCompleted " << ec << " " << endpoint;
 
   if (!ec) {
     startNoopTimer();
+  } else { // e.g. the handshake failed, the next connect starts over
+    ErrorCode ignored;
+
+    static_cast<C*>(this)->socket().lowest_layer().close(ignored);
   }
 }
 
 template <class C>
-void ConnectionCRTPBase<C>::onConnect_(const ErrorCode& ec, const tcp::resolver::iterator& endpointIt,
-                                       ConnectCallback callback) {
-  connectCompleted(ec, endpointIt);
+void ConnectionCRTPBase<C>::onConnect_(const ErrorCode& ec, const tcp::endpoint& endpoint,
+                                       InplaceCallback<ConnectCallback, 128> callback) {
+  connectCompleted(ec, endpoint);
 
   callback(ec);
 }
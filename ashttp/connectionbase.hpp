@@ -7,6 +7,10 @@
 #pragma once
 
 #include "type.hpp"
+#include "function.hpp"
+#include "handlermemory.hpp"
+#include "contentdecoder.hpp"
+#include "timing.hpp"
 
 #include <boost/asio.hpp>
 
@@ -22,6 +26,8 @@ class ConnectionImpl;
 template <class T>
 class ConnectionCRTPBase {
 public:
+  // the callbacks are stored in place when they fit, see InplaceCallback; connect() takes one big enough for
+  // the callback of the client along with its owner
   using ConnectCallback = std::function<void (const ErrorCode&)>;
   using TimeoutCallback = std::function<void ()>;
 
@@ -32,10 +38,12 @@ public:
 
   /**
    * @brief connect Tries to connect to the host.
-   * @param iterator An iterator to a series of endpoints to try to connect to.
+   * @param endpoint The address of the host to connect to.
    * @param callback A callback to call on connect.
+   *
+   * The callback is called right away if already connected. The socket is closed if connecting fails.
    */
-  void connect(tcp::resolver::iterator iterator, ConnectCallback callback);
+  void connect(const tcp::endpoint& endpoint, InplaceCallback<ConnectCallback, 128> callback);
 
 
   /**
@@ -44,7 +52,7 @@ public:
    *
    * The given callback will live until this object is destroyed.
    */
-  void onNoopTimeout(TimeoutCallback callback);
+  void onNoopTimeout(InplaceCallback<TimeoutCallback> callback);
 
   /**
    * @brief startNoopTimer
@@ -57,12 +65,42 @@ public:
    */
   bool stopNoopTimer();
 
+  Millisec noopTimeout() const { return m_noopTimeout; }
+
 
   void close() { static_cast<T*>(this)->socket().lowest_layer().close(); }
 
 
+  /**
+   * @brief handlerMemory
+   * @return The memory to allocate the state of the asynchronous operations on this connection from.
+   */
+  const std::shared_ptr<HandlerMemory>& handlerMemory() const { return m_handlerMemory; }
+
+  /**
+   * @brief contentDecoder
+   * @return The decoder of the compressed bodies received on this connection, reused by every response.
+   */
+  ContentDecoder& contentDecoder() { return m_contentDecoder; }
+
+  /**
+   * @brief timing
+   * @return When the last connection was made; only the connect and handshake phases are set.
+   */
+  const Timing& timing() const { return m_timing; }
+
+
 protected:
-  void onConnect_(const ErrorCode& ec, const tcp::resolver::iterator& endpointIt, ConnectCallback callback);
+  void onConnect_(const ErrorCode& ec, const tcp::endpoint& endpoint, InplaceCallback<ConnectCallback, 128> callback);
+
+  /**
+   * @brief resetSocket_ Called before a closed socket is connected again; overridden to start over the state
+   *of the stream.
+   */
+  void resetSocket_() { }
+
+protected:
+  Timing m_timing;
 
 
   /**
@@ -76,15 +114,18 @@ private:
    * @brief connectCompleted Internal method used to take action when the connect action is completed (successful
    *or not).
    * @param ec
-   * @param endpointIt
+   * @param endpoint
    */
-  void connectCompleted(const ErrorCode& ec, const tcp::resolver::iterator& endpointIt);
+  void connectCompleted(const ErrorCode& ec, const tcp::endpoint& endpoint);
 
 private:
   boost::posix_time::millisec m_noopTimeout;
   boost::asio::deadline_timer m_noopTimer;
 
-  TimeoutCallback m_noopCallback;
+  InplaceCallback<TimeoutCallback> m_noopCallback;
+
+  std::shared_ptr<HandlerMemory> m_handlerMemory;
+  ContentDecoder m_contentDecoder;
 };
 
 extern template class ConnectionCRTPBase<ConnectionImpl<Protocol::HTTP>>;
@@ -0,0 +1,346 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "contentdecoder.hpp"
+
+#include "scan.hpp"
+
+#include <zlib.h>
+
+#ifdef ASHTTP_WITH_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef ASHTTP_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+namespace ashttp {
+
+namespace {
+
+bool isCoding(boost::string_view value, const char* lowerName) {
+  const auto size = std::strlen(lowerName);
+
+  return value.size() == size && scan::equalsLower(value.data(), lowerName, size);
+}
+
+}
+
+struct ContentDecoder::Zlib {
+  Zlib() {
+    std::memset(&stream, 0, sizeof(stream));
+  }
+
+  ~Zlib() {
+    if (initialized)
+      inflateEnd(&stream);
+  }
+
+  /**
+   * @brief reset Prepares for a new stream; the window is kept if \p windowBits does not change.
+   */
+  bool reset(int windowBits) {
+    if (!initialized)
+      return (initialized = inflateInit2(&stream, windowBits) == Z_OK);
+
+    return inflateReset2(&stream, windowBits) == Z_OK;
+  }
+
+  z_stream stream;
+  bool initialized = false;
+};
+
+#ifdef ASHTTP_WITH_BROTLI
+struct ContentDecoder::Brotli {
+  ~Brotli() {
+    if (state)
+      BrotliDecoderDestroyInstance(state);
+  }
+
+  BrotliDecoderState* state = nullptr;
+};
+#else
+struct ContentDecoder::Brotli { };
+#endif
+
+#ifdef ASHTTP_WITH_ZSTD
+struct ContentDecoder::Zstd {
+  ~Zstd() { ZSTD_freeDCtx(context); }
+
+  ZSTD_DCtx* context = ZSTD_createDCtx();
+};
+#else
+struct ContentDecoder::Zstd { };
+#endif
+
+ContentDecoder::ContentDecoder()
+    : m_coding{Coding::Identity}
+    , m_finished{true}
+    , m_probe{false} { }
+
+ContentDecoder::~ContentDecoder() = default;
+
+ContentDecoder::Coding ContentDecoder::coding(boost::string_view contentEncoding) {
+  if (contentEncoding.empty() || isCoding(contentEncoding, "identity"))
+    return Coding::Identity;
+
+  if (isCoding(contentEncoding, "gzip") || isCoding(contentEncoding, "x-gzip"))
+    return Coding::Gzip;
+
+  if (isCoding(contentEncoding, "deflate"))
+    return Coding::Deflate;
+
+#ifdef ASHTTP_WITH_BROTLI
+  if (isCoding(contentEncoding, "br"))
+    return Coding::Brotli;
+#endif
+
+#ifdef ASHTTP_WITH_ZSTD
+  if (isCoding(contentEncoding, "zstd"))
+    return Coding::Zstd;
+#endif
+
+  return Coding::Unsupported;
+}
+
+const char* ContentDecoder::acceptEncoding() {
+  return "gzip, deflate"
+#ifdef ASHTTP_WITH_BROTLI
+         ", br"
+#endif
+#ifdef ASHTTP_WITH_ZSTD
+         ", zstd"
+#endif
+      ;
+}
+
+void ContentDecoder::reset(Coding coding) {
+  assert(coding != Coding::Unsupported);
+
+  m_coding = coding;
+  m_finished = coding == Coding::Identity;
+  m_probe = false;
+
+  switch (coding) {
+  case Coding::Gzip:
+    if (!m_zlib)
+      m_zlib.reset(new Zlib);
+
+    // a zlib header is accepted too, some servers send one for gzip
+    if (!m_zlib->reset(15 + 32))
+      m_coding = Coding::Unsupported; // out of memory, fails in decode()
+    break;
+
+  case Coding::Deflate:
+    if (!m_zlib)
+      m_zlib.reset(new Zlib);
+
+    // should have a zlib header, but some servers send raw deflate; decided on the first bytes
+    m_probe = true;
+    break;
+
+#ifdef ASHTTP_WITH_BROTLI
+  case Coding::Brotli:
+    if (!m_brotli)
+      m_brotli.reset(new Brotli);
+
+    // the library has no way to reset a decoder
+    if (m_brotli->state)
+      BrotliDecoderDestroyInstance(m_brotli->state);
+
+    if (!(m_brotli->state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)))
+      m_coding = Coding::Unsupported;
+    break;
+#endif
+
+#ifdef ASHTTP_WITH_ZSTD
+  case Coding::Zstd:
+    if (!m_zstd)
+      m_zstd.reset(new Zstd);
+
+    if (!m_zstd->context || ZSTD_isError(ZSTD_DCtx_reset(m_zstd->context, ZSTD_reset_session_only)))
+      m_coding = Coding::Unsupported;
+    break;
+#endif
+
+  default:
+    break;
+  }
+}
+
+ContentDecoder::Result ContentDecoder::decode(const char*& in, const char* inEnd, char*& out, char* outEnd) {
+  switch (m_coding) {
+  case Coding::Identity: {
+    const auto size = std::min(inEnd - in, outEnd - out);
+
+    std::memcpy(out, in, size);
+    in += size;
+    out += size;
+
+    return Result::Ok;
+  }
+
+  case Coding::Gzip:
+  case Coding::Deflate:
+    return decodeZlib(in, inEnd, out, outEnd);
+
+#ifdef ASHTTP_WITH_BROTLI
+  case Coding::Brotli:
+    return decodeBrotli(in, inEnd, out, outEnd);
+#endif
+
+#ifdef ASHTTP_WITH_ZSTD
+  case Coding::Zstd:
+    return decodeZstd(in, inEnd, out, outEnd);
+#endif
+
+  default:
+    return Result::Error;
+  }
+}
+
+ContentDecoder::Result ContentDecoder::decodeZlib(const char*& in, const char* inEnd, char*& out, char* outEnd) {
+  if (m_probe) {
+    if (in == inEnd)
+      return Result::Ok;
+
+    const auto cmf = static_cast<unsigned char>(in[0]);
+    auto zlibHeader = (cmf & 0x0f) == Z_DEFLATED && (cmf >> 4) <= 7;
+
+    if (zlibHeader && inEnd - in >= 2)
+      zlibHeader = ((cmf << 8) | static_cast<unsigned char>(in[1])) % 31 == 0;
+
+    m_probe = false;
+
+    if (!m_zlib->reset(zlibHeader ? 15 : -15))
+      return Result::Error;
+  }
+
+  auto& stream = m_zlib->stream;
+
+  for (;;) {
+    if (m_finished) {
+      // gzip allows several members one after the other
+      if (m_coding != Coding::Gzip || in == inEnd || static_cast<unsigned char>(*in) != 0x1f)
+        return Result::End;
+
+      if (inflateReset(&stream) != Z_OK)
+        return Result::Error;
+
+      m_finished = false;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+    stream.avail_in = static_cast<uInt>(std::min<std::ptrdiff_t>(inEnd - in, UINT_MAX));
+    stream.next_out = reinterpret_cast<Bytef*>(out);
+    stream.avail_out = static_cast<uInt>(std::min<std::ptrdiff_t>(outEnd - out, UINT_MAX));
+
+    const auto result = inflate(&stream, Z_NO_FLUSH);
+
+    in = reinterpret_cast<const char*>(stream.next_in);
+    out = reinterpret_cast<char*>(stream.next_out);
+
+    switch (result) {
+    case Z_STREAM_END:
+      m_finished = true;
+      break;
+
+    case Z_OK:
+    case Z_BUF_ERROR: // no progress possible without more input or output room
+      return Result::Ok;
+
+    default:
+      return Result::Error;
+    }
+  }
+}
+
+#ifdef ASHTTP_WITH_BROTLI
+ContentDecoder::Result ContentDecoder::decodeBrotli(const char*& in, const char* inEnd, char*& out, char* outEnd) {
+  if (m_finished)
+    return Result::End;
+
+  auto availableIn = static_cast<std::size_t>(inEnd - in);
+  auto nextIn = reinterpret_cast<const std::uint8_t*>(in);
+  auto availableOut = static_cast<std::size_t>(outEnd - out);
+  auto nextOut = reinterpret_cast<std::uint8_t*>(out);
+
+  const auto result = BrotliDecoderDecompressStream(m_brotli->state, &availableIn, &nextIn, &availableOut, &nextOut, nullptr);
+
+  in = reinterpret_cast<const char*>(nextIn);
+  out = reinterpret_cast<char*>(nextOut);
+
+  switch (result) {
+  case BROTLI_DECODER_RESULT_SUCCESS:
+    m_finished = true;
+    return Result::End;
+
+  case BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT:
+  case BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT:
+    return Result::Ok;
+
+  default:
+    return Result::Error;
+  }
+}
+#endif
+
+#ifdef ASHTTP_WITH_ZSTD
+ContentDecoder::Result ContentDecoder::decodeZstd(const char*& in, const char* inEnd, char*& out, char* outEnd) {
+  for (;;) {
+    if (m_finished) {
+      // frames may follow each other
+      if (in == inEnd)
+        return Result::End;
+
+      m_finished = false;
+    }
+
+    ZSTD_inBuffer input{in, static_cast<std::size_t>(inEnd - in), 0};
+    ZSTD_outBuffer output{out, static_cast<std::size_t>(outEnd - out), 0};
+
+    const auto result = ZSTD_decompressStream(m_zstd->context, &output, &input);
+
+    in += input.pos;
+    out += output.pos;
+
+    if (ZSTD_isError(result))
+      return Result::Error;
+
+    if (result != 0) // in the middle of a frame
+      return Result::Ok;
+
+    m_finished = true;
+  }
+}
+#endif
+
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <boost/utility/string_view.hpp>
+
+#include <memory>
+
+namespace ashttp {
+
+/**
+ * @brief ContentDecoder Decompresses a body that is sent with a content coding, as it is received.
+ *
+ * gzip and deflate are always supported. br is supported when built with ASHTTP_WITH_BROTLI (linking
+ *libbrotlidec) and zstd when built with ASHTTP_WITH_ZSTD (linking libzstd).
+ *
+ * The decompression state is allocated on the first body that needs it and reused by reset() for the
+ *following ones, so a connection keeps one decoder for all of its responses.
+ */
+class ContentDecoder {
+public:
+  enum class Coding {
+    Identity,
+    Gzip,
+    Deflate,
+    Brotli,
+    Zstd,
+    Unsupported // unknown, not built in, or more than one coding
+  };
+
+  enum class Result {
+    Ok,   // the input is consumed or the output is full
+    End,  // the end of the compressed stream
+    Error
+  };
+
+public:
+  ContentDecoder();
+  ~ContentDecoder();
+
+  ContentDecoder(const ContentDecoder&) = delete;
+  ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+  /**
+   * @brief coding
+   * @param contentEncoding The value of a content-encoding field.
+   * @return The coding to decode the body with.
+   */
+  static Coding coding(boost::string_view contentEncoding);
+
+  /**
+   * @brief acceptEncoding
+   * @return The value of the accept-encoding field listing the supported codings.
+   */
+  static const char* acceptEncoding();
+
+  /**
+   * @brief reset Starts decoding a new body with \p coding, which must be supported.
+   */
+  void reset(Coding coding);
+
+  Coding coding() const { return m_coding; }
+
+  /**
+   * @brief finished
+   * @return true if the whole compressed stream is decoded.
+   */
+  bool finished() const { return m_finished; }
+
+  /**
+   * @brief decode Decodes from [\p in, \p inEnd) into [\p out, \p outEnd).
+   * @param in Advanced past the consumed input.
+   * @param inEnd
+   * @param out Advanced past the produced output.
+   * @param outEnd
+   * @return Result::Ok if more input or more room for the output is needed. Input after the end of the
+   *stream is not consumed.
+   *
+   * Decoders buffer internally, so if the output is filled it must be called again even without more input.
+   */
+  Result decode(const char*& in, const char* inEnd, char*& out, char* outEnd);
+
+private:
+  struct Zlib;
+  struct Brotli;
+  struct Zstd;
+
+  Result decodeZlib(const char*& in, const char* inEnd, char*& out, char* outEnd);
+  Result decodeBrotli(const char*& in, const char* inEnd, char*& out, char* outEnd);
+  Result decodeZstd(const char*& in, const char* inEnd, char*& out, char* outEnd);
+
+private:
+  Coding m_coding;
+  bool m_finished;
+  bool m_probe; // the deflate stream is not yet known to have a zlib header or not
+
+  std::unique_ptr<Zlib> m_zlib;
+  std::unique_ptr<Brotli> m_brotli;
+  std::unique_ptr<Zstd> m_zstd;
+};
+
+}
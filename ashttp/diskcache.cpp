@@ -0,0 +1,702 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "diskcache.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ashttp {
+
+namespace {
+
+const std::uint32_t RecordMagic = 0x61736863; // "ashc"
+
+enum class RecordType : std::uint8_t {
+  Store = 1,
+  Erase = 2
+};
+
+ErrorCode lastError() {
+  return ErrorCode{errno, boost::system::system_category()};
+}
+
+std::int64_t systemNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ErrorCode writeAll(int fd, const char* data, std::size_t size, std::uint64_t offset) {
+  while (size > 0) {
+    const auto written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return lastError();
+    }
+
+    data += written;
+    size -= static_cast<std::size_t>(written);
+    offset += static_cast<std::uint64_t>(written);
+  }
+
+  return error::success;
+}
+
+template <class T>
+void put(std::string& out, const T& value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put(std::string& out, const std::string& value) {
+  put(out, static_cast<std::uint32_t>(value.size()));
+  out.append(value);
+}
+
+/**
+ * @brief Reader Reads the fields of an index record, it fails at the end of the data.
+ */
+class Reader {
+public:
+  Reader(const char* data, std::size_t size)
+      : m_data{data}
+      , m_end{data + size} { }
+
+  template <class T>
+  bool get(T& value) {
+    if (static_cast<std::size_t>(m_end - m_data) < sizeof(value))
+      return false;
+
+    std::memcpy(&value, m_data, sizeof(value));
+    m_data += sizeof(value);
+
+    return true;
+  }
+
+  bool get(std::string& value) {
+    std::uint32_t size;
+
+    if (!get(size) || static_cast<std::size_t>(m_end - m_data) < size)
+      return false;
+
+    value.assign(m_data, size);
+    m_data += size;
+
+    return true;
+  }
+
+  bool get(bool& value) {
+    std::uint8_t byte;
+
+    if (!get(byte))
+      return false;
+
+    value = byte != 0;
+
+    return true;
+  }
+
+private:
+  const char* m_data;
+  const char* m_end;
+};
+
+}
+
+struct DiskCache::Segment {
+  Segment(std::string path, int fd, const char* data, std::size_t mapped, std::uint64_t size)
+      : path{std::move(path)}
+      , fd{fd}
+      , data{data}
+      , mapped{mapped}
+      , size{size} { }
+
+  ~Segment() {
+    if (data)
+      ::munmap(const_cast<char*>(data), mapped);
+
+    ::close(fd);
+  }
+
+  Segment(const Segment&) = delete;
+  Segment& operator=(const Segment&) = delete;
+
+  const std::string path;
+  const int fd;
+  const char* const data;
+  const std::size_t mapped;
+  std::uint64_t size; // the bytes written
+};
+
+std::shared_ptr<DiskCache> DiskCache::open(const std::string& directory, ErrorCode& ec, Options options) {
+  if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    ec = lastError();
+
+    return nullptr;
+  }
+
+  const auto indexFd = ::open((directory + "/index").c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+  if (indexFd < 0) {
+    ec = lastError();
+
+    return nullptr;
+  }
+
+  std::shared_ptr<DiskCache> cache{new DiskCache{directory, indexFd, options}};
+
+  ec = cache->load();
+
+  if (ec)
+    return nullptr;
+
+  cache->m_writer = std::thread{&DiskCache::run, cache.get()};
+
+  return cache;
+}
+
+DiskCache::DiskCache(std::string directory, int indexFd, Options options)
+    : m_directory{std::move(directory)}
+    , m_indexFd{indexFd}
+    , m_options{options}
+    , m_size{0}
+    , m_records{0}
+    , m_queued{0}
+    , m_writing{nullptr}
+    , m_canceled{false}
+    , m_stopping{false}
+    , m_hits{0}
+    , m_misses{0}
+    , m_stores{0}
+    , m_evictions{0} { }
+
+DiskCache::~DiskCache() {
+  if (m_writer.joinable()) { // the queued jobs are done first
+    {
+      std::lock_guard<std::mutex> l{m_mutex};
+
+      m_stopping = true;
+    }
+
+    m_wake.notify_one();
+    m_writer.join();
+  }
+
+  ::close(m_indexFd);
+}
+
+std::shared_ptr<const Cache::Entry> DiskCache::find(const std::string& key) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  // an entry waiting to be written is served as it was stored, the latest one first
+  for (auto job = m_jobs.rbegin(); job != m_jobs.rend(); ++job) {
+    if (job->type == JobType::Store && job->key == key) {
+      ++m_hits;
+
+      return job->entry;
+    }
+  }
+
+  if (m_writing && m_writing->type == JobType::Store && !m_canceled && m_writing->key == key) {
+    ++m_hits;
+
+    return m_writing->entry;
+  }
+
+  const auto it = m_entries.find(key);
+
+  if (it == m_entries.end()) {
+    ++m_misses;
+
+    return nullptr;
+  }
+
+  ++m_hits;
+
+  const auto& location = it->second;
+  const auto& segment = m_segments.at(location.segment);
+  const auto data = segment->data + location.offset;
+
+  auto entry = std::make_shared<Cache::Entry>();
+
+  entry->header.assign(data, location.headerSize);
+  entry->body = boost::string_view{data + location.headerSize, static_cast<std::size_t>(location.bodySize)};
+  entry->bodyOwner = segment;
+
+  // the time spent on the disk, possibly across restarts, is taken from the system clock
+  const auto onDisk = std::chrono::nanoseconds{std::max<std::int64_t>(systemNow() - location.storedAt, 0)};
+
+  entry->storedAt = Cache::Clock::now() - std::chrono::duration_cast<Cache::Clock::duration>(onDisk);
+  entry->initialAge = std::chrono::duration_cast<Cache::Clock::duration>(std::chrono::nanoseconds{location.initialAge});
+  entry->lifetime = std::chrono::duration_cast<Cache::Clock::duration>(std::chrono::nanoseconds{location.lifetime});
+  entry->etag = location.etag;
+  entry->lastModified = location.lastModified;
+  entry->encoded = location.encoded;
+
+  return entry;
+}
+
+void DiskCache::store(const std::string& key, std::shared_ptr<const Cache::Entry> entry) {
+  const auto size = entry->size();
+
+  if (size > m_options.segmentSize || size > m_options.capacity) // does not fit into a segment
+    return;
+
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    // the caller is not held up by a slow disk, the entry is kept in memory only
+    if (m_queued > 0 && m_queued + size > m_options.segmentSize)
+      return;
+
+    m_queued += size;
+    m_jobs.push_back(Job{JobType::Store, key, std::move(entry), Location{}});
+  }
+
+  m_wake.notify_one();
+}
+
+void DiskCache::refresh(const std::string& key, const Cache::Entry& entry) {
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    const auto it = m_entries.find(key);
+
+    if (it == m_entries.end())
+      return;
+
+    auto& location = it->second;
+
+    location.storedAt = systemNow() - std::chrono::duration_cast<std::chrono::nanoseconds>(Cache::Clock::now() - entry.storedAt).count();
+    location.initialAge = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.initialAge).count();
+    location.lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.lifetime).count();
+    location.etag = entry.etag;
+    location.lastModified = entry.lastModified;
+
+    m_jobs.push_back(Job{JobType::Refresh, key, nullptr, location});
+  }
+
+  m_wake.notify_one();
+}
+
+void DiskCache::erase(const std::string& key) {
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    const auto erased = m_entries.erase(key) > 0;
+
+    // the queued writes of the entry are dropped
+    for (auto job = m_jobs.begin(); job != m_jobs.end();) {
+      if (job->type != JobType::Erase && job->key == key) {
+        if (job->entry)
+          m_queued -= job->entry->size();
+
+        job = m_jobs.erase(job);
+      } else {
+        ++job;
+      }
+    }
+
+    const auto writing = m_writing && m_writing->type != JobType::Erase && m_writing->key == key;
+
+    if (writing)
+      m_canceled = true;
+
+    if (!erased && !writing) // there is no record of it
+      return;
+
+    m_jobs.push_back(Job{JobType::Erase, key, nullptr, Location{}});
+  }
+
+  m_wake.notify_one();
+}
+
+DiskCache::Stats DiskCache::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return Stats{m_hits, m_misses, m_stores, m_evictions, m_entries.size(), m_size, m_segments.size()};
+}
+
+ErrorCode DiskCache::load() {
+  // map the segments
+  if (const auto dir = ::opendir(m_directory.c_str())) {
+    while (const auto dirEntry = ::readdir(dir)) {
+      char* end = nullptr;
+
+      if (std::strncmp(dirEntry->d_name, "segment-", 8) != 0)
+        continue;
+
+      const auto id = std::strtoull(dirEntry->d_name + 8, &end, 10);
+
+      if (*end != '\0')
+        continue;
+
+      const auto path = segmentPath(id);
+      const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+      if (fd < 0)
+        continue;
+
+      struct stat st;
+
+      if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        ::unlink(path.c_str());
+
+        continue;
+      }
+
+      const auto size = static_cast<std::size_t>(st.st_size);
+      const auto data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+      if (data == MAP_FAILED) {
+        ::close(fd);
+
+        continue;
+      }
+
+      m_segments.emplace(id, std::make_shared<Segment>(path, fd, static_cast<const char*>(data), size, size));
+      m_size += size;
+    }
+
+    ::closedir(dir);
+  } else {
+    return lastError();
+  }
+
+  // replay the index, a later record of a key replaces the earlier ones
+  std::string index;
+  char buf[64 * 1024];
+
+  for (std::uint64_t offset = 0;;) {
+    const auto bytes = ::pread(m_indexFd, buf, sizeof(buf), static_cast<off_t>(offset));
+
+    if (bytes < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return lastError();
+    }
+
+    if (bytes == 0)
+      break;
+
+    index.append(buf, static_cast<std::size_t>(bytes));
+    offset += static_cast<std::uint64_t>(bytes);
+  }
+
+  Reader records{index.data(), index.size()};
+
+  for (;;) {
+    std::uint32_t magic;
+    std::string payload; // preceded by its size
+
+    // a record cut short by a crash ends the index
+    if (!records.get(magic) || magic != RecordMagic || !records.get(payload))
+      break;
+
+    Reader record{payload.data(), payload.size()};
+    std::uint8_t type;
+    std::string key;
+
+    if (!record.get(type) || !record.get(key))
+      break;
+
+    if (type == static_cast<std::uint8_t>(RecordType::Erase)) {
+      m_entries.erase(key);
+
+      continue;
+    }
+
+    Location location;
+
+    if (!record.get(location.segment) || !record.get(location.offset) || !record.get(location.headerSize) ||
+        !record.get(location.bodySize) || !record.get(location.storedAt) || !record.get(location.initialAge) ||
+        !record.get(location.lifetime) || !record.get(location.etag) || !record.get(location.lastModified) ||
+        !record.get(location.encoded))
+      break;
+
+    const auto segment = m_segments.find(location.segment);
+
+    // the segment may have been evicted
+    if (segment == m_segments.end() || location.offset + location.headerSize + location.bodySize > segment->second->size) {
+      m_entries.erase(key);
+
+      continue;
+    }
+
+    m_entries[key] = std::move(location);
+  }
+
+  evict();
+
+  return compact(m_entries);
+}
+
+void DiskCache::run() {
+  std::unique_lock<std::mutex> l{m_mutex};
+
+  for (;;) {
+    m_wake.wait(l, [this] { return m_stopping || !m_jobs.empty(); });
+
+    if (m_jobs.empty()) // stopping
+      return;
+
+    const auto job = std::move(m_jobs.front());
+
+    m_jobs.pop_front();
+    m_writing = &job;
+    m_canceled = false;
+
+    l.unlock();
+
+    // a failed write leaves the entry out of the disk tier, it is in memory
+    switch (job.type) {
+    case JobType::Store:
+      write(job.key, *job.entry);
+      break;
+
+    case JobType::Refresh:
+      append(job.key, &job.location);
+      break;
+
+    case JobType::Erase:
+      append(job.key, nullptr);
+      break;
+    }
+
+    l.lock();
+
+    m_writing = nullptr;
+
+    if (job.entry)
+      m_queued -= job.entry->size();
+
+    if (m_records > 2 * m_entries.size() + 64) {
+      // the records of the changes made meanwhile are appended to the new index by the jobs queued for them
+      const auto entries = m_entries;
+
+      l.unlock();
+      compact(entries);
+      l.lock();
+    }
+  }
+}
+
+void DiskCache::write(const std::string& key, const Cache::Entry& entry) {
+  const auto size = entry.size();
+
+  if (!m_current || m_current->size + size > m_options.segmentSize) {
+    if (nextSegment())
+      return;
+  }
+
+  Location location;
+
+  location.segment = m_segments.rbegin()->first;
+  location.offset = m_current->size;
+  location.headerSize = static_cast<std::uint32_t>(entry.header.size());
+  location.bodySize = entry.body.size();
+  location.storedAt = systemNow() - std::chrono::duration_cast<std::chrono::nanoseconds>(Cache::Clock::now() - entry.storedAt).count();
+  location.initialAge = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.initialAge).count();
+  location.lifetime = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.lifetime).count();
+  location.etag = entry.etag;
+  location.lastModified = entry.lastModified;
+  location.encoded = entry.encoded;
+
+  // the data is synced before the record is appended, so a record points to complete data after a power loss too
+  auto ec = writeAll(m_current->fd, entry.header.data(), entry.header.size(), location.offset);
+
+  if (!ec)
+    ec = writeAll(m_current->fd, entry.body.data(), entry.body.size(), location.offset + location.headerSize);
+
+  if (!ec && ::fdatasync(m_current->fd) != 0)
+    ec = lastError();
+
+  if (ec)
+    return;
+
+  ec = append(key, &location);
+
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  m_current->size += size;
+  m_size += size;
+
+  if (!ec && !m_canceled) {
+    m_entries[key] = std::move(location);
+    ++m_stores;
+  }
+
+  evict();
+}
+
+ErrorCode DiskCache::compact(const std::unordered_map<std::string, Location>& entries) {
+  const auto path = m_directory + "/index";
+  const auto tmpPath = path + ".tmp";
+  auto fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+
+  if (fd < 0)
+    return lastError();
+
+  std::swap(fd, m_indexFd);
+
+  ErrorCode ec;
+
+  m_records = 0;
+
+  for (const auto& entry : entries) {
+    ec = append(entry.first, &entry.second);
+
+    if (ec)
+      break;
+  }
+
+  // the new index is complete on the disk before it replaces the old one
+  if (!ec && ::fsync(m_indexFd) != 0)
+    ec = lastError();
+
+  if (!ec && ::rename(tmpPath.c_str(), path.c_str()) != 0)
+    ec = lastError();
+
+  if (ec) { // keep appending to the old index
+    std::swap(fd, m_indexFd);
+    ::unlink(tmpPath.c_str());
+  }
+
+  ::close(fd);
+
+  return ec;
+}
+
+ErrorCode DiskCache::append(const std::string& key, const Location* location) {
+  std::string record;
+
+  put(record, RecordMagic);
+  put(record, std::uint32_t{0}); // the size, set below
+  put(record, static_cast<std::uint8_t>(location ? RecordType::Store : RecordType::Erase));
+  put(record, key);
+
+  if (location) {
+    put(record, location->segment);
+    put(record, location->offset);
+    put(record, location->headerSize);
+    put(record, location->bodySize);
+    put(record, location->storedAt);
+    put(record, location->initialAge);
+    put(record, location->lifetime);
+    put(record, location->etag);
+    put(record, location->lastModified);
+    put(record, static_cast<std::uint8_t>(location->encoded));
+  }
+
+  const auto size = static_cast<std::uint32_t>(record.size() - 2 * sizeof(std::uint32_t));
+
+  std::memcpy(&record[sizeof(std::uint32_t)], &size, sizeof(size));
+
+  // one write, the index is opened for appending
+  for (std::size_t written = 0; written < record.size();) {
+    const auto bytes = ::write(m_indexFd, record.data() + written, record.size() - written);
+
+    if (bytes < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return lastError();
+    }
+
+    written += static_cast<std::size_t>(bytes);
+  }
+
+  ++m_records;
+
+  return error::success;
+}
+
+ErrorCode DiskCache::nextSegment() {
+  const auto id = m_segments.empty() ? 1 : m_segments.rbegin()->first + 1;
+  const auto path = segmentPath(id);
+  const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0)
+    return lastError();
+
+  // mapped in whole, only the written part is ever read
+  const auto data = ::mmap(nullptr, m_options.segmentSize, PROT_READ, MAP_SHARED, fd, 0);
+
+  if (data == MAP_FAILED) {
+    const auto ec = lastError();
+
+    ::close(fd);
+    ::unlink(path.c_str());
+
+    return ec;
+  }
+
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  m_current = std::make_shared<Segment>(path, fd, static_cast<const char*>(data), m_options.segmentSize, 0);
+  m_segments.emplace(id, m_current);
+
+  return error::success;
+}
+
+void DiskCache::evict() {
+  while (m_size > m_options.capacity && !m_segments.empty() && m_segments.begin()->second != m_current) {
+    const auto oldest = m_segments.begin();
+
+    // the entries being served keep the mapping
+    ::unlink(oldest->second->path.c_str());
+
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+      if (it->second.segment == oldest->first)
+        it = m_entries.erase(it);
+      else
+        ++it;
+    }
+
+    m_size -= oldest->second->size;
+    ++m_evictions;
+
+    m_segments.erase(oldest);
+  }
+}
+
+std::string DiskCache::segmentPath(std::uint64_t id) const {
+  return m_directory + "/segment-" + std::to_string(id);
+}
+
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "cache.hpp"
+#include "type.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace ashttp {
+
+/**
+ * @brief DiskCache The on-disk tier of a Cache, it keeps the responses across restarts.
+ *
+ * Responses are appended to segment files in a directory and an index file records where each one is; both
+ *are only appended to, the index is compacted when it is opened and when it has grown to twice the live
+ *records. The segments are memory-mapped and the bodies are served from the mapping without being read.
+ *
+ * When the segments exceed the capacity the oldest one is deleted together with its entries. An entry that is
+ *being served keeps the mapping of its segment alive.
+ *
+ * The files are written by a thread of the cache, in the order of the calls, so that storing does not block
+ *the caller on the disk; an entry waiting to be written is found in memory meanwhile. The data of an entry is
+ *synced before its index record is written, so after a crash or a power loss every record points to complete
+ *data; the index itself is not synced, the entries of the last records may be lost.
+ *
+ * Thread-safe. The files are in the byte order of the host, they are not meant to be moved between machines.
+ */
+class DiskCache {
+public:
+  struct Options {
+    Options() { }
+
+    std::uint64_t capacity = 1024 * 1024 * 1024; // the most bytes of segments to keep, a few times segmentSize
+    std::size_t segmentSize = 64 * 1024 * 1024;  // the size of a segment, also the largest entry
+  };
+
+  struct Stats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t stores;
+    std::uint64_t evictions; // evicted segments
+    std::size_t entries;
+    std::uint64_t size; // bytes in the segments
+    std::size_t segments;
+  };
+
+public:
+  /**
+   * @brief open Opens (creating if needed) a disk cache in \p directory and loads its index.
+   * @param directory
+   * @param ec Set on failure.
+   * @param options
+   * @return The cache, nullptr on failure.
+   */
+  static std::shared_ptr<DiskCache> open(const std::string& directory, ErrorCode& ec, Options options = Options{});
+
+  ~DiskCache();
+
+  DiskCache(const DiskCache&) = delete;
+  DiskCache& operator=(const DiskCache&) = delete;
+
+  const Options& options() const { return m_options; }
+
+  /**
+   * @brief find
+   * @return The entry, with its body in the mapping of its segment; nullptr if not found.
+   */
+  std::shared_ptr<const Cache::Entry> find(const std::string& key);
+
+  /**
+   * @brief store Queues \p entry to be appended to the current segment.
+   *
+   * Entries are not stored while a segment's worth of them waits to be written.
+   */
+  void store(const std::string& key, std::shared_ptr<const Cache::Entry> entry);
+
+  /**
+   * @brief refresh Records the new freshness of a revalidated entry, the body is not written again.
+   */
+  void refresh(const std::string& key, const Cache::Entry& entry);
+
+  void erase(const std::string& key);
+
+  Stats stats() const;
+
+private:
+  struct Segment;
+
+  struct Location {
+    std::uint64_t segment;
+    std::uint64_t offset;
+    std::uint32_t headerSize;
+    std::uint64_t bodySize;
+
+    std::int64_t storedAt;   // nanoseconds since the epoch of the system clock
+    std::int64_t initialAge; // nanoseconds
+    std::int64_t lifetime;   // nanoseconds
+
+    std::string etag;
+    std::string lastModified;
+    bool encoded;
+  };
+
+  enum class JobType {
+    Store,
+    Refresh, // appends the record of location
+    Erase    // appends an erase record
+  };
+
+  struct Job {
+    JobType type;
+    std::string key;
+    std::shared_ptr<const Cache::Entry> entry; // to store
+    Location location;                         // to refresh
+  };
+
+  DiskCache(std::string directory, int indexFd, Options options);
+
+  /**
+   * @brief load Maps the segments and replays the index.
+   */
+  ErrorCode load();
+
+  /**
+   * @brief run Does the queued jobs until the cache is destroyed; the body of the writer thread.
+   */
+  void run();
+
+  /**
+   * @brief write Writes \p entry to the current segment and appends its record; called without the lock.
+   */
+  void write(const std::string& key, const Cache::Entry& entry);
+
+  /**
+   * @brief compact Rewrites the index with only the records of \p entries.
+   */
+  ErrorCode compact(const std::unordered_map<std::string, Location>& entries);
+
+  /**
+   * @brief append Appends a record to the index, an erase record if \p location is nullptr.
+   */
+  ErrorCode append(const std::string& key, const Location* location);
+
+  /**
+   * @brief nextSegment Starts a new segment to append to; called without the lock.
+   */
+  ErrorCode nextSegment();
+
+  /**
+   * @brief evict Deletes the oldest segments until the size is within the capacity.
+   */
+  void evict();
+
+  std::string segmentPath(std::uint64_t id) const;
+
+private:
+  const std::string m_directory;
+  int m_indexFd; // used by the writer thread
+  const Options m_options;
+
+  mutable std::mutex m_mutex;
+  std::map<std::uint64_t, std::shared_ptr<Segment>> m_segments; // by id, changed by the writer thread
+  std::shared_ptr<Segment> m_current;                           // appended to, created by this process
+  std::unordered_map<std::string, Location> m_entries;          // written to the disk
+  std::uint64_t m_size;
+  std::size_t m_records; // in the index file
+
+  std::deque<Job> m_jobs;
+  std::size_t m_queued; // bytes of the entries to store, with the one being written
+  const Job* m_writing; // the job the writer thread is doing, if any
+  bool m_canceled;      // the entry of m_writing was erased meanwhile
+  bool m_stopping;
+  std::condition_variable m_wake;
+  std::thread m_writer;
+
+  std::uint64_t m_hits;
+  std::uint64_t m_misses;
+  std::uint64_t m_stores;
+  std::uint64_t m_evictions;
+};
+
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "endpointbalancer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ashttp {
+
+EndpointBalancer::EndpointBalancer(Options options)
+    : m_options{std::move(options)}
+    , m_next{0}
+    , m_random{std::random_device{}()} {
+  // balancers that are not shared do not all start on the same address
+  m_next = m_random();
+}
+
+void EndpointBalancer::update(const std::vector<Endpoint>& endpoints) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  std::vector<State> states;
+
+  states.reserve(endpoints.size());
+
+  for (const auto& endpoint : endpoints) {
+    if (const auto state = find(endpoint))
+      states.push_back(*state);
+    else
+      states.push_back(State{endpoint, 0, 0, 0, 0, 0, 0, Clock::time_point{}});
+  }
+
+  m_endpoints = std::move(states);
+}
+
+std::vector<EndpointBalancer::Endpoint> EndpointBalancer::candidates() {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  const auto now = Clock::now();
+
+  std::vector<const State*> healthy;
+  std::vector<const State*> ejected;
+
+  for (const auto& state : m_endpoints)
+    (state.ejectedUntil > now ? ejected : healthy).push_back(&state);
+
+  if (!healthy.empty()) {
+    // the ones that are not picked are tried in turn
+    std::rotate(healthy.begin(), healthy.begin() + m_next++ % healthy.size(), healthy.end());
+
+    auto picked = healthy.begin();
+
+    switch (m_options.policy) {
+    case Policy::RoundRobin:
+      break;
+
+    case Policy::LeastOutstanding:
+      picked = std::min_element(healthy.begin(), healthy.end(), [](const State* a, const State* b) {
+        return a->outstanding < b->outstanding;
+      });
+      break;
+
+    case Policy::PowerOfTwoChoices:
+      if (healthy.size() > 1) {
+        const auto first = m_random() % healthy.size();
+        auto second = m_random() % (healthy.size() - 1);
+
+        if (second >= first)
+          ++second;
+
+        picked = healthy.begin() + (healthy[second]->outstanding < healthy[first]->outstanding ? second : first);
+      }
+      break;
+    }
+
+    std::rotate(healthy.begin(), picked, picked + 1);
+  }
+
+  // the ejected ones that come back first are tried first
+  std::sort(ejected.begin(), ejected.end(), [](const State* a, const State* b) {
+    return a->ejectedUntil < b->ejectedUntil;
+  });
+
+  std::vector<Endpoint> result;
+
+  result.reserve(m_endpoints.size());
+
+  for (const auto state : healthy)
+    result.push_back(state->endpoint);
+
+  for (const auto state : ejected)
+    result.push_back(state->endpoint);
+
+  return result;
+}
+
+void EndpointBalancer::failed(const Endpoint& endpoint) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (const auto state = find(endpoint))
+    failure(*state, Clock::now());
+}
+
+void EndpointBalancer::started(const Endpoint& endpoint) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (const auto state = find(endpoint)) {
+    ++state->outstanding;
+    ++state->requests;
+  }
+}
+
+void EndpointBalancer::finished(const Endpoint& endpoint, Outcome outcome) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  const auto state = find(endpoint);
+
+  if (!state) // no longer resolved
+    return;
+
+  if (state->outstanding > 0)
+    --state->outstanding;
+
+  const auto now = Clock::now();
+
+  switch (outcome) {
+  case Outcome::Success:
+    state->failuresInRow = 0;
+
+    if (state->ejectedUntil <= now) // back for good
+      state->ejectionsInRow = 0;
+    break;
+
+  case Outcome::Failure:
+    failure(*state, now);
+    break;
+
+  case Outcome::Ignored:
+    break;
+  }
+}
+
+std::vector<EndpointBalancer::EndpointStats> EndpointBalancer::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  const auto now = Clock::now();
+
+  std::vector<EndpointStats> stats;
+
+  stats.reserve(m_endpoints.size());
+
+  for (const auto& state : m_endpoints) {
+    stats.push_back(EndpointStats{state.endpoint, state.outstanding, state.requests, state.failures, state.ejections,
+                                  state.ejectedUntil > now});
+  }
+
+  return stats;
+}
+
+EndpointBalancer::State* EndpointBalancer::find(const Endpoint& endpoint) {
+  const auto it = std::find_if(m_endpoints.begin(), m_endpoints.end(),
+                               [&endpoint](const State& state) { return state.endpoint == endpoint; });
+
+  return it != m_endpoints.end() ? &*it : nullptr;
+}
+
+void EndpointBalancer::failure(State& state, Clock::time_point now) {
+  ++state.failures;
+
+  if (++state.failuresInRow < m_options.ejectAfter || state.ejectedUntil > now)
+    return;
+
+  const auto ejected = std::count_if(m_endpoints.begin(), m_endpoints.end(),
+                                     [now](const State& state) { return state.ejectedUntil > now; });
+  const auto maxEjected = std::min(static_cast<std::size_t>(std::floor(m_options.maxEjectedRatio * m_endpoints.size())),
+                                   m_endpoints.size() - 1);
+
+  if (static_cast<std::size_t>(ejected) >= maxEjected) // kept, it is ejected once the others come back
+    return;
+
+  ++state.ejections;
+  ++state.ejectionsInRow;
+  state.failuresInRow = 0;
+  state.ejectedUntil = now + std::min(m_options.ejectionTime * static_cast<Clock::rep>(state.ejectionsInRow), m_options.maxEjectionTime);
+}
+
+}
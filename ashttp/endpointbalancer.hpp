@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace ashttp {
+
+/**
+ * @brief EndpointBalancer Spreads the connections of the clients of a host over all of its resolved addresses.
+ *
+ * A client connects to the first of candidates() that accepts it; the first one is picked by the policy and
+ *the others follow as fallbacks, the ejected ones last. The requests on each address are counted as
+ *outstanding while they run, and an address that fails ejectAfter times in a row (connecting, or a request
+ *completing with an error or a 5xx) is ejected for a time that grows with every ejection. No more than
+ *maxEjectedRatio of the addresses, and never all of them, are ejected at once.
+ *
+ * Every client has its own balancer; give the clients of a host the same one to balance between them.
+ *
+ * Thread-safe.
+ */
+class EndpointBalancer {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Endpoint = boost::asio::ip::tcp::endpoint;
+
+  enum class Policy {
+    RoundRobin,
+    LeastOutstanding,  // the least requests running, in turn among equals
+    PowerOfTwoChoices  // the one with less requests running of two picked at random
+  };
+
+  enum class Outcome {
+    Success,
+    Failure,
+    Ignored
+  };
+
+  struct Options {
+    Options() { }
+
+    Policy policy = Policy::PowerOfTwoChoices;
+    std::size_t ejectAfter = 3;                                    // failures in a row
+    Clock::duration ejectionTime = std::chrono::seconds{10};       // times the number of ejections in a row
+    Clock::duration maxEjectionTime = std::chrono::seconds{300};
+    double maxEjectedRatio = 0.5;
+  };
+
+  struct EndpointStats {
+    Endpoint endpoint;
+    std::size_t outstanding;
+    std::uint64_t requests;
+    std::uint64_t failures;
+    std::uint64_t ejections;
+    bool ejected;
+  };
+
+public:
+  explicit EndpointBalancer(Options options = Options{});
+
+  EndpointBalancer(const EndpointBalancer&) = delete;
+  EndpointBalancer& operator=(const EndpointBalancer&) = delete;
+
+  /**
+   * @brief update Sets the addresses of the host, keeping the state of the ones already known.
+   */
+  void update(const std::vector<Endpoint>& endpoints);
+
+  /**
+   * @brief candidates
+   * @return The addresses to try to connect to, in order.
+   */
+  std::vector<Endpoint> candidates();
+
+  /**
+   * @brief failed Records a failed connection attempt to \p endpoint.
+   */
+  void failed(const Endpoint& endpoint);
+
+  /**
+   * @brief started Records a request started on a connection to \p endpoint.
+   */
+  void started(const Endpoint& endpoint);
+
+  /**
+   * @brief finished Records the end of a request started on \p endpoint.
+   */
+  void finished(const Endpoint& endpoint, Outcome outcome);
+
+  const Options& options() const { return m_options; }
+
+  std::vector<EndpointStats> stats() const;
+
+private:
+  struct State {
+    Endpoint endpoint;
+    std::size_t outstanding;
+    std::uint64_t requests;
+    std::uint64_t failures;
+    std::size_t failuresInRow;
+    std::uint64_t ejections;
+    std::size_t ejectionsInRow;
+    Clock::time_point ejectedUntil;
+  };
+
+  State* find(const Endpoint& endpoint);
+
+  void failure(State& state, Clock::time_point now);
+
+private:
+  const Options m_options;
+
+  mutable std::mutex m_mutex;
+  std::vector<State> m_endpoints;
+  std::size_t m_next; // where the turn starts
+  std::minstd_rand m_random;
+};
+
+}
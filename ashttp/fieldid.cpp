@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fieldid.hpp"
+
+#include "scan.hpp"
+
+namespace ashttp {
+
+namespace {
+
+constexpr const char* FieldNames[FieldIdCount] = {
+    "",
+    "age",
+    "accept-ranges",
+    "alt-svc",
+    "cache-control",
+    "connection",
+    "content-disposition",
+    "content-encoding",
+    "content-length",
+    "content-location",
+    "content-range",
+    "content-type",
+    "date",
+    "etag",
+    "expires",
+    "keep-alive",
+    "last-modified",
+    "location",
+    "pragma",
+    "proxy-authenticate",
+    "retry-after",
+    "server",
+    "set-cookie",
+    "strict-transport-security",
+    "trailer",
+    "transfer-encoding",
+    "upgrade",
+    "vary",
+    "via",
+    "www-authenticate",
+};
+
+constexpr std::size_t FieldTableSize = 64;
+
+constexpr std::size_t length(const char* name) {
+  std::size_t size = 0;
+
+  while (name[size] != 0)
+    ++size;
+
+  return size;
+}
+
+constexpr unsigned lower(char c) {
+  return static_cast<unsigned char>((c >= 'A' && c <= 'Z') ? (c | 0x20) : c);
+}
+
+// length and three characters are enough to tell the well-known names apart
+constexpr std::size_t fieldHash(const char* name, std::size_t size) {
+  return (size + lower(name[0]) * 2 + lower(name[size - 1]) * 15 + lower(name[size / 2]) * 12) % FieldTableSize;
+}
+
+struct FieldTable {
+  FieldId ids[FieldTableSize];
+  std::size_t sizes[FieldIdCount];
+  bool perfect;
+};
+
+constexpr FieldTable makeFieldTable() {
+  FieldTable table{{}, {}, true};
+
+  for (std::size_t i = 1; i < FieldIdCount; ++i) {
+    table.sizes[i] = length(FieldNames[i]);
+
+    const auto slot = fieldHash(FieldNames[i], table.sizes[i]);
+
+    if (table.ids[slot] != FieldId::Unknown)
+      table.perfect = false;
+
+    table.ids[slot] = static_cast<FieldId>(i);
+  }
+
+  return table;
+}
+
+constexpr FieldTable Fields = makeFieldTable();
+
+static_assert(Fields.perfect, "The field hash has collisions, adjust fieldHash() for the new names.");
+
+}
+
+FieldId fieldId(const char* name, std::size_t size) {
+  if (size == 0)
+    return FieldId::Unknown;
+
+  const auto id = Fields.ids[fieldHash(name, size)];
+  const auto i = static_cast<std::size_t>(id);
+
+  if (id != FieldId::Unknown && Fields.sizes[i] == size && scan::equalsLower(name, FieldNames[i], size))
+    return id;
+
+  return FieldId::Unknown;
+}
+
+const char* fieldName(FieldId id) {
+  return FieldNames[static_cast<std::size_t>(id)];
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ashttp {
+
+/**
+ * @brief FieldId Well-known response header fields.
+ *
+ * The parser tags each field with its id using a perfect hash that is generated at compile time, so the
+ *library's own decisions (framing, caching, etc.) do not need string lookups.
+ */
+enum class FieldId : std::uint8_t {
+  Unknown,
+  Age,
+  AcceptRanges,
+  AltSvc,
+  CacheControl,
+  Connection,
+  ContentDisposition,
+  ContentEncoding,
+  ContentLength,
+  ContentLocation,
+  ContentRange,
+  ContentType,
+  Date,
+  ETag,
+  Expires,
+  KeepAlive,
+  LastModified,
+  Location,
+  Pragma,
+  ProxyAuthenticate,
+  RetryAfter,
+  Server,
+  SetCookie,
+  StrictTransportSecurity,
+  Trailer,
+  TransferEncoding,
+  Upgrade,
+  Vary,
+  Via,
+  WWWAuthenticate,
+
+  Count
+};
+
+static constexpr std::size_t FieldIdCount = static_cast<std::size_t>(FieldId::Count);
+
+/**
+ * @brief fieldId Identifies a header field name.
+ * @param name The field name, in any case.
+ * @param size
+ * @return The id of the field, FieldId::Unknown if it is not a well-known field.
+ */
+FieldId fieldId(const char* name, std::size_t size);
+
+/**
+ * @brief fieldName
+ * @return The all-lowercase name of a well-known field.
+ */
+const char* fieldName(FieldId id);
+
+}
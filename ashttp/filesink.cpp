@@ -0,0 +1,229 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filesink.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ashttp {
+
+namespace {
+
+ErrorCode lastError() {
+  return ErrorCode{errno, boost::system::system_category()};
+}
+
+}
+
+std::shared_ptr<FileSink> FileSink::open(const std::string& path, ErrorCode& ec, std::uint64_t offset, Options options) {
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+
+  if (options.truncate)
+    flags |= O_TRUNC;
+
+#ifdef O_DIRECT
+  // direct writes need the offset and the write size aligned
+  options.direct = options.direct && offset % Alignment == 0 && options.bufferSize % Alignment == 0;
+
+  if (options.direct)
+    flags |= O_DIRECT;
+#else
+  options.direct = false;
+#endif
+
+  const auto fd = ::open(path.c_str(), flags, 0644);
+
+  if (fd < 0) {
+    ec = lastError();
+
+    return nullptr;
+  }
+
+  ec = error::success;
+
+  return std::shared_ptr<FileSink>(new FileSink{fd, offset, options});
+}
+
+FileSink::FileSink(int fd, std::uint64_t offset, Options options)
+    : m_fd{fd}
+    , m_pipe{-1, -1}
+    , m_options{options}
+    , m_direct{options.direct}
+    , m_offset{offset}
+    , m_written{0}
+    , m_filled{0}
+    , m_buffer{nullptr, &std::free} {
+  void* buffer = nullptr;
+
+  if (::posix_memalign(&buffer, Alignment, m_options.bufferSize) != 0)
+    throw std::bad_alloc{};
+
+  m_buffer.reset(static_cast<char*>(buffer));
+}
+
+FileSink::~FileSink() {
+  if (m_pipe[0] >= 0) {
+    ::close(m_pipe[0]);
+    ::close(m_pipe[1]);
+  }
+
+  ::close(m_fd);
+}
+
+bool FileSink::canSplice() const {
+#ifdef __linux__
+  // spliced writes are neither aligned nor buffered
+  return m_options.splice && !m_direct;
+#else
+  return false;
+#endif
+}
+
+ErrorCode FileSink::preallocate(std::uint64_t length) {
+  if (!m_options.preallocate || length == 0)
+    return error::success;
+
+#ifdef __linux__
+  // the apparent size is not changed so a failed download does not look complete
+  if (::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, m_offset, length) != 0 && errno != EOPNOTSUPP && errno != ENOSYS)
+    return lastError();
+#endif
+
+  return error::success;
+}
+
+asio::mutable_buffer FileSink::buffer() {
+  return asio::buffer(m_buffer.get() + m_filled, m_options.bufferSize - m_filled);
+}
+
+ErrorCode FileSink::commit(std::size_t size) {
+  assert(m_filled + size <= m_options.bufferSize);
+
+  m_filled += size;
+
+  if (m_filled == m_options.bufferSize)
+    return flush();
+
+  return error::success;
+}
+
+ErrorCode FileSink::flush() {
+  if (m_filled == 0)
+    return error::success;
+
+#ifdef O_DIRECT
+  if (m_direct && m_filled % Alignment != 0) { // the unaligned tail of the body is written without O_DIRECT
+    if (::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) & ~O_DIRECT) != 0)
+      return lastError();
+
+    m_direct = false;
+  }
+#endif
+
+  const auto ec = write(m_buffer.get(), m_filled);
+
+  if (!ec) {
+    m_written += m_filled;
+    m_filled = 0;
+  }
+
+  return ec;
+}
+
+ErrorCode FileSink::write(const char* data, std::size_t size) {
+  while (size > 0) {
+    const auto written = ::pwrite(m_fd, data, size, m_offset);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      return lastError();
+    }
+
+    data += written;
+    size -= written;
+    m_offset += written;
+  }
+
+  return error::success;
+}
+
+std::size_t FileSink::splice(int socketFd, std::uint64_t maxSize, ErrorCode& ec) {
+#ifdef __linux__
+  assert(m_filled == 0);
+
+  if (m_pipe[0] < 0 && ::pipe2(m_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    ec = lastError();
+
+    return 0;
+  }
+
+  const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(maxSize, m_options.bufferSize));
+  const auto received = ::splice(socketFd, nullptr, m_pipe[1], nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+  if (received < 0) {
+    ec = errno == EAGAIN ? ErrorCode{asio::error::would_block} : lastError();
+
+    return 0;
+  }
+
+  // the pipe is drained completely, so it is empty before every read from the socket
+  for (auto left = received; left > 0;) {
+    auto offset = static_cast<loff_t>(m_offset);
+
+    const auto written = ::splice(m_pipe[0], nullptr, m_fd, &offset, left, SPLICE_F_MOVE);
+
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+
+      ec = lastError();
+
+      return 0;
+    }
+
+    left -= written;
+    m_offset += written;
+  }
+
+  m_written += received;
+  ec = error::success;
+
+  return received;
+#else
+  ec = asio::error::operation_not_supported;
+
+  return 0;
+#endif
+}
+
+}
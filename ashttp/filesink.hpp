@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "type.hpp"
+
+#include <boost/asio/buffer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ashttp {
+
+/**
+ * @brief FileSink Writes a response body to a file.
+ *
+ * The body is read into an aligned buffer and written with large pwrite()s at increasing offsets, so
+ *several sinks can write different parts of the same file. On Linux, plaintext bodies that are not chunked
+ *are spliced from the socket to the file through a pipe and never enter user space.
+ *
+ * The writes are done on the thread running the io_service.
+ */
+class FileSink {
+public:
+  struct Options {
+    Options() { }
+
+    std::size_t bufferSize = 1024 * 1024; // the size of the writes
+    bool direct = false;                  // open with O_DIRECT; the offset and bufferSize must be block aligned
+    bool preallocate = true;              // reserve the space of bodies with a known length
+    bool splice = true;                   // use splice(2) when possible
+    bool truncate = true;                 // truncate the file on open
+  };
+
+  static const constexpr std::size_t Alignment{4096};
+
+public:
+  /**
+   * @brief open Opens (creating if needed) the file at \p path to write a body into.
+   * @param path
+   * @param ec Set on failure.
+   * @param offset The offset in the file to write the body at.
+   * @param options
+   * @return The sink, nullptr on failure.
+   */
+  static std::shared_ptr<FileSink> open(const std::string& path, ErrorCode& ec, std::uint64_t offset = 0,
+                                        Options options = Options{});
+
+  ~FileSink();
+
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+
+  /**
+   * @brief size
+   * @return The number of body bytes given to the sink so far.
+   */
+  std::uint64_t size() const { return m_written + m_filled; }
+
+  const Options& options() const { return m_options; }
+
+  /**
+   * @brief canSplice
+   * @return true if the body may be spliced from a socket.
+   */
+  bool canSplice() const;
+
+  /**
+   * @brief preallocate Reserves space for \p length more bytes of body.
+   *
+   * Not supported by every file system, which is not an error.
+   */
+  ErrorCode preallocate(std::uint64_t length);
+
+  /**
+   * @brief buffer
+   * @return The free part of the buffer to receive the body into.
+   */
+  asio::mutable_buffer buffer();
+
+  /**
+   * @brief commit Takes \p size bytes received at the front of buffer(); writes the buffer out once it is full.
+   */
+  ErrorCode commit(std::size_t size);
+
+  /**
+   * @brief flush Writes out what is in the buffer.
+   */
+  ErrorCode flush();
+
+  /**
+   * @brief splice Moves up to \p maxSize bytes from the socket \p socketFd to the file.
+   * @param ec Set to boost::asio::error::would_block if the socket has no data.
+   * @return The number of bytes moved, 0 at the end of the stream.
+   *
+   * The buffer must be flushed before.
+   */
+  std::size_t splice(int socketFd, std::uint64_t maxSize, ErrorCode& ec);
+
+private:
+  FileSink(int fd, std::uint64_t offset, Options options);
+
+  ErrorCode write(const char* data, std::size_t size);
+
+private:
+  int m_fd;
+  int m_pipe[2];
+  Options m_options;
+  bool m_direct;
+
+  std::uint64_t m_offset;  // where the next write goes
+  std::uint64_t m_written; // body bytes written to the file
+  std::size_t m_filled;    // body bytes in the buffer
+
+  std::unique_ptr<char, void (*)(void*)> m_buffer;
+};
+
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ashttp {
+
+template <class Signature, std::size_t Capacity = 64>
+class InplaceFunction;
+
+/**
+ * @brief InplaceFunction A move-only, type-erased callable that stores its target inside the object.
+ *
+ * Unlike std::function there is no heap fallback; assigning a callable that does not fit into \p Capacity
+ *bytes is a compile-time error. Move-only targets (e.g. asio completion handlers) are supported.
+ */
+template <class R, class... Args, std::size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+  struct VTable {
+    R (*invoke)(void* storage, Args&&... args);
+    void (*move)(void* to, void* from);
+    void (*destroy)(void* storage);
+  };
+
+  template <class F>
+  struct VTableFor {
+    static R invoke(void* storage, Args&&... args) { return (*static_cast<F*>(storage))(std::forward<Args>(args)...); }
+    static void move(void* to, void* from) { new (to) F{std::move(*static_cast<F*>(from))}; }
+    static void destroy(void* storage) { static_cast<F*>(storage)->~F(); }
+
+    static constexpr VTable value{&invoke, &move, &destroy};
+  };
+
+public:
+  static constexpr std::size_t capacity = Capacity;
+
+public:
+  InplaceFunction() noexcept
+      : m_vtable{nullptr} { }
+
+  InplaceFunction(std::nullptr_t) noexcept
+      : m_vtable{nullptr} { }
+
+  template <class F, class D = typename std::decay<F>::type,
+            class = typename std::enable_if<!std::is_base_of<InplaceFunction, D>::value>::type>
+  InplaceFunction(F&& f)
+      : m_vtable{&VTableFor<D>::value} {
+    static_assert(sizeof(D) <= Capacity, "Callable is too big for InplaceFunction, capture less or by reference.");
+    static_assert(alignof(D) <= alignof(std::max_align_t), "Callable is over-aligned for InplaceFunction.");
+
+    new (&m_storage) D{std::forward<F>(f)};
+  }
+
+  InplaceFunction(InplaceFunction&& other) noexcept
+      : m_vtable{other.m_vtable} {
+    if (m_vtable) {
+      m_vtable->move(&m_storage, &other.m_storage);
+      other.reset();
+    }
+  }
+
+  InplaceFunction(const InplaceFunction&) = delete;
+  InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+  ~InplaceFunction() { reset(); }
+
+  /**
+   * @brief operator= Replaces the target.
+   *
+   * The old target is destroyed after the new one is in place, like std::function does. This allows the
+   *old target to own the object that holds this function.
+   */
+  InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+    if (this != &other) {
+      InplaceFunction old{std::move(*this)};
+
+      if ((m_vtable = other.m_vtable)) {
+        m_vtable->move(&m_storage, &other.m_storage);
+        other.reset();
+      }
+    }
+
+    return *this;
+  }
+
+  InplaceFunction& operator=(std::nullptr_t) noexcept {
+    InplaceFunction old{std::move(*this)};
+
+    return *this;
+  }
+
+  template <class F, class D = typename std::decay<F>::type,
+            class = typename std::enable_if<!std::is_base_of<InplaceFunction, D>::value>::type>
+  InplaceFunction& operator=(F&& f) {
+    return *this = InplaceFunction{std::forward<F>(f)};
+  }
+
+  R operator()(Args... args) const {
+    return m_vtable->invoke(const_cast<void*>(static_cast<const void*>(&m_storage)), std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return m_vtable != nullptr; }
+
+private:
+  void reset() noexcept {
+    if (m_vtable) {
+      m_vtable->destroy(&m_storage);
+      m_vtable = nullptr;
+    }
+  }
+
+private:
+  const VTable* m_vtable;
+  typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type m_storage;
+};
+
+template <class R, class... Args, std::size_t Capacity>
+template <class F>
+constexpr typename InplaceFunction<R(Args...), Capacity>::VTable InplaceFunction<R(Args...), Capacity>::VTableFor<F>::value;
+
+template <class Function, std::size_t Capacity = 64>
+class InplaceCallback;
+
+/**
+ * @brief InplaceCallback Takes a callback of the std::function type \p Function and stores it in place.
+ *
+ * A callable that fits into \p Capacity bytes is stored as it is, a bigger one is converted once into a
+ *std::function. An empty std::function gives an empty callback.
+ */
+template <class R, class... Args, std::size_t Capacity>
+class InplaceCallback<std::function<R(Args...)>, Capacity> : public InplaceFunction<R(Args...), Capacity> {
+  using Base = InplaceFunction<R(Args...), Capacity>;
+  using Function = std::function<R(Args...)>;
+
+  template <class F>
+  using Fits = std::integral_constant<bool, sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t)>;
+
+  template <class F, bool fits>
+  using EnableIf = typename std::enable_if<!std::is_same<F, InplaceCallback>::value && !std::is_same<F, Function>::value &&
+                                               Fits<F>::value == fits,
+                                           int>::type;
+
+public:
+  InplaceCallback() noexcept = default;
+
+  InplaceCallback(std::nullptr_t) noexcept { }
+
+  InplaceCallback(Function f)
+      : Base{f ? Base{std::move(f)} : Base{}} { }
+
+  template <class F, class D = typename std::decay<F>::type, EnableIf<D, true> = 0>
+  InplaceCallback(F&& f)
+      : Base{std::forward<F>(f)} { }
+
+  template <class F, class D = typename std::decay<F>::type, EnableIf<D, false> = 0>
+  InplaceCallback(F&& f)
+      : Base{Function{std::forward<F>(f)}} { }
+};
+
+}
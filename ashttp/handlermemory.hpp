@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ashttp {
+
+/**
+ * @brief HandlerMemory A small slab of recycled blocks for asio operation state.
+ *
+ * Every asynchronous operation of a connection (and of the requests running on it) allocates its state from
+ *here, so a steady-state request does no heap allocations for operation state. Allocations that are too big,
+ *or that happen while all the blocks are in use, fall back to the global operator new.
+ */
+class HandlerMemory {
+public:
+  static constexpr std::size_t BlockSize = 512;
+  static constexpr std::size_t BlockCount = 4;
+
+public:
+  HandlerMemory() {
+    for (auto& inUse : m_inUse)
+      inUse.clear();
+  }
+
+  HandlerMemory(const HandlerMemory&) = delete;
+  HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+  void* allocate(std::size_t size) {
+    if (size <= BlockSize) {
+      for (std::size_t i = 0; i < BlockCount; ++i) {
+        if (!m_inUse[i].test_and_set(std::memory_order_acquire))
+          return &m_blocks[i];
+      }
+    }
+
+    return ::operator new(size);
+  }
+
+  void deallocate(void* pointer) {
+    for (std::size_t i = 0; i < BlockCount; ++i) {
+      if (pointer == &m_blocks[i]) {
+        m_inUse[i].clear(std::memory_order_release);
+
+        return;
+      }
+    }
+
+    ::operator delete(pointer);
+  }
+
+private:
+  typename std::aligned_storage<BlockSize, alignof(std::max_align_t)>::type m_blocks[BlockCount];
+  std::atomic_flag m_inUse[BlockCount];
+};
+
+/**
+ * @brief HandlerAllocator The associated allocator of the handlers wrapped with makeAllocHandler().
+ *
+ * Holds a reference to the memory so that an operation that is destroyed after the owner of the memory
+ *can still give its block back.
+ */
+template <class T>
+class HandlerAllocator {
+  template <class U>
+  friend class HandlerAllocator;
+
+public:
+  using value_type = T;
+
+public:
+  explicit HandlerAllocator(std::shared_ptr<HandlerMemory> memory)
+      : m_memory{std::move(memory)} { }
+
+  template <class U>
+  HandlerAllocator(const HandlerAllocator<U>& other) noexcept
+      : m_memory{other.m_memory} { }
+
+  T* allocate(std::size_t n) const { return static_cast<T*>(m_memory->allocate(sizeof(T) * n)); }
+
+  void deallocate(T* pointer, std::size_t) const { m_memory->deallocate(pointer); }
+
+  bool operator==(const HandlerAllocator& other) const noexcept { return m_memory == other.m_memory; }
+  bool operator!=(const HandlerAllocator& other) const noexcept { return m_memory != other.m_memory; }
+
+private:
+  std::shared_ptr<HandlerMemory> m_memory;
+};
+
+/**
+ * @brief AllocHandler Wraps a completion handler to allocate its operation state from a HandlerMemory.
+ */
+template <class Handler>
+class AllocHandler {
+public:
+  using allocator_type = HandlerAllocator<Handler>;
+
+public:
+  AllocHandler(std::shared_ptr<HandlerMemory> memory, Handler handler)
+      : m_memory{std::move(memory)}
+      , m_handler{std::move(handler)} { }
+
+  allocator_type get_allocator() const noexcept { return allocator_type{m_memory}; }
+
+  template <class... Args>
+  void operator()(Args&&... args) {
+    m_handler(std::forward<Args>(args)...);
+  }
+
+private:
+  std::shared_ptr<HandlerMemory> m_memory;
+  Handler m_handler;
+};
+
+template <class Handler>
+AllocHandler<typename std::decay<Handler>::type> makeAllocHandler(const std::shared_ptr<HandlerMemory>& memory,
+                                                                  Handler&& handler) {
+  return AllocHandler<typename std::decay<Handler>::type>{memory, std::forward<Handler>(handler)};
+}
+
+}
@@ -23,99 +23,178 @@
 
 #include "header.hpp"
 
+#include "scan.hpp"
+
 #include <algorithm>
-#include <iterator>
-#include <functional>
+#include <cctype>
 
 namespace ashttp {
 
-using namespace std::placeholders;
-
 Header::Header() {
+  reset();
 }
 
 Header::~Header() {}
 
 void Header::field(const std::string& key, const std::string& value) {
-  m_data.append(key);
-  m_data.push_back(':');
-  m_data.push_back(' ');
-  m_data.append(value);
-  m_data.push_back('\r');
-  m_data.push_back('\n');
-}
+  // insert the line at the end of the fields, before the terminating empty line (if any)
+  std::string line;
+  line.reserve(key.size() + value.size() + 4);
+  line.append(key).append(": ").append(value).append("\r\n");
 
-boost::optional<const Header::StringRange&> Header::field(const std::string& key) const {
-  const auto lowerBound = m_headerCache.lower_bound(key);
+  m_data.resize(m_size);
+  m_data.insert(m_fieldsEnd, line);
+  m_size = m_data.size();
 
-  if (lowerBound != m_headerCache.end() && lowerBound->first == key) { // key is already cached
-    return boost::optional<const StringRange&>{lowerBound->second};
-  } else { // key is not cached
-    // key does not care about case
-    const auto keyPredicate = [](const char& lhs, const char& rhs) { return tolower(lhs) == rhs; };
+  const auto nameBegin = m_fieldsEnd;
+  const auto valueBegin = nameBegin + key.size() + 2;
 
-    auto field = std::search(m_data.begin(), m_data.end(), key.begin(), key.end(), keyPredicate);
+  addField(nameBegin, nameBegin + key.size(), valueBegin, valueBegin + value.size());
 
-    if (field != m_data.end()) {
-      field += key.size();
+  m_fieldsEnd += line.size();
+}
 
-      auto valBegin = std::find(field, m_data.end(), ':');
+boost::string_view Header::field() const {
+  return view(m_fieldsBegin, m_fieldsEnd);
+}
 
-      if (valBegin == m_data.end())
-        throw std::runtime_error{"Malformed header."};
+boost::optional<boost::string_view> Header::field(boost::string_view key) const {
+  const auto hash = hashName(key.data(), key.size());
 
-      // skip the colon
-      ++valBegin;
+  // key does not care about case
+  const auto matches = [&](const FieldOffsets& field) {
+    return field.hash == hash && field.nameEnd - field.nameBegin == key.size() &&
+           scan::equalsLower(m_data.data() + field.nameBegin, key.data(), key.size());
+  };
 
-      if (valBegin == m_data.end())
-        throw std::runtime_error{"Malformed header."};
+  for (auto slot = hash & (IndexSize - 1); m_index[slot] != 0; slot = (slot + 1) & (IndexSize - 1)) {
+    const auto& field = m_fields[m_index[slot] - 1];
 
-      // skip the spaces
-      while (*valBegin == ' ') {
-        ++valBegin;
+    if (matches(field))
+      return view(field.valueBegin, field.valueEnd);
+  }
 
-        if (valBegin == m_data.end())
-          throw std::runtime_error{"Malformed header."};
-      }
+  // the fields that did not fit into the index
+  for (auto i = MaxIndexedFields; i < m_fields.size(); ++i) {
+    if (matches(m_fields[i]))
+      return view(m_fields[i].valueBegin, m_fields[i].valueEnd);
+  }
 
-      const auto valEnd = std::find(valBegin, m_data.end(), '\r');
+  return boost::none;
+}
 
-      if (valEnd == m_data.end())
-        throw std::runtime_error{"Malformed header."};
+boost::optional<boost::string_view> Header::field(FieldId id) const {
+  if (const auto position = m_knownFields[static_cast<std::size_t>(id)]) {
+    const auto& field = m_fields[position - 1];
 
-      const auto newIt =
-          m_headerCache.emplace_hint(lowerBound, std::piecewise_construct, std::forward_as_tuple(key),
-                                     std::forward_as_tuple(StringRange{valBegin, valEnd}));
+    return view(field.valueBegin, field.valueEnd);
+  }
 
-      return boost::optional<const StringRange&>{newIt->second};
-    } else { // key does not exist, put a cache entry
-      const auto newIt = m_headerCache.emplace_hint(lowerBound, std::piecewise_construct,
-                                                    std::forward_as_tuple(key), std::forward_as_tuple());
+  return boost::none;
+}
 
-      return boost::optional<const StringRange&>{newIt->second};
-    }
-  }
+boost::optional<std::uint64_t> Header::contentLength() const {
+  if (m_hasContentLength)
+    return m_contentLength;
+
+  return boost::none;
+}
+
+std::pair<boost::string_view, boost::string_view> Header::fieldAt(std::size_t i) const {
+  const auto& field = m_fields[i];
+
+  return {view(field.nameBegin, field.nameEnd), view(field.valueBegin, field.valueEnd)};
 }
 
 void Header::reset() {
-  m_headerCache.clear();
   m_data.clear();
-  m_query.clear();
+  m_size = 0;
+
+  clearParsed();
 }
 
-void Header::load(std::istream& is, std::size_t length) {
-  // get the query string
-  std::getline(is, m_query, '\r');
-  is.ignore(1);// ignore \n
+void Header::clearParsed() {
+  m_statusLineEnd = 0;
+  m_status = 0;
+  m_fieldsBegin = 0;
+  m_fieldsEnd = 0;
+  m_fields.clear();
+  m_index.fill(0);
+  m_knownFields.fill(0);
+  m_hasContentLength = false;
+  m_contentLength = 0;
+}
+
+void Header::append(boost::string_view data) {
+  std::copy(data.begin(), data.end(), prepare(data.size()));
+  commit(data.size());
+}
 
-  const auto lengthLeft = length - m_query.length() - 2;
+char* Header::prepare(std::size_t size) {
+  m_data.resize(m_size + size);
+
+  return &m_data[m_size];
+}
+
+std::uint32_t Header::hashName(const char* name, std::size_t size) {
+  // FNV-1a over the lowercased name
+  std::uint32_t hash = 2166136261u;
+
+  for (std::size_t i = 0; i < size; ++i) {
+    const auto c = name[i];
+
+    hash ^= static_cast<unsigned char>((c >= 'A' && c <= 'Z') ? (c | 0x20) : c);
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+void Header::addField(std::size_t nameBegin, std::size_t nameEnd, std::size_t valueBegin, std::size_t valueEnd) {
+  const auto hash = hashName(m_data.data() + nameBegin, nameEnd - nameBegin);
+  const auto id = fieldId(m_data.data() + nameBegin, nameEnd - nameBegin);
+
+  m_fields.push_back(FieldOffsets{static_cast<std::uint32_t>(nameBegin), static_cast<std::uint32_t>(nameEnd),
+                                  static_cast<std::uint32_t>(valueBegin), static_cast<std::uint32_t>(valueEnd), hash,
+                                  id});
+
+  auto& known = m_knownFields[static_cast<std::size_t>(id)];
+
+  if (id != FieldId::Unknown && known == 0)
+    known = static_cast<std::uint16_t>(m_fields.size());
+
+  if (m_fields.size() > MaxIndexedFields)
+    return;
+
+  const auto nameLength = nameEnd - nameBegin;
+
+  auto slot = hash & (IndexSize - 1);
+
+  for (; m_index[slot] != 0; slot = (slot + 1) & (IndexSize - 1)) {
+    const auto& field = m_fields[m_index[slot] - 1];
+
+    // keep the first one of the repeated fields
+    if (field.hash == hash && field.nameEnd - field.nameBegin == nameLength &&
+        std::equal(m_data.begin() + nameBegin, m_data.begin() + nameEnd, m_data.begin() + field.nameBegin,
+                   [](char lhs, char rhs) { return std::tolower(lhs) == std::tolower(rhs); }))
+      return;
+  }
+
+  m_index[slot] = static_cast<std::uint16_t>(m_fields.size());
+}
+
+void Header::truncate(std::size_t size) {
+  m_size = std::min(m_size, size);
+  m_data.resize(m_size);
+}
 
-  m_data.reserve(lengthLeft);
+void Header::discard(std::size_t size) {
+  size = std::min(m_size, size);
 
-  std::copy_n(std::istreambuf_iterator<char>{is}, lengthLeft, std::back_inserter(m_data));
+  m_data.erase(0, size);
+  m_size -= size;
 
-  // also discard the last element since copy_n wont increase the iterator after reading the last one
-  is.ignore(1);
+  clearParsed();
 }
 
 }
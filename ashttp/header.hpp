@@ -23,20 +23,29 @@
 
 #pragma once
 
+#include "type.hpp"
+#include "fieldid.hpp"
+
 #include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
 
-#include <map>
+#include <array>
+#include <cstdint>
+#include <vector>
 
 namespace ashttp {
 
-template <class C>
+class ResponseParser;
+
+namespace client {
+template <Protocol p>
 class Request;
+}
 
 class Header {
-  template <class C>
-  friend class Request;
-
-  using StringRange = std::pair<std::string::const_iterator, std::string::const_iterator>;
+  friend class ResponseParser;
+  template <Protocol p>
+  friend class client::Request;
 
 public:
   Header();
@@ -55,40 +64,147 @@ public:
 
   /**
    * @brief field Gets the whole header section.
-   * @return The whole header section.
+   * @return The whole header section (all the field lines, without the status line).
    */
-  const std::string& field() const { return m_data; }
+  boost::string_view field() const;
 
   /**
    * @brief field Gets the value of a header field.
    * @param key Key of the header field to get the value of. Must be all-lowercase.
-   * @return An object containing two iterators to the beginning and ending of the header field. Empty if no
-   * header field exists with the given key.
+   * @return A view of the value of the header field. Empty if no header field exists with the given key.
    *
-   * Always use an all-lowercase key.
+   * Always use an all-lowercase key. If the field is repeated, the first one is returned.
    *
-   * Calls to this method caches to a std::map in the background for the further queries with the same key.
+   * The fields are indexed by a hash of their names while they are parsed, so this does not search the
+   *header and does not allocate.
+   */
+  boost::optional<boost::string_view> field(boost::string_view key) const;
+
+  /**
+   * @brief field Gets the value of a well-known header field.
+   * @param id Id of the field.
+   * @return A view of the value of the first field with the given id. Empty if there is none.
+   */
+  boost::optional<boost::string_view> field(FieldId id) const;
+
+  /**
+   * @brief contentLength
+   * @return The value of the content-length field. Empty if there is none.
+   */
+  boost::optional<std::uint64_t> contentLength() const;
+
+  /**
+   * @brief fieldCount
+   * @return Number of the header fields.
    */
-  boost::optional<const StringRange&> field(const std::string& key) const;
+  std::size_t fieldCount() const { return m_fields.size(); }
+
+  /**
+   * @brief fieldAt Gets a header field by its position.
+   * @param i Position of the field in the header.
+   * @return Name and value of the field. Both are views into the header.
+   */
+  std::pair<boost::string_view, boost::string_view> fieldAt(std::size_t i) const;
+
+  /**
+   * @brief statusLine
+   * @return The status line of the response, e.g. "HTTP/1.1 200 OK".
+   */
+  boost::string_view statusLine() const { return view(0, m_statusLineEnd); }
+
+  /**
+   * @brief status
+   * @return The status code of the response.
+   */
+  unsigned status() const { return m_status; }
 
   /**
    * @brief reset Resets the header state.
    */
   void reset();
 
-public://private:
   /**
-   * @brief load Loads the header data from the given istream \p is with the \p length limit.
-   * @param is The stream to read from.
-   * @param length Length of the header.
+   * @brief append Adds \p data to the received bytes, to be parsed by a ResponseParser.
+   */
+  void append(boost::string_view data);
+
+private:
+  struct FieldOffsets {
+    std::uint32_t nameBegin;
+    std::uint32_t nameEnd;
+    std::uint32_t valueBegin;
+    std::uint32_t valueEnd;
+    std::uint32_t hash;
+    FieldId id;
+  };
+
+  // open addressing table of (field position + 1); fields beyond the load limit are only found by a scan
+  static constexpr std::size_t IndexSize = 128;
+  static constexpr std::size_t MaxIndexedFields = IndexSize / 2;
+
+  /**
+   * @brief hashName Case-insensitive hash of a field name.
+   */
+  static std::uint32_t hashName(const char* name, std::size_t size);
+
+  /**
+   * @brief addField Appends a field and indexes it by its name.
+   */
+  void addField(std::size_t nameBegin, std::size_t nameEnd, std::size_t valueBegin, std::size_t valueEnd);
+
+  boost::string_view view(std::size_t begin, std::size_t end) const {
+    return boost::string_view{m_data.data() + begin, end - begin};
+  }
+
+  // storage management used by the receiver; the response is read directly into the header storage
+
+  /**
+   * @brief prepare Makes room for \p size more bytes at the end of the received data.
+   * @return Pointer to the beginning of the room.
+   */
+  char* prepare(std::size_t size);
+
+  /**
+   * @brief commit Marks \p size bytes of the prepared room as received.
+   */
+  void commit(std::size_t size) { m_size += size; }
+
+  /**
+   * @brief size
+   * @return Number of received bytes.
    */
-  void load(std::istream& is, std::size_t length);
+  std::size_t size() const { return m_size; }
+
+  /**
+   * @brief truncate Drops the received bytes beyond \p size, e.g. the beginning of the body.
+   */
+  void truncate(std::size_t size);
+
+  /**
+   * @brief discard Drops the first \p size received bytes, e.g. an interim response, and what is parsed of them.
+   */
+  void discard(std::size_t size);
+
+  /**
+   * @brief clearParsed Forgets the status line and the fields.
+   */
+  void clearParsed();
 
 private:
-  std::string m_query;
-  std::string m_data;
+  std::string m_data; // the header as received, from the status line to the empty line
+  std::size_t m_size;
+
+  std::size_t m_statusLineEnd;
+  unsigned m_status;
+
+  std::size_t m_fieldsBegin;
+  std::size_t m_fieldsEnd;
+  std::vector<FieldOffsets> m_fields;
+  std::array<std::uint16_t, IndexSize> m_index;
+  std::array<std::uint16_t, FieldIdCount> m_knownFields; // position + 1 of the first field with an id
 
-  mutable std::map<std::string, boost::optional<StringRange>> m_headerCache;
+  bool m_hasContentLength;
+  std::uint64_t m_contentLength;
 };
 
 }
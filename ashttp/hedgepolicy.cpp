@@ -0,0 +1,114 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "hedgepolicy.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace ashttp {
+
+HedgePolicy::HedgePolicy(Options options)
+    : m_options{std::move(options)}
+    , m_nextLatency{0}
+    , m_delay{m_options.delay}
+    , m_delayValid{false}
+    , m_budget{std::min(1.0, m_options.burst)}
+    , m_requests{0}
+    , m_hedges{0}
+    , m_wins{0}
+    , m_throttled{0} {
+  assert(m_options.window > 0 && m_options.percentile >= 0 && m_options.percentile < 1);
+
+  m_latencies.reserve(m_options.window);
+}
+
+HedgePolicy::Clock::duration HedgePolicy::delay() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return delay_();
+}
+
+void HedgePolicy::requested() {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  ++m_requests;
+  m_budget = std::min(m_budget + m_options.maxExtra, m_options.burst);
+}
+
+bool HedgePolicy::tryHedge() {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (m_budget < 1) {
+    ++m_throttled;
+
+    return false;
+  }
+
+  m_budget -= 1;
+  ++m_hedges;
+
+  return true;
+}
+
+void HedgePolicy::answered(Clock::duration latency, bool byHedge) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (byHedge)
+    ++m_wins;
+
+  if (m_latencies.size() < m_options.window)
+    m_latencies.push_back(latency);
+  else
+    m_latencies[m_nextLatency] = latency;
+
+  m_nextLatency = (m_nextLatency + 1) % m_options.window;
+  m_delayValid = false;
+}
+
+HedgePolicy::Stats HedgePolicy::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return Stats{m_requests, m_hedges, m_wins, m_throttled, std::chrono::duration_cast<std::chrono::microseconds>(delay_())};
+}
+
+HedgePolicy::Clock::duration HedgePolicy::delay_() const {
+  if (m_options.percentile == 0 || m_latencies.size() < m_options.minSamples)
+    return m_options.delay;
+
+  if (!m_delayValid) {
+    auto latencies = m_latencies;
+    const auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(std::floor(m_options.percentile * (latencies.size() - 1)));
+
+    std::nth_element(latencies.begin(), nth, latencies.end());
+
+    m_delay = std::max(*nth, m_options.minDelay);
+    m_delayValid = true;
+  }
+
+  return m_delay;
+}
+
+}
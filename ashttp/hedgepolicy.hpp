@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ashttp {
+
+/**
+ * @brief HedgePolicy Decides when a request that has no response header yet is sent once more.
+ *
+ * The delay is a percentile of the header latencies of the recent requests, or a fixed one until there are
+ *enough of them. The extra load is capped by a budget: every request earns maxExtra of a hedge, and a hedge
+ *is only sent if a whole one is saved up.
+ *
+ * Thread-safe; one policy may be shared by several clients.
+ */
+class HedgePolicy {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    Options() { }
+
+    Clock::duration delay = std::chrono::milliseconds{50}; // before there are minSamples latencies
+    double percentile = 0.95;                              // of the latencies to hedge at, 0 to always use delay
+    Clock::duration minDelay = std::chrono::milliseconds{1};
+    std::size_t minSamples = 20;
+    std::size_t window = 1000; // latencies kept
+    double maxExtra = 0.05;    // hedges per request
+    double burst = 10;         // hedges that can be saved up
+  };
+
+  struct Stats {
+    std::uint64_t requests;
+    std::uint64_t hedges;
+    std::uint64_t wins;      // hedges answered first
+    std::uint64_t throttled; // hedges not sent for the budget
+    std::chrono::microseconds delay;
+  };
+
+public:
+  explicit HedgePolicy(Options options = Options{});
+
+  HedgePolicy(const HedgePolicy&) = delete;
+  HedgePolicy& operator=(const HedgePolicy&) = delete;
+
+  /**
+   * @brief delay
+   * @return How long to wait for the header before hedging.
+   */
+  Clock::duration delay() const;
+
+  /**
+   * @brief requested Counts a request that may be hedged, adding to the budget.
+   */
+  void requested();
+
+  /**
+   * @brief tryHedge Takes a hedge from the budget.
+   * @return false if the budget is spent.
+   */
+  bool tryHedge();
+
+  /**
+   * @brief answered Records the header latency of a request.
+   * @param latency
+   * @param byHedge The header came from the hedge.
+   */
+  void answered(Clock::duration latency, bool byHedge);
+
+  const Options& options() const { return m_options; }
+
+  Stats stats() const;
+
+private:
+  Clock::duration delay_() const;
+
+private:
+  const Options m_options;
+
+  mutable std::mutex m_mutex;
+  std::vector<Clock::duration> m_latencies; // a ring of the last window ones
+  std::size_t m_nextLatency;
+  mutable Clock::duration m_delay; // of the latencies, computed again after they change
+  mutable bool m_delayValid;
+  double m_budget;
+
+  std::uint64_t m_requests;
+  std::uint64_t m_hedges;
+  std::uint64_t m_wins;
+  std::uint64_t m_throttled;
+};
+
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "memorybudget.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ashttp {
+
+MemoryBudget::MemoryBudget(std::size_t limit, std::shared_ptr<MemoryBudget> parent)
+    : m_parent{std::move(parent)}
+    , m_limit{limit}
+    , m_used{0}
+    , m_peak{0}
+    , m_reservations{0}
+    , m_pressure{0} { }
+
+const std::shared_ptr<MemoryBudget>& MemoryBudget::global() {
+  static const std::shared_ptr<MemoryBudget> budget{std::make_shared<MemoryBudget>(std::size_t{Unlimited}, nullptr)};
+
+  return budget;
+}
+
+void MemoryBudget::limit(std::size_t limit) {
+  std::vector<Waiter> waiters;
+
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    if (limit > m_limit) // waiters may fit now
+      waiters.swap(m_waiters);
+
+    m_limit = limit;
+  }
+
+  for (auto& waiter : waiters)
+    waiter();
+}
+
+std::size_t MemoryBudget::limit() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return m_limit;
+}
+
+bool MemoryBudget::fits(std::size_t size) const {
+  for (auto budget = this; budget; budget = budget->m_parent.get()) {
+    if (size > budget->limit())
+      return false;
+  }
+
+  return true;
+}
+
+bool MemoryBudget::tryReserve(std::size_t size, Waiter waiter) {
+  for (auto budget = this; budget; budget = budget->m_parent.get()) {
+    if (!budget->reserve(size)) {
+      // roll back what is reserved in the children
+      for (auto child = this; child != budget; child = child->m_parent.get())
+        child->unreserve(size);
+
+      {
+        std::lock_guard<std::mutex> l{budget->m_mutex};
+
+        ++budget->m_pressure;
+
+        // the memory may have been released since reserve() failed, nobody would wake the waiter up then
+        if (size > budget->m_limit - std::min(budget->m_used, budget->m_limit)) {
+          budget->m_waiters.push_back(std::move(waiter));
+
+          return false;
+        }
+      }
+
+      waiter();
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void MemoryBudget::release(std::size_t size) {
+  for (auto budget = this; budget; budget = budget->m_parent.get())
+    budget->unreserve(size);
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return Stats{m_limit, m_used, m_peak, m_reservations, m_pressure, m_waiters.size()};
+}
+
+bool MemoryBudget::reserve(std::size_t size) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (size > m_limit - std::min(m_used, m_limit))
+    return false;
+
+  m_used += size;
+  m_peak = std::max(m_peak, m_used);
+  ++m_reservations;
+
+  return true;
+}
+
+void MemoryBudget::unreserve(std::size_t size) {
+  std::vector<Waiter> waiters;
+
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    assert(size <= m_used);
+
+    m_used -= size;
+
+    if (size > 0)
+      waiters.swap(m_waiters);
+  }
+
+  // every waiter tries again; the ones that still do not fit wait again
+  for (auto& waiter : waiters)
+    waiter();
+}
+
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "function.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ashttp {
+
+/**
+ * @brief MemoryBudget Accounts the memory held in receive buffers.
+ *
+ * Budgets form a chain; every client has its own budget (see ClientCRTPBase<p>::memoryBudget()) whose
+ *parent is the process wide global() budget, and a reservation must fit into every budget of the chain.
+ *A request that cannot reserve what it needs does not fail but stops reading until memory is released.
+ *
+ * Thread-safe.
+ */
+class MemoryBudget {
+public:
+  using Waiter = InplaceFunction<void()>;
+
+  struct Stats {
+    std::size_t limit;
+    std::size_t used;
+    std::size_t peak;
+    std::uint64_t reservations; // successful reservations
+    std::uint64_t pressure;     // reservations that had to wait for memory
+    std::size_t waiting;        // waiters at the moment
+  };
+
+  static const constexpr std::size_t Unlimited{std::numeric_limits<std::size_t>::max()};
+
+public:
+  explicit MemoryBudget(std::size_t limit = Unlimited, std::shared_ptr<MemoryBudget> parent = global());
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  /**
+   * @brief global
+   * @return The budget shared by all clients of the process. Unlimited unless limit() is set.
+   */
+  static const std::shared_ptr<MemoryBudget>& global();
+
+  /**
+   * @brief limit Sets a new limit. Lowering it below used() makes the following reservations wait.
+   */
+  void limit(std::size_t limit);
+
+  std::size_t limit() const;
+
+  /**
+   * @brief fits
+   * @return true if \p size can ever be reserved, i.e. it is not above the limit of any budget of the chain.
+   */
+  bool fits(std::size_t size) const;
+
+  /**
+   * @brief tryReserve Reserves \p size bytes in this budget and its parents.
+   * @param size
+   * @param waiter Registered to the budget that is full if the reservation fails. It is called once, on any
+   *thread, after some memory is released there.
+   * @return true on success.
+   */
+  bool tryReserve(std::size_t size, Waiter waiter);
+
+  /**
+   * @brief release Gives back \p size reserved bytes to this budget and its parents.
+   */
+  void release(std::size_t size);
+
+  Stats stats() const;
+
+private:
+  /**
+   * @brief reserve Reserves in this budget only.
+   */
+  bool reserve(std::size_t size);
+
+  /**
+   * @brief unreserve Releases in this budget only, waking up its waiters.
+   */
+  void unreserve(std::size_t size);
+
+private:
+  const std::shared_ptr<MemoryBudget> m_parent;
+
+  mutable std::mutex m_mutex;
+  std::size_t m_limit;
+  std::size_t m_used;
+  std::size_t m_peak;
+  std::uint64_t m_reservations;
+  std::uint64_t m_pressure;
+  std::vector<Waiter> m_waiters;
+};
+
+}
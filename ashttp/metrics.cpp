@@ -0,0 +1,375 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "metrics.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace ashttp {
+
+namespace {
+
+// writes \p us microseconds as seconds
+void writeSeconds(std::ostream& os, std::uint64_t us) {
+  os << us / 1000000 << '.' << std::setw(6) << std::setfill('0') << us % 1000000 << std::setfill(' ');
+}
+
+void writeEscaped(std::ostream& os, const std::string& value) {
+  for (const auto c : value) {
+    if (c == '\\' || c == '"')
+      os << '\\' << c;
+    else if (c == '\n')
+      os << "\\n";
+    else
+      os << c;
+  }
+}
+
+void writeHeader(std::ostream& os, const char* name, const char* type, const char* help) {
+  os << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+}
+
+}
+
+constexpr std::size_t Histogram::SubBuckets;
+constexpr std::size_t Histogram::Buckets;
+constexpr std::size_t Histogram::Shards;
+constexpr std::size_t Metrics::ResultCount;
+
+std::uint64_t Histogram::Snapshot::below(std::chrono::microseconds bound) const {
+  std::uint64_t n = 0;
+
+  // the buckets whose values are all at most bound
+  for (std::size_t i = 0; i < Buckets && upperBound(i) - 1 <= static_cast<std::uint64_t>(bound.count()); ++i)
+    n += counts[i];
+
+  return n;
+}
+
+std::chrono::microseconds Histogram::Snapshot::quantile(double q) const {
+  if (count == 0)
+    return std::chrono::microseconds::zero();
+
+  const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * count)));
+  std::uint64_t n = 0;
+
+  for (std::size_t i = 0; i < Buckets; ++i) {
+    n += counts[i];
+
+    if (n >= rank)
+      return std::chrono::microseconds{upperBound(i)};
+  }
+
+  return std::chrono::microseconds{upperBound(Buckets - 1)};
+}
+
+Histogram::Histogram() {
+  for (auto& shard : m_shards) {
+    for (auto& count : shard.counts)
+      count.store(0, std::memory_order_relaxed);
+
+    shard.sum.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::record(Clock::duration latency) {
+  const auto us = static_cast<std::uint64_t>(
+      std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+  auto& shard = m_shards[Histogram::shard()];
+
+  shard.counts[bucket(us)].fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(us, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot;
+
+  snapshot.counts.fill(0);
+  snapshot.count = 0;
+
+  std::uint64_t sum = 0;
+
+  for (const auto& shard : m_shards) {
+    for (std::size_t i = 0; i < Buckets; ++i) {
+      const auto n = shard.counts[i].load(std::memory_order_relaxed);
+
+      snapshot.counts[i] += n;
+      snapshot.count += n;
+    }
+
+    sum += shard.sum.load(std::memory_order_relaxed);
+  }
+
+  snapshot.sum = std::chrono::microseconds{sum};
+
+  return snapshot;
+}
+
+std::size_t Histogram::bucket(std::uint64_t us) {
+  if (us < SubBuckets)
+    return us;
+
+  std::size_t magnitude = 63 - __builtin_clzll(us); // us is in [2^magnitude, 2^(magnitude + 1))
+
+  if (magnitude >= Buckets / SubBuckets + 2) // too large
+    return Buckets - 1;
+
+  return (magnitude - 2) * SubBuckets + ((us >> (magnitude - 3)) & (SubBuckets - 1));
+}
+
+std::uint64_t Histogram::upperBound(std::size_t i) {
+  if (i < SubBuckets)
+    return i + 1;
+
+  return (SubBuckets + i % SubBuckets + 1) << (i / SubBuckets - 1);
+}
+
+std::size_t Histogram::shard() {
+  static std::atomic<std::size_t> next{0};
+  static thread_local const std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % Shards;
+
+  return shard;
+}
+
+std::uint64_t Metrics::Snapshot::pending() const {
+  std::uint64_t done = 0;
+
+  for (const auto n : completed)
+    done += n;
+
+  return started > done ? started - done : 0; // the counters are read one by one
+}
+
+Metrics::Host::Host(std::string name)
+    : m_name{std::move(name)} {
+  for (auto& shard : m_shards) {
+    for (auto& counter : shard.counters)
+      counter.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::uint64_t Metrics::Host::sum(Counter counter) const {
+  std::uint64_t n = 0;
+
+  for (const auto& shard : m_shards)
+    n += shard.counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+
+  return n;
+}
+
+Metrics::Snapshot Metrics::Host::snapshot() const {
+  Snapshot snapshot;
+
+  snapshot.host = m_name;
+
+  // the completions first so that pending() does not go below the requests in flight
+  for (std::size_t i = 0; i < ResultCount; ++i)
+    snapshot.completed[i] = sum(static_cast<Counter>(i));
+
+  snapshot.started = sum(Counter::Started);
+  snapshot.bytesSent = sum(Counter::BytesSent);
+  snapshot.bytesReceived = sum(Counter::BytesReceived);
+  snapshot.connectionsOpened = sum(Counter::ConnectionsOpened);
+  snapshot.connectionsReused = sum(Counter::ConnectionsReused);
+  snapshot.noopTimeouts = sum(Counter::NoopTimeouts);
+  snapshot.resolveTimeouts = sum(Counter::ResolveTimeouts);
+  snapshot.headerLatency = m_headerLatency.snapshot();
+  snapshot.bodyLatency = m_bodyLatency.snapshot();
+
+  return snapshot;
+}
+
+Metrics::Metrics(std::string labels)
+    : m_labels{std::move(labels)} { }
+
+const std::shared_ptr<Metrics>& Metrics::global() {
+  static const std::shared_ptr<Metrics> metrics{std::make_shared<Metrics>()};
+
+  return metrics;
+}
+
+Metrics::Result Metrics::classify(const ErrorCode& ec) {
+  if (!ec)
+    return Result::Success;
+
+  if (ec == error::timeout || ec == asio::error::timed_out)
+    return Result::Timeout;
+
+  if (ec == error::canceled || ec == asio::error::operation_aborted)
+    return Result::Canceled;
+
+  if (ec == error::headerParse || ec == error::fileTooLarge || ec == error::contentDecode ||
+      ec == error::unexpectedResponse)
+    return Result::Protocol;
+
+  return Result::Network;
+}
+
+const char* Metrics::name(Result result) {
+  switch (result) {
+  case Result::Success:
+    return "success";
+  case Result::Timeout:
+    return "timeout";
+  case Result::Canceled:
+    return "canceled";
+  case Result::Network:
+    return "network";
+  case Result::Protocol:
+    return "protocol";
+  }
+
+  return "";
+}
+
+std::shared_ptr<Metrics::Host> Metrics::host(const std::string& name) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  auto& host = m_hosts[name];
+
+  if (!host)
+    host = std::make_shared<Host>(name);
+
+  return host;
+}
+
+std::vector<Metrics::Snapshot> Metrics::snapshot() const {
+  std::vector<std::shared_ptr<Host>> hosts;
+
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    for (const auto& host : m_hosts)
+      hosts.push_back(host.second);
+  }
+
+  std::vector<Snapshot> snapshots;
+
+  snapshots.reserve(hosts.size());
+
+  for (const auto& host : hosts)
+    snapshots.push_back(host->snapshot());
+
+  return snapshots;
+}
+
+void Metrics::expose(std::ostream& os) const {
+  const auto snapshots = snapshot();
+
+  auto labels = [this, &os](const Snapshot& snapshot) -> std::ostream& {
+    os << '{';
+
+    if (!m_labels.empty())
+      os << m_labels << ',';
+
+    os << "host=\"";
+    writeEscaped(os, snapshot.host);
+
+    return os << '"';
+  };
+
+  auto counter = [&](const char* name, const char* help, std::uint64_t Snapshot::*value) {
+    writeHeader(os, name, "counter", help);
+
+    for (const auto& snapshot : snapshots) {
+      os << name;
+      labels(snapshot) << "} " << snapshot.*value << '\n';
+    }
+  };
+
+  auto histogram = [&](const char* name, const char* help, Histogram::Snapshot Snapshot::*value) {
+    writeHeader(os, name, "histogram", help);
+
+    for (const auto& snapshot : snapshots) {
+      const auto& latencies = snapshot.*value;
+
+      // every other power of two from 16us to about 18 minutes; a power of two starts a bucket, the bound is
+      // the last value of the one before so that the count is exact
+      for (std::uint64_t edge = 16; edge <= (std::uint64_t{1} << 30); edge <<= 2) {
+        os << name << "_bucket";
+        labels(snapshot) << ",le=\"";
+        writeSeconds(os, edge - 1);
+        os << "\"} " << latencies.below(std::chrono::microseconds{edge - 1}) << '\n';
+      }
+
+      os << name << "_bucket";
+      labels(snapshot) << ",le=\"+Inf\"} " << latencies.count << '\n';
+
+      os << name << "_sum";
+      labels(snapshot) << "} ";
+      writeSeconds(os, latencies.sum.count());
+      os << '\n';
+
+      os << name << "_count";
+      labels(snapshot) << "} " << latencies.count << '\n';
+    }
+  };
+
+  counter("ashttp_requests_started_total", "Requests scheduled.", &Snapshot::started);
+
+  writeHeader(os, "ashttp_requests_completed_total", "counter", "Requests completed, by the class of their error.");
+
+  for (const auto& snapshot : snapshots) {
+    for (std::size_t i = 0; i < ResultCount; ++i) {
+      os << "ashttp_requests_completed_total";
+      labels(snapshot) << ",result=\"" << name(static_cast<Result>(i)) << "\"} " << snapshot.completed[i] << '\n';
+    }
+  }
+
+  writeHeader(os, "ashttp_requests_pending", "gauge", "Requests queued, in flight or waiting for a retry.");
+
+  for (const auto& snapshot : snapshots) {
+    os << "ashttp_requests_pending";
+    labels(snapshot) << "} " << snapshot.pending() << '\n';
+  }
+
+  counter("ashttp_sent_bytes_total", "Bytes of requests written.", &Snapshot::bytesSent);
+  counter("ashttp_received_bytes_total", "Bytes of responses read.", &Snapshot::bytesReceived);
+  counter("ashttp_connections_opened_total", "Connections made.", &Snapshot::connectionsOpened);
+  counter("ashttp_connections_reused_total", "Requests sent on a connection that was already open.",
+          &Snapshot::connectionsReused);
+  counter("ashttp_noop_timeouts_total", "Connections closed for being idle.", &Snapshot::noopTimeouts);
+  counter("ashttp_resolve_timeouts_total", "Host resolutions that timed out.", &Snapshot::resolveTimeouts);
+
+  histogram("ashttp_header_latency_seconds", "Time from sending a request to receiving its whole header.",
+            &Snapshot::headerLatency);
+  histogram("ashttp_body_latency_seconds", "Time from the header to the last byte of the body.",
+            &Snapshot::bodyLatency);
+}
+
+std::string Metrics::expose() const {
+  std::ostringstream os;
+
+  expose(os);
+
+  return os.str();
+}
+
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "type.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ashttp {
+
+/**
+ * @brief Histogram A latency histogram with buckets of bounded relative width.
+ *
+ * The latencies are counted in microseconds. Below 8us every value has a bucket of its own; above, every power
+ *of two is split into 8 buckets, so a value is known to within 12.5%, up to about 71 minutes. Larger values
+ *are counted in the last bucket.
+ *
+ * Recording is lock-free: every thread adds to one of a few shards, which snapshot() sums up.
+ */
+class Histogram {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t SubBuckets = 8;
+  static constexpr std::size_t Buckets = SubBuckets * 30;
+  static constexpr std::size_t Shards = 8;
+
+  struct Snapshot {
+    std::array<std::uint64_t, Buckets> counts;
+    std::uint64_t count;
+    std::chrono::microseconds sum;
+
+    /**
+     * @brief below
+     * @return The number of latencies of at most \p bound, exactly if \p bound + 1us is a power of two
+     *microseconds.
+     */
+    std::uint64_t below(std::chrono::microseconds bound) const;
+
+    /**
+     * @brief quantile
+     * @return The upper bound of the bucket the \p q quantile falls into, zero if empty.
+     */
+    std::chrono::microseconds quantile(double q) const;
+  };
+
+public:
+  Histogram();
+
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  void record(Clock::duration latency);
+
+  Snapshot snapshot() const;
+
+  /**
+   * @brief bucket
+   * @return The index of the bucket of \p us microseconds.
+   */
+  static std::size_t bucket(std::uint64_t us);
+
+  /**
+   * @brief upperBound
+   * @return The first value (in microseconds) above the bucket \p i.
+   */
+  static std::uint64_t upperBound(std::size_t i);
+
+  /**
+   * @brief shard
+   * @return The shard the calling thread records into.
+   */
+  static std::size_t shard();
+
+private:
+  struct Shard {
+    std::atomic<std::uint64_t> counts[Buckets];
+    std::atomic<std::uint64_t> sum;
+    char pad[64]; // the shards of different threads do not share a cache line
+  };
+
+  Shard m_shards[Shards];
+};
+
+/**
+ * @brief Metrics Counters and latency histograms of the requests of clients, per host.
+ *
+ * Every client records into a registry, Metrics::global() unless another one is set with
+ *ClientCRTPBase<p>::metrics(); a registry per client gives the metrics of each client apart. The requests are
+ *recorded with relaxed atomic adds into per-thread shards, without taking a lock; only host() and the
+ *snapshots lock.
+ *
+ * Thread-safe.
+ */
+class Metrics {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Result The classes of errors the completed requests are counted by.
+   */
+  enum class Result { Success, Timeout, Canceled, Network, Protocol };
+
+  static constexpr std::size_t ResultCount = 5;
+
+  struct Snapshot {
+    std::string host;
+    std::uint64_t started; // scheduled
+    std::array<std::uint64_t, ResultCount> completed;
+    std::uint64_t bytesSent;
+    std::uint64_t bytesReceived;
+    std::uint64_t connectionsOpened;
+    std::uint64_t connectionsReused; // requests sent on a connection that was already open
+    std::uint64_t noopTimeouts;
+    std::uint64_t resolveTimeouts;
+    Histogram::Snapshot headerLatency; // from the start of sending to the whole header
+    Histogram::Snapshot bodyLatency;   // from the header to the last byte of the body
+
+    /**
+     * @brief pending
+     * @return The requests scheduled and not completed: the sum of requestCount() of the clients of the host,
+     *with those waiting for a retry.
+     */
+    std::uint64_t pending() const;
+  };
+
+  /**
+   * @brief Host The metrics of the requests to one host.
+   */
+  class Host {
+  public:
+    explicit Host(std::string name);
+
+    Host(const Host&) = delete;
+    Host& operator=(const Host&) = delete;
+
+    const std::string& name() const { return m_name; }
+
+    void started() { add(Counter::Started); }
+    void completed(const ErrorCode& ec) { add(static_cast<Counter>(static_cast<std::size_t>(classify(ec)))); }
+    void sent(std::uint64_t bytes) { add(Counter::BytesSent, bytes); }
+    void received(std::uint64_t bytes) { add(Counter::BytesReceived, bytes); }
+    void connectionOpened() { add(Counter::ConnectionsOpened); }
+    void connectionReused() { add(Counter::ConnectionsReused); }
+    void noopTimeout() { add(Counter::NoopTimeouts); }
+    void resolveTimeout() { add(Counter::ResolveTimeouts); }
+
+    void headerLatency(Clock::duration latency) { m_headerLatency.record(latency); }
+    void bodyLatency(Clock::duration latency) { m_bodyLatency.record(latency); }
+
+    Snapshot snapshot() const;
+
+  private:
+    // the completions by result come first, in the order of Result
+    enum class Counter {
+      Started = ResultCount,
+      BytesSent,
+      BytesReceived,
+      ConnectionsOpened,
+      ConnectionsReused,
+      NoopTimeouts,
+      ResolveTimeouts,
+      Count
+    };
+
+    struct Shard {
+      std::atomic<std::uint64_t> counters[static_cast<std::size_t>(Counter::Count)];
+      char pad[64];
+    };
+
+    void add(Counter counter, std::uint64_t n = 1) {
+      m_shards[Histogram::shard()].counters[static_cast<std::size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t sum(Counter counter) const;
+
+  private:
+    const std::string m_name;
+
+    Shard m_shards[Histogram::Shards];
+    Histogram m_headerLatency;
+    Histogram m_bodyLatency;
+  };
+
+public:
+  /**
+   * @brief Metrics
+   * @param labels Added to every series of the exposition, e.g. client="search". Empty for none.
+   */
+  explicit Metrics(std::string labels = std::string{});
+
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+
+  /**
+   * @brief global
+   * @return The registry of the clients that are not given one.
+   */
+  static const std::shared_ptr<Metrics>& global();
+
+  /**
+   * @brief classify
+   * @return The class of the error a request completed with.
+   */
+  static Result classify(const ErrorCode& ec);
+
+  static const char* name(Result result);
+
+  /**
+   * @brief host
+   * @return The metrics of \p name, made on first use.
+   */
+  std::shared_ptr<Host> host(const std::string& name);
+
+  /**
+   * @brief snapshot
+   * @return The metrics of every host, ordered by name.
+   */
+  std::vector<Snapshot> snapshot() const;
+
+  /**
+   * @brief expose Writes the metrics in the Prometheus text exposition format (version 0.0.4).
+   */
+  void expose(std::ostream& os) const;
+
+  std::string expose() const;
+
+private:
+  const std::string m_labels;
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, std::shared_ptr<Host>> m_hosts;
+};
+
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "parser.hpp"
+
+#include "header.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+namespace ashttp {
+
+namespace {
+
+struct TokenTable {
+  TokenTable() {
+    for (unsigned c = 0; c < 256; ++c)
+      value[c] = std::isalnum(c) || (c != 0 && std::strchr("!#$%&'*+-.^_`|~", static_cast<char>(c)) != nullptr);
+  }
+
+  bool value[256];
+};
+
+bool isToken(char c) {
+  static const TokenTable tokenTable;
+
+  return tokenTable.value[static_cast<unsigned char>(c)];
+}
+
+bool isWhitespace(char c) {
+  return c == ' ' || c == '\t';
+}
+
+bool equalsLower(boost::string_view value, boost::string_view lowerKey) {
+  return value.size() == lowerKey.size() && scan::equalsLower(value.data(), lowerKey.data(), value.size());
+}
+
+/**
+ * @brief parseNumber Parses the decimal digits at the front of \p value and drops them from it.
+ * @return false if there are none or the number does not fit.
+ */
+bool parseNumber(boost::string_view& value, std::uint64_t& number) {
+  std::size_t i = 0;
+
+  number = 0;
+
+  for (; i < value.size() && value[i] >= '0' && value[i] <= '9'; ++i) {
+    const auto digit = static_cast<std::uint64_t>(value[i] - '0');
+
+    if (number > (std::numeric_limits<std::uint64_t>::max() - digit) / 10)
+      return false;
+
+    number = number * 10 + digit;
+  }
+
+  value.remove_prefix(i);
+
+  return i > 0;
+}
+
+}
+
+ResponseParser::ResponseParser() {
+  reset();
+}
+
+void ResponseParser::reset() {
+  m_state = State::StatusLine;
+  m_lineBegin = 0;
+  m_scanned = 0;
+  m_headerLength = 0;
+  m_framing = Framing::None;
+  m_contentLength = 0;
+  m_transferEncoding = false;
+  m_chunked = false;
+}
+
+ResponseParser::Result ResponseParser::parse(Header& header) {
+  while (m_state != State::Done) {
+    // taken again after an interim response is dropped from the front
+    const char* const data = header.m_data.data();
+    const auto size = header.size();
+    const auto lineEnd = scan::findByte(data + m_scanned, data + size, '\n');
+
+    if (lineEnd == data + size) {
+      m_scanned = size;
+
+      return Result::Incomplete;
+    }
+
+    // line is [m_lineBegin, end) without the line ending; a bare \n is tolerated
+    auto end = static_cast<std::size_t>(lineEnd - data);
+
+    m_scanned = end + 1;
+
+    if (end > m_lineBegin && data[end - 1] == '\r')
+      --end;
+
+    const auto result = m_state == State::StatusLine ? parseStatusLine(header, end) : parseField(header, end);
+
+    if (result != Result::Incomplete)
+      return result;
+
+    m_lineBegin = m_scanned;
+  }
+
+  return Result::Complete;
+}
+
+ResponseParser::Result ResponseParser::parseStatusLine(Header& header, std::size_t lineEnd) {
+  const char* const line = header.m_data.data() + m_lineBegin;
+  const auto length = lineEnd - m_lineBegin;
+
+  // HTTP/x.y SSS[ reason]
+  if (length < 12 || std::memcmp(line, "HTTP/", 5) != 0 || !std::isdigit(static_cast<unsigned char>(line[5])) ||
+      line[6] != '.' || !std::isdigit(static_cast<unsigned char>(line[7])) || line[8] != ' ')
+    return Result::Error;
+
+  unsigned status = 0;
+
+  for (std::size_t i = 9; i < 12; ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(line[i])))
+      return Result::Error;
+
+    status = status * 10 + (line[i] - '0');
+  }
+
+  if (length > 12 && line[12] != ' ')
+    return Result::Error;
+
+  header.m_status = status;
+  header.m_statusLineEnd = lineEnd;
+  header.m_fieldsBegin = m_scanned;
+  header.m_fieldsEnd = m_scanned;
+
+  m_state = State::Fields;
+
+  return Result::Incomplete;
+}
+
+ResponseParser::Result ResponseParser::parseField(Header& header, std::size_t lineEnd) {
+  if (lineEnd == m_lineBegin) // the empty line
+    return completeHeader(header);
+
+  const char* const data = header.m_data.data();
+
+  // name: OWS value OWS
+  const auto colon = static_cast<std::size_t>(scan::findByte(data + m_lineBegin, data + lineEnd, ':') - data);
+
+  if (colon == m_lineBegin || colon == lineEnd)
+    return Result::Error;
+
+  // also rejects obsolete line folding
+  for (auto i = m_lineBegin; i < colon; ++i) {
+    if (!isToken(data[i]))
+      return Result::Error;
+  }
+
+  const auto valueBegin = static_cast<std::size_t>(scan::skipWhitespace(data + colon + 1, data + lineEnd) - data);
+  auto valueEnd = lineEnd;
+
+  while (valueEnd > valueBegin && isWhitespace(data[valueEnd - 1]))
+    --valueEnd;
+
+  header.addField(m_lineBegin, colon, valueBegin, valueEnd);
+  header.m_fieldsEnd = m_scanned;
+
+  // the fields that decide the framing are handled by their tag, without looking up names
+  switch (header.m_fields.back().id) {
+  case FieldId::TransferEncoding: {
+    // chunked must be the final coding
+    const boost::string_view value{data + valueBegin, valueEnd - valueBegin};
+
+    m_transferEncoding = true;
+    m_chunked = value.size() >= 7 && equalsLower(value.substr(value.size() - 7), "chunked") &&
+                (value.size() == 7 || value[value.size() - 8] == ',' || isWhitespace(value[value.size() - 8]));
+    break;
+  }
+
+  case FieldId::ContentLength: {
+    std::uint64_t contentLength = 0;
+
+    if (valueBegin == valueEnd)
+      return Result::Error;
+
+    for (auto i = valueBegin; i < valueEnd; ++i) {
+      const auto c = data[i];
+
+      if (!std::isdigit(static_cast<unsigned char>(c)) ||
+          contentLength > (std::numeric_limits<std::uint64_t>::max() - 9) / 10)
+        return Result::Error;
+
+      contentLength = contentLength * 10 + (c - '0');
+    }
+
+    if (header.m_hasContentLength && contentLength != header.m_contentLength) // conflicting content-lengths
+      return Result::Error;
+
+    header.m_hasContentLength = true;
+    header.m_contentLength = contentLength;
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  return Result::Incomplete;
+}
+
+ResponseParser::Result ResponseParser::completeHeader(Header& header) {
+  m_state = State::Done;
+  m_headerLength = m_scanned;
+
+  const auto status = header.status();
+
+  if (status / 100 == 1 && status != 101) { // an interim response (100 Continue, 103 Early Hints), the final one follows
+    header.discard(m_headerLength);
+    reset();
+
+    return Result::Incomplete;
+  }
+
+  if (status == 101 || status == 204 || status == 304) { // these never have a body
+    m_framing = Framing::None;
+
+    return Result::Complete;
+  }
+
+  if (m_transferEncoding) // transfer-encoding overrides content-length
+    m_framing = m_chunked ? Framing::Chunked : Framing::UntilClose;
+  else if (header.m_hasContentLength)
+    m_framing = Framing::Length;
+  else
+    m_framing = Framing::UntilClose;
+
+  m_contentLength = header.m_contentLength;
+
+  return Result::Complete;
+}
+
+ResponseParser::Result ResponseParser::parseChunkSize(const char* begin, const char* end, std::uint64_t& chunkSize,
+                                                      std::size_t& lineLength) {
+  const auto lineEnd = scan::findByte(begin, end, '\n');
+
+  if (lineEnd == end)
+    return Result::Incomplete;
+
+  std::uint64_t size = 0;
+  auto it = begin;
+
+  for (; it != lineEnd; ++it) {
+    const auto c = static_cast<unsigned char>(*it);
+    unsigned digit;
+
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      break;
+
+    if (size > (std::numeric_limits<std::uint64_t>::max() >> 4))
+      return Result::Error;
+
+    size = (size << 4) | digit;
+  }
+
+  // at least one digit, then chunk extensions or the line end
+  if (it == begin || (*it != ';' && *it != '\r' && *it != '\n' && !isWhitespace(*it)))
+    return Result::Error;
+
+  chunkSize = size;
+  lineLength = lineEnd - begin + 1;
+
+  return Result::Complete;
+}
+
+ChunkDecoder::ChunkDecoder() {
+  reset();
+}
+
+void ChunkDecoder::reset() {
+  m_state = State::Size;
+}
+
+ChunkDecoder::Result ChunkDecoder::decode(const char* begin, const char* end, std::size_t& consumed,
+                                          std::uint64_t& chunkSize) {
+  consumed = 0;
+
+  for (;;) {
+    const auto data = begin + consumed;
+
+    switch (m_state) {
+    case State::Size: {
+      std::uint64_t size;
+      std::size_t lineLength;
+
+      const auto result = ResponseParser::parseChunkSize(data, end, size, lineLength);
+
+      if (result != ResponseParser::Result::Complete)
+        return result == ResponseParser::Result::Incomplete ? Result::Incomplete : Result::Error;
+
+      consumed += lineLength;
+
+      if (size == 0) { // the last chunk, the trailer follows
+        m_state = State::Trailer;
+        break;
+      }
+
+      m_state = State::DataEnd;
+      chunkSize = size;
+
+      return Result::Chunk;
+    }
+
+    case State::DataEnd:
+      // the data is followed by a line end
+      if (data != end && *data == '\n') {
+        consumed += 1;
+      } else if (end - data >= 2) {
+        if (data[0] != '\r' || data[1] != '\n')
+          return Result::Error;
+
+        consumed += 2;
+      } else {
+        return Result::Incomplete;
+      }
+
+      m_state = State::Size;
+      break;
+
+    case State::Trailer: {
+      const auto lineEnd = scan::findByte(data, end, '\n');
+
+      if (lineEnd == end)
+        return Result::Incomplete;
+
+      consumed += lineEnd - data + 1;
+
+      // trailer fields are skipped, the empty line ends the body
+      if (lineEnd == data || (lineEnd == data + 1 && *data == '\r')) {
+        m_state = State::Done;
+
+        return Result::Done;
+      }
+      break;
+    }
+
+    case State::Done:
+      return Result::Done;
+    }
+  }
+}
+
+boost::optional<ContentRange> parseContentRange(boost::string_view value) {
+  ContentRange range;
+
+  if (value.substr(0, 6) != "bytes ")
+    return boost::none;
+
+  value.remove_prefix(6);
+
+  if (!parseNumber(value, range.first) || value.empty() || value.front() != '-')
+    return boost::none;
+
+  value.remove_prefix(1);
+
+  if (!parseNumber(value, range.last) || value.empty() || value.front() != '/' || range.last < range.first)
+    return boost::none;
+
+  value.remove_prefix(1);
+
+  std::uint64_t size;
+
+  if (value == "*")
+    range.size = boost::none;
+  else if (parseNumber(value, size) && value.empty() && range.last < size)
+    range.size = size;
+  else
+    return boost::none;
+
+  return range;
+}
+
+boost::optional<std::uint64_t> parseUnsatisfiedRange(boost::string_view value) {
+  std::uint64_t size;
+
+  if (value.substr(0, 8) != "bytes */")
+    return boost::none;
+
+  value.remove_prefix(8);
+
+  if (!parseNumber(value, size) || !value.empty())
+    return boost::none;
+
+  return size;
+}
+
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ashttp {
+
+class Header;
+
+/**
+ * @brief ResponseParser Incremental HTTP/1.1 response header parser.
+ *
+ * The parser works in place on the storage of a Header while the bytes are received into it, and records
+ *the status line and the fields as offsets into it. Parsing is resumable; each call continues from where the
+ *previous one stopped, so no byte is looked at twice.
+ */
+class ResponseParser {
+public:
+  enum class Result {
+    Incomplete,
+    Complete,
+    Error
+  };
+
+  enum class Framing {
+    None,       // there is no body
+    Length,     // the body is content-length bytes
+    Chunked,    // transfer-encoding: chunked
+    UntilClose  // the body ends when the connection is closed
+  };
+
+public:
+  ResponseParser();
+
+  /**
+   * @brief reset Prepares the parser for a new response.
+   */
+  void reset();
+
+  /**
+   * @brief parse Parses the received bytes of \p header.
+   * @param header The header that is being received.
+   * @return Complete when the empty line is reached, Incomplete if more bytes are needed.
+   *
+   * There may be bytes beyond headerLength() in \p header after the header is complete; they belong to the
+   *body.
+   *
+   * Interim (1xx) responses other than 101 are dropped from the front of \p header, and the response after
+   *them is parsed.
+   */
+  Result parse(Header& header);
+
+  /**
+   * @brief headerLength
+   * @return The length of the header including the empty line. Valid after parse() completes.
+   */
+  std::size_t headerLength() const { return m_headerLength; }
+
+  /**
+   * @brief framing
+   * @return How the end of the body is determined. Valid after parse() completes.
+   */
+  Framing framing() const { return m_framing; }
+
+  /**
+   * @brief contentLength
+   * @return The length of the body if framing() is Framing::Length.
+   */
+  std::uint64_t contentLength() const { return m_contentLength; }
+
+  /**
+   * @brief parseChunkSize Parses a chunk size line (hex size, optional chunk extensions and the line end).
+   * @param begin
+   * @param end
+   * @param chunkSize Set to the size of the chunk on completion.
+   * @param lineLength Set to the length of the line including the line end on completion.
+   * @return Incomplete if the line end is not yet received.
+   */
+  static Result parseChunkSize(const char* begin, const char* end, std::uint64_t& chunkSize, std::size_t& lineLength);
+
+private:
+  enum class State {
+    StatusLine,
+    Fields,
+    Done
+  };
+
+  Result parseStatusLine(Header& header, std::size_t lineEnd);
+  Result parseField(Header& header, std::size_t lineEnd);
+  Result completeHeader(Header& header);
+
+private:
+  State m_state;
+  std::size_t m_lineBegin; // offset of the line being parsed
+  std::size_t m_scanned;   // bytes scanned for the line end
+
+  std::size_t m_headerLength;
+  Framing m_framing;
+  std::uint64_t m_contentLength;
+
+  bool m_transferEncoding;
+  bool m_chunked;
+};
+
+/**
+ * @brief ChunkDecoder Incremental decoder of the chunked transfer coding framing.
+ *
+ * The decoder looks only at the framing (chunk size lines, the line ends after the data and the trailer);
+ *the chunk data is left to the caller. One call walks over everything that is buffered, so a buffer holding
+ *many small chunks is decoded without going back to the connection.
+ */
+class ChunkDecoder {
+public:
+  enum class Result {
+    Incomplete, // more bytes are needed
+    Chunk,      // the data of a chunk follows the consumed bytes
+    Done,       // the last chunk and the trailer are consumed
+    Error
+  };
+
+public:
+  ChunkDecoder();
+
+  /**
+   * @brief reset Prepares the decoder for a new body.
+   */
+  void reset();
+
+  /**
+   * @brief decode Decodes the framing at the front of [begin, end).
+   * @param begin
+   * @param end
+   * @param consumed Set to the number of framing bytes at the front that must be dropped.
+   * @param chunkSize Set to the size of the chunk if Chunk is returned.
+   * @return Chunk when the size of the next chunk is known. Its data follows the consumed bytes and must be
+   *dropped by the caller before calling decode() again.
+   */
+  Result decode(const char* begin, const char* end, std::size_t& consumed, std::uint64_t& chunkSize);
+
+private:
+  enum class State {
+    Size,    // before a chunk size line
+    DataEnd, // before the line end after the chunk data
+    Trailer, // before a trailer field or the final empty line
+    Done
+  };
+
+private:
+  State m_state;
+};
+
+/**
+ * @brief ContentRange The byte range a 206 response carries.
+ */
+struct ContentRange {
+  std::uint64_t first;
+  std::uint64_t last;                  // inclusive
+  boost::optional<std::uint64_t> size; // of the whole resource, none if it is not known ("*")
+};
+
+/**
+ * @brief parseContentRange Parses "bytes first-last/size", where size may be "*".
+ */
+boost::optional<ContentRange> parseContentRange(boost::string_view value);
+
+/**
+ * @brief parseUnsatisfiedRange Parses the "bytes *\/size" of a 416 response.
+ * @return The size of the resource.
+ */
+boost::optional<std::uint64_t> parseUnsatisfiedRange(boost::string_view value);
+
+}
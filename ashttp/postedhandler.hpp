@@ -0,0 +1,104 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ashttp {
+
+/**
+ * @brief BoundHandler A completion handler with its arguments, keeping the associated allocator of the handler.
+ */
+template <class Handler, class... Args>
+class BoundHandler {
+public:
+  using allocator_type = typename boost::asio::associated_allocator<Handler>::type;
+
+public:
+  template <class... As>
+  explicit BoundHandler(Handler handler, As&&... args)
+      : m_handler{std::move(handler)}
+      , m_args{std::forward<As>(args)...} { }
+
+  allocator_type get_allocator() const noexcept { return boost::asio::get_associated_allocator(m_handler); }
+
+  void operator()() { call(std::index_sequence_for<Args...>{}); }
+
+private:
+  template <std::size_t... I>
+  void call(std::index_sequence<I...>) {
+    m_handler(std::move(std::get<I>(m_args))...);
+  }
+
+private:
+  Handler m_handler;
+  std::tuple<Args...> m_args;
+};
+
+/**
+ * @brief PostedHandler Completes an operation whose handler is type-erased on the executor of the handler.
+ *
+ * The associated executor is taken before the handler is erased, and kept busy until the handler is posted
+ *to it. It is never called inline, so it may be called with the locks of the operation held.
+ */
+template <class Handler, class Executor>
+class PostedHandler {
+public:
+  using executor_type = typename boost::asio::associated_executor<Handler, Executor>::type;
+
+public:
+  PostedHandler(Handler handler, const Executor& fallback)
+      : m_work{boost::asio::get_associated_executor(handler, fallback)}
+      , m_handler{std::move(handler)} { }
+
+  template <class... Args>
+  void operator()(Args&&... args) {
+    const auto executor = m_work.get_executor();
+
+    boost::asio::post(executor, BoundHandler<Handler, typename std::decay<Args>::type...>{
+                                    std::move(m_handler), std::forward<Args>(args)...});
+
+    m_work.reset(); // the posted handler keeps the executor busy now
+  }
+
+private:
+  boost::asio::executor_work_guard<executor_type> m_work;
+  Handler m_handler;
+};
+
+template <class Handler, class Executor>
+PostedHandler<typename std::decay<Handler>::type, Executor> makePostedHandler(Handler&& handler,
+                                                                              const Executor& fallback) {
+  return PostedHandler<typename std::decay<Handler>::type, Executor>{std::forward<Handler>(handler), fallback};
+}
+
+}
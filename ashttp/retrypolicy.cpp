@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "retrypolicy.hpp"
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/ssl/error.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace ashttp {
+
+RetryPolicy::RetryPolicy(Options options)
+    : m_options{std::move(options)}
+    , m_random{std::random_device{}()}
+    , m_budget{m_options.burst}
+    , m_requests{0}
+    , m_retries{0}
+    , m_throttled{0}
+    , m_exhausted{0} {
+  assert(m_options.maxAttempts > 0 && m_options.baseDelay <= m_options.maxDelay);
+}
+
+bool RetryPolicy::retryable(const ErrorCode& ec) const {
+  if (ec == error::timeout)
+    return m_options.timeouts;
+
+  if (!m_options.connectionErrors)
+    return false;
+
+  // refused, broken or lost before the response, nothing of it was received
+  return ec == boost::asio::error::connection_refused || ec == boost::asio::error::connection_reset ||
+         ec == boost::asio::error::connection_aborted || ec == boost::asio::error::broken_pipe ||
+         ec == boost::asio::error::eof || ec == boost::asio::error::timed_out ||
+         ec == boost::asio::error::host_unreachable || ec == boost::asio::error::network_unreachable ||
+         ec == boost::asio::error::host_not_found_try_again || ec == boost::asio::ssl::error::stream_truncated;
+}
+
+bool RetryPolicy::retryable(unsigned status) const {
+  return std::find(m_options.statuses.begin(), m_options.statuses.end(), status) != m_options.statuses.end();
+}
+
+RetryPolicy::Clock::duration RetryPolicy::delay(unsigned retries, boost::string_view retryAfter) {
+  auto bound = m_options.baseDelay;
+
+  for (unsigned i = 0; i < retries && bound < m_options.maxDelay; ++i)
+    bound *= 2;
+
+  bound = std::min(bound, m_options.maxDelay);
+
+  Clock::duration delay;
+
+  {
+    std::lock_guard<std::mutex> l{m_mutex};
+
+    delay = Clock::duration{std::uniform_int_distribution<Clock::rep>{0, bound.count()}(m_random)};
+  }
+
+  // only the delta-seconds form, a date is ignored
+  if (m_options.retryAfter && !retryAfter.empty() &&
+      std::all_of(retryAfter.begin(), retryAfter.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+    const auto maxSeconds = std::chrono::duration_cast<std::chrono::seconds>(m_options.maxDelay).count();
+    std::int64_t seconds = 0;
+
+    for (const auto c : retryAfter) {
+      if ((seconds = seconds * 10 + (c - '0')) > maxSeconds)
+        return Clock::duration::max();
+    }
+
+    delay = std::max<Clock::duration>(delay, std::chrono::seconds{seconds});
+  }
+
+  return delay;
+}
+
+void RetryPolicy::requested() {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  ++m_requests;
+  m_budget = std::min(m_budget + m_options.budgetRatio, m_options.burst);
+}
+
+bool RetryPolicy::tryRetry(unsigned retries) {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  if (retries + 1 >= m_options.maxAttempts) {
+    ++m_exhausted;
+
+    return false;
+  }
+
+  if (m_budget < 1) {
+    ++m_throttled;
+
+    return false;
+  }
+
+  m_budget -= 1;
+  ++m_retries;
+
+  return true;
+}
+
+RetryPolicy::Stats RetryPolicy::stats() const {
+  std::lock_guard<std::mutex> l{m_mutex};
+
+  return Stats{m_requests, m_retries, m_throttled, m_exhausted};
+}
+
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "type.hpp"
+
+#include <boost/utility/string_view.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace ashttp {
+
+/**
+ * @brief RetryPolicy Decides whether a failed request is sent again, and when.
+ *
+ * A request is retried if it failed with a transient error (the connection could not be made or broke, or it
+ *timed out) or was answered with one of the retryable statuses, before any of its response was given to the
+ *callbacks. The delay grows exponentially with the attempts and is picked at random below that bound ("full
+ *jitter"), so the retries of requests that failed together are spread out.
+ *
+ * Retries are capped by a budget: every request earns budgetRatio of a retry, and a retry is only made if a
+ *whole one is saved up. A host that is down therefore gets at most that many more requests, not maxAttempts
+ *times as many.
+ *
+ * Thread-safe; the budget is shared by the clients that share the policy.
+ */
+class RetryPolicy {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    Options() { }
+
+    unsigned maxAttempts = 3; // the first one included
+    Clock::duration baseDelay = std::chrono::milliseconds{100};
+    Clock::duration maxDelay = std::chrono::seconds{5};
+    double budgetRatio = 0.1; // retries per request
+    double burst = 10;        // retries that can be saved up
+    bool connectionErrors = true;
+    bool timeouts = true;
+    std::vector<unsigned> statuses{429, 502, 503, 504};
+    bool retryAfter = true; // wait at least as long as the Retry-After of a retried response asks
+  };
+
+  struct Stats {
+    std::uint64_t requests;
+    std::uint64_t retries;
+    std::uint64_t throttled; // retries not made for the budget
+    std::uint64_t exhausted; // failures after maxAttempts
+  };
+
+public:
+  explicit RetryPolicy(Options options = Options{});
+
+  RetryPolicy(const RetryPolicy&) = delete;
+  RetryPolicy& operator=(const RetryPolicy&) = delete;
+
+  /**
+   * @brief retryable
+   * @return true if a request that failed with \p ec may be retried.
+   */
+  bool retryable(const ErrorCode& ec) const;
+
+  /**
+   * @brief retryable
+   * @return true if a request answered with \p status may be retried.
+   */
+  bool retryable(unsigned status) const;
+
+  /**
+   * @brief delay
+   * @param retries The retries made before this one.
+   * @param retryAfter The Retry-After field of the response given up, empty if none.
+   * @return A random delay up to baseDelay * 2^retries and at most maxDelay, or the seconds \p retryAfter asks
+   *for if that is longer. Clock::duration::max() if they are over maxDelay.
+   */
+  Clock::duration delay(unsigned retries, boost::string_view retryAfter = boost::string_view{});
+
+  /**
+   * @brief requested Counts a request that may be retried, adding to the budget.
+   */
+  void requested();
+
+  /**
+   * @brief tryRetry Takes a retry from the budget.
+   * @param retries The retries made before this one.
+   * @return false if there were maxAttempts attempts or the budget is spent.
+   */
+  bool tryRetry(unsigned retries);
+
+  const Options& options() const { return m_options; }
+
+  Stats stats() const;
+
+private:
+  const Options m_options;
+
+  mutable std::mutex m_mutex;
+  std::minstd_rand m_random;
+  double m_budget;
+
+  std::uint64_t m_requests;
+  std::uint64_t m_retries;
+  std::uint64_t m_throttled;
+  std::uint64_t m_exhausted;
+};
+
+}
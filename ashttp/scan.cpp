@@ -0,0 +1,191 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scan.hpp"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ASHTTP_SCAN_X86 1
+#include <immintrin.h>
+
+// SSE2 is not part of the i386 baseline, its kernels are compiled for it and selected at runtime too
+#ifdef __i386__
+#define ASHTTP_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define ASHTTP_TARGET_SSE2
+#endif
+#endif
+
+namespace ashttp {
+namespace scan {
+
+namespace {
+
+struct Kernels {
+  const char* name;
+  const char* (*skipWhitespace)(const char*, const char*);
+  bool (*equalsLower)(const char*, const char*, std::size_t);
+};
+
+// scalar
+
+inline char toLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+const char* skipWhitespaceScalar(const char* begin, const char* end) {
+  while (begin != end && (*begin == ' ' || *begin == '\t'))
+    ++begin;
+
+  return begin;
+}
+
+bool equalsLowerScalar(const char* data, const char* lowerKey, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    if (toLower(data[i]) != lowerKey[i])
+      return false;
+  }
+
+  return true;
+}
+
+#ifdef ASHTTP_SCAN_X86
+
+// SSE2, 16 bytes at a time
+
+ASHTTP_TARGET_SSE2 const char* skipWhitespaceSse2(const char* begin, const char* end) {
+  const auto space = _mm_set1_epi8(' ');
+  const auto tab = _mm_set1_epi8('\t');
+
+  for (; end - begin >= 16; begin += 16) {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const auto whitespace = _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab));
+    const auto mask = ~_mm_movemask_epi8(whitespace) & 0xffff;
+
+    if (mask)
+      return begin + __builtin_ctz(mask);
+  }
+
+  return skipWhitespaceScalar(begin, end);
+}
+
+ASHTTP_TARGET_SSE2 inline __m128i toLowerSse2(__m128i block) {
+  // 'A'..'Z' are the bytes greater than 'A' - 1 and less than 'Z' + 1 (all ASCII, so signed compare is fine)
+  const auto upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)),
+                                   _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+
+  return _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+ASHTTP_TARGET_SSE2 bool equalsLowerSse2(const char* data, const char* lowerKey, std::size_t size) {
+  for (; size >= 16; data += 16, lowerKey += 16, size -= 16) {
+    const auto lhs = toLowerSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+    const auto rhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lowerKey));
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) != 0xffff)
+      return false;
+  }
+
+  return equalsLowerScalar(data, lowerKey, size);
+}
+
+// AVX2, 32 bytes at a time
+
+__attribute__((target("avx2"))) const char* skipWhitespaceAvx2(const char* begin, const char* end) {
+  const auto space = _mm256_set1_epi8(' ');
+  const auto tab = _mm256_set1_epi8('\t');
+
+  for (; end - begin >= 32; begin += 32) {
+    const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    const auto whitespace = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab));
+    const auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(whitespace));
+
+    if (mask)
+      return begin + __builtin_ctz(mask);
+  }
+
+  return skipWhitespaceSse2(begin, end);
+}
+
+__attribute__((target("avx2"))) bool equalsLowerAvx2(const char* data, const char* lowerKey, std::size_t size) {
+  for (; size >= 32; data += 32, lowerKey += 32, size -= 32) {
+    const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const auto upper = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), block));
+    const auto lhs = _mm256_or_si256(block, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    const auto rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lowerKey));
+
+    if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs))) != 0xffffffffu)
+      return false;
+  }
+
+  return equalsLowerSse2(data, lowerKey, size);
+}
+
+#endif
+
+Kernels selectKernels() {
+#ifdef ASHTTP_SCAN_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return Kernels{"avx2", &skipWhitespaceAvx2, &equalsLowerAvx2};
+
+  if (__builtin_cpu_supports("sse2"))
+    return Kernels{"sse2", &skipWhitespaceSse2, &equalsLowerSse2};
+#endif
+
+  return Kernels{"scalar", &skipWhitespaceScalar, &equalsLowerScalar};
+}
+
+// selected on first use so that it is ready for the static initializers of other translation units too
+const Kernels& kernels() {
+  static const Kernels selected = selectKernels();
+
+  return selected;
+}
+
+}
+
+const char* findByte(const char* begin, const char* end, char c) {
+  // the C library's memchr is vectorized already
+  const auto found = static_cast<const char*>(std::memchr(begin, c, end - begin));
+
+  return found ? found : end;
+}
+
+const char* skipWhitespace(const char* begin, const char* end) {
+  return kernels().skipWhitespace(begin, end);
+}
+
+bool equalsLower(const char* data, const char* lowerKey, std::size_t size) {
+  return kernels().equalsLower(data, lowerKey, size);
+}
+
+const char* kernelName() {
+  return kernels().name;
+}
+
+}
+}
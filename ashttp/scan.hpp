@@ -0,0 +1,65 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+namespace ashttp {
+namespace scan {
+
+/**
+ * These are the byte scanning kernels used by the header parser and lookups. Vectorized implementations
+ *(AVX2, SSE2) are selected at runtime by the CPU features, with a scalar fallback for the other targets;
+ *findByte() is memchr.
+ */
+
+/**
+ * @brief findByte Finds the first occurrence of \p c.
+ * @return Pointer to the found byte, \p end if not found.
+ */
+const char* findByte(const char* begin, const char* end, char c);
+
+/**
+ * @brief skipWhitespace Skips spaces and horizontal tabs.
+ * @return Pointer to the first byte that is not whitespace, \p end if none.
+ */
+const char* skipWhitespace(const char* begin, const char* end);
+
+/**
+ * @brief equalsLower Compares ASCII case-insensitively.
+ * @param data
+ * @param lowerKey An all-lowercase key.
+ * @param size Number of bytes to compare.
+ * @return true if \p data lowercased equals \p lowerKey.
+ */
+bool equalsLower(const char* data, const char* lowerKey, std::size_t size);
+
+/**
+ * @brief kernelName
+ * @return Name of the selected implementation, e.g. "avx2".
+ */
+const char* kernelName();
+
+}
+}
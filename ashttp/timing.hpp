@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <chrono>
+
+namespace ashttp {
+
+/**
+ * @brief Timing When each phase of a request happened.
+ *
+ * The times are taken from the monotonic clock, which is read without a system call. A phase that did not
+ *happen is left at the epoch: the resolve, connect and handshake times are only set for the request that a
+ *connection was made for, and the handshake only over HTTPS. For a retried request they are the times of its
+ *last attempt, except scheduled.
+ */
+struct Timing {
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point scheduled;    // given to the client
+  Clock::time_point resolveStart; // the host is resolved
+  Clock::time_point resolveEnd;
+  Clock::time_point connectStart; // to the address the connection was made to
+  Clock::time_point connectEnd;
+  Clock::time_point handshakeEnd; // TLS, started at connectEnd
+  Clock::time_point started;      // taken from the queue to be sent
+  Clock::time_point sent;         // the request is written
+  Clock::time_point firstByte;    // of the response
+  Clock::time_point header;       // the header is received
+  Clock::time_point end;          // completed, after the last byte of the body
+
+  /**
+   * @brief between
+   * @return The time from \p from to \p to, zero if either did not happen.
+   */
+  static Clock::duration between(Clock::time_point from, Clock::time_point to) {
+    return from == Clock::time_point{} || to == Clock::time_point{} ? Clock::duration::zero() : to - from;
+  }
+};
+
+}
@@ -38,6 +38,10 @@ const ErrorCode headerParse{
     boost::system::error_code{boost::asio::error::fault, boost::asio::error::get_misc_category()}};
 const ErrorCode timeout{
     boost::system::error_code{boost::asio::error::timed_out, boost::asio::error::get_misc_category()}};
+const ErrorCode contentDecode{
+    boost::system::error_code{boost::system::errc::illegal_byte_sequence, boost::asio::error::get_misc_category()}};
+const ErrorCode unexpectedResponse{
+    boost::system::error_code{boost::system::errc::protocol_error, boost::asio::error::get_misc_category()}};
 
 }
 
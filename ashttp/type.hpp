@@ -61,6 +61,8 @@ extern const ErrorCode canceled;
 extern const ErrorCode fileTooLarge;
 extern const ErrorCode headerParse;
 extern const ErrorCode timeout;
+extern const ErrorCode contentDecode;
+extern const ErrorCode unexpectedResponse;
 
 }
 
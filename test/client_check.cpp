@@ -0,0 +1,413 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * Checks the requests of a client against a server run by the check itself on 127.0.0.77, port 80 as the
+ *client always connects there. The responses are framed in every supported way and some are sent a few bytes
+ *at a time, so the request moves through all of its states.
+ *
+ * Build with the sources of the library and templog on the include path, e.g.:
+ *   g++ -std=c++14 -I. -I<templog> test/client_check.cpp $(find ashttp -name '*.cpp') -o client_check \
+ *     -lssl -lcrypto -lpthread -lz
+ *
+ * Needs to be allowed to listen on port 80; the check is skipped if it can not. Prints the failed checks and
+ *exits with 1 if there are any.
+ */
+
+#include "../ashttp/client/client.hpp"
+#include "../ashttp/client/request.hpp"
+#include "../ashttp/header.hpp"
+#include "../ashttp/type.hpp"
+
+#include <boost/asio/deadline_timer.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ashttp;
+using namespace ashttp::client;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+void check(bool ok, const char* condition, int line) {
+  if (!ok) {
+    std::cerr << "line " << line << ": " << condition << std::endl;
+    ++failures;
+  }
+}
+
+const char* const Address = "127.0.0.77";
+
+std::string pattern(std::size_t size) {
+  std::string data(size, '\0');
+
+  for (std::size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>(i % 251);
+
+  return data;
+}
+
+std::string items(std::size_t count) {
+  std::string data;
+
+  for (std::size_t i = 0; i < count; ++i)
+    data += "item" + std::to_string(i) + ",";
+
+  return data;
+}
+
+/**
+ * @brief Server Answers the requests of the check on its own threads, one per connection.
+ *
+ * The responses are picked by the path:
+ *   /len/<n>     n bytes with a content-length
+ *   /chunked/<n> n chunks with a trailer
+ *   /split/<n>   the same, written a few bytes at a time
+ *   /interim     a 200 after two interim responses
+ *   /bad         a status line that does not parse
+ */
+class Server {
+public:
+  ~Server() { stop(); }
+
+  bool start() {
+    sockaddr_in address;
+
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(80);
+    ::inet_pton(AF_INET, Address, &address.sin_addr);
+
+    const int on = 1;
+
+    m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    if (m_listener < 0 || ::setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+        ::bind(m_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(m_listener, 16) != 0) {
+      stop();
+
+      return false;
+    }
+
+    m_acceptor = std::thread{[this] { accept(); }};
+
+    return true;
+  }
+
+  void stop() {
+    if (m_listener < 0)
+      return;
+
+    ::shutdown(m_listener, SHUT_RDWR); // wakes up accept()
+
+    if (m_acceptor.joinable())
+      m_acceptor.join();
+
+    {
+      std::lock_guard<std::mutex> l{m_mutex};
+
+      for (const auto fd : m_connections)
+        ::shutdown(fd, SHUT_RDWR);
+    }
+
+    for (auto& thread : m_threads)
+      thread.join();
+
+    ::close(m_listener);
+    m_listener = -1;
+  }
+
+  std::size_t connections() const { return m_accepted; }
+
+private:
+  void accept() {
+    for (;;) {
+      const auto fd = ::accept(m_listener, nullptr, nullptr);
+
+      if (fd < 0)
+        return;
+
+      const int on = 1;
+
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+      std::lock_guard<std::mutex> l{m_mutex};
+
+      ++m_accepted;
+      m_connections.push_back(fd);
+      m_threads.emplace_back([this, fd] { serve(fd); });
+    }
+  }
+
+  void serve(int fd) {
+    std::string received;
+    char buffer[4096];
+
+    for (;;) {
+      const auto end = received.find("\r\n\r\n");
+
+      if (end == std::string::npos) {
+        const auto size = ::recv(fd, buffer, sizeof(buffer), 0);
+
+        if (size <= 0)
+          break;
+
+        received.append(buffer, static_cast<std::size_t>(size));
+        continue;
+      }
+
+      // "GET <path> HTTP/1.1"
+      const auto pathBegin = received.find(' ') + 1;
+      const auto path = received.substr(pathBegin, received.find(' ', pathBegin) - pathBegin);
+
+      received.erase(0, end + 4);
+
+      if (!respond(fd, path))
+        break;
+    }
+
+    ::close(fd);
+  }
+
+  bool respond(int fd, const std::string& path) {
+    const auto number = [&path] { return static_cast<std::size_t>(std::stoul(path.substr(path.rfind('/') + 1))); };
+
+    if (path.compare(0, 5, "/len/") == 0) {
+      const auto body = pattern(number());
+
+      return send(fd, "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+    }
+
+    if (path.compare(0, 9, "/chunked/") == 0 || path.compare(0, 7, "/split/") == 0) {
+      std::string response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+      char size[16];
+
+      for (std::size_t i = 0, count = number(); i < count; ++i) {
+        const auto item = items(i + 1).substr(items(i).size());
+
+        std::snprintf(size, sizeof(size), "%zx", item.size());
+        response.append(size).append(";ext=1\r\n").append(item).append("\r\n");
+      }
+
+      response += "0\r\nX-Trailer: 1\r\n\r\n";
+
+      if (path[1] == 'c')
+        return send(fd, response);
+
+      for (std::size_t offset = 0, piece = 1; offset < response.size(); offset += piece, piece = piece % 7 + 1) {
+        if (!send(fd, response.substr(offset, piece)))
+          return false;
+
+        std::this_thread::sleep_for(std::chrono::microseconds{200});
+      }
+
+      return true;
+    }
+
+    if (path == "/interim")
+      return send(fd, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 103 Early Hints\r\nLink: </a>\r\n\r\n"
+                      "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+
+    if (path == "/bad")
+      return send(fd, "HTTP/1.1 2x0 OK\r\nContent-Length: 0\r\n\r\n");
+
+    return send(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+  }
+
+  static bool send(int fd, const std::string& data) {
+    for (std::size_t sent = 0; sent < data.size();) {
+      const auto size = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+      if (size <= 0)
+        return false;
+
+      sent += static_cast<std::size_t>(size);
+    }
+
+    return true;
+  }
+
+private:
+  int m_listener = -1;
+  std::thread m_acceptor;
+  std::mutex m_mutex;
+  std::vector<int> m_connections;
+  std::vector<std::thread> m_threads;
+  std::atomic<std::size_t> m_accepted{0};
+};
+
+struct Result {
+  unsigned status = 0;
+  std::string body;
+  bool completed = false;
+  ErrorCode ec;
+};
+
+/**
+ * @brief Requests Runs requests of the check until all of them complete.
+ */
+class Requests {
+public:
+  Requests()
+      : m_timer{m_ioService} { }
+
+  std::shared_ptr<ClientHTTP> client() { return ClientHTTP::create(Address, m_ioService); }
+
+  std::shared_ptr<Result> get(const std::shared_ptr<ClientHTTP>& client, const std::string& path) {
+    auto result = std::make_shared<Result>();
+    const auto request = client->get(path);
+
+    request->onHeader([result](const ErrorCode& ec, const Header& header) {
+      if (!ec)
+        result->status = header.status();
+    });
+
+    request->onBodyChunk([result](const ErrorCode& ec, std::istream& is, std::size_t size) {
+      if (ec)
+        return;
+
+      const auto offset = result->body.size();
+
+      result->body.resize(offset + size);
+      is.read(&result->body[offset], static_cast<std::streamsize>(size));
+    });
+
+    request->onComplete([this, result](const ErrorCode& ec) {
+      result->ec = ec;
+      result->completed = true;
+
+      if (--m_pending == 0)
+        m_ioService.stop();
+    });
+
+    // the client holds its requests weakly
+    m_requests.push_back(request);
+    ++m_pending;
+    client->schedule(request);
+
+    return result;
+  }
+
+  void run() {
+    m_timer.expires_from_now(boost::posix_time::seconds{10});
+    m_timer.async_wait([this](const ErrorCode& ec) {
+      if (!ec) {
+        CHECK(!"the requests complete in time");
+        m_ioService.stop();
+      }
+    });
+
+    m_ioService.run();
+    m_timer.cancel();
+  }
+
+private:
+  asio::io_service m_ioService;
+  asio::deadline_timer m_timer;
+  std::vector<std::shared_ptr<Request<Protocol::HTTP>>> m_requests;
+  std::size_t m_pending = 0;
+};
+
+bool succeeded(const Result& result, const std::string& body) {
+  return result.completed && !result.ec && result.status == 200 && result.body == body;
+}
+
+void checkRequests(Server& server) {
+  Requests requests;
+  const auto client = requests.client();
+
+  // one after the other on a kept-alive connection
+  const auto length = requests.get(client, "/len/100000");
+  const auto chunked = requests.get(client, "/chunked/500");
+  const auto split = requests.get(client, "/split/50");
+  const auto interim = requests.get(client, "/interim");
+  const auto empty = requests.get(client, "/len/0");
+  const auto missing = requests.get(client, "/missing");
+  const auto last = requests.get(client, "/len/10");
+
+  // a failed request does not fail the ones queued after it, they are sent on a new connection
+  const auto failed = requests.get(client, "/bad");
+  const auto after = requests.get(client, "/len/20");
+
+  // an error fails the request
+  const auto other = requests.client();
+  const auto bad = requests.get(other, "/bad");
+
+  requests.run();
+
+  CHECK(succeeded(*length, pattern(100000)));
+  CHECK(succeeded(*chunked, items(500)));
+  CHECK(succeeded(*split, items(50)));
+  CHECK(succeeded(*interim, "ok"));
+  CHECK(succeeded(*empty, ""));
+  CHECK(missing->completed && !missing->ec && missing->status == 404);
+  CHECK(succeeded(*last, pattern(10)));
+  CHECK(bad->completed && bad->ec == error::headerParse);
+  CHECK(failed->completed && failed->ec == error::headerParse);
+  CHECK(succeeded(*after, pattern(20)));
+
+  CHECK(server.connections() == 3);
+}
+
+}
+
+int main() {
+  Server server;
+
+  if (!server.start()) {
+    std::cout << "skipped, can not listen on " << Address << ":80" << std::endl;
+
+    return 0;
+  }
+
+  checkRequests(server);
+
+  server.stop();
+
+  if (failures > 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+
+    return 1;
+  }
+
+  std::cout << "all checks passed" << std::endl;
+
+  return 0;
+}
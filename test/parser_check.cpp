@@ -0,0 +1,1324 @@
+/*
+ * Copyright © 2014-2015, Tolga HOŞGÖR.
+ *
+ * File created on: 18.10.2026
+*/
+
+/*
+  This file is part of libashttp.
+
+  libashttp is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  libashttp is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libashttp.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * Checks the parts that work without a connection. The inputs of the header parser and the chunk decoder are
+ *also given split at every position, the way they may arrive from the network.
+ *
+ * Build with the sources it uses, e.g.:
+ *   g++ -std=c++14 -I. test/parser_check.cpp ashttp/cache.cpp ashttp/concurrencylimiter.cpp \
+ *     ashttp/contentdecoder.cpp ashttp/diskcache.cpp ashttp/endpointbalancer.cpp ashttp/fieldid.cpp \
+ *     ashttp/filesink.cpp ashttp/header.cpp ashttp/hedgepolicy.cpp ashttp/memorybudget.cpp \
+ *     ashttp/metrics.cpp ashttp/parser.cpp ashttp/retrypolicy.cpp ashttp/scan.cpp ashttp/type.cpp \
+ *     -o parser_check -lz -lpthread -lssl -lcrypto
+ *
+ * Prints the failed checks and exits with 1 if there are any.
+ */
+
+#include "../ashttp/cache.hpp"
+#include "../ashttp/concurrencylimiter.hpp"
+#include "../ashttp/contentdecoder.hpp"
+#include "../ashttp/diskcache.hpp"
+#include "../ashttp/endpointbalancer.hpp"
+#include "../ashttp/filesink.hpp"
+#include "../ashttp/header.hpp"
+#include "../ashttp/hedgepolicy.hpp"
+#include "../ashttp/memorybudget.hpp"
+#include "../ashttp/metrics.hpp"
+#include "../ashttp/parser.hpp"
+#include "../ashttp/retrypolicy.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ashttp;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+void check(bool ok, const char* condition, int line) {
+  if (!ok) {
+    std::cerr << "line " << line << ": " << condition << std::endl;
+    ++failures;
+  }
+}
+
+// a new directory under /tmp for the files of a check
+std::string makeDirectory() {
+  char path[] = "/tmp/ashttp_check.XXXXXX";
+
+  if (!::mkdtemp(path)) {
+    CHECK(!"the directory is made");
+
+    return std::string{};
+  }
+
+  return path;
+}
+
+void removeDirectory(const std::string& path) {
+  if (const auto dir = ::opendir(path.c_str())) {
+    while (const auto entry = ::readdir(dir)) {
+      if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0)
+        ::unlink((path + "/" + entry->d_name).c_str());
+    }
+
+    ::closedir(dir);
+  }
+
+  ::rmdir(path.c_str());
+}
+
+std::string readFile(const std::string& path) {
+  std::ifstream file{path, std::ios::binary};
+
+  return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+// \p size bytes that differ with \p seed, so misplaced data is seen
+std::string pattern(std::size_t size, unsigned seed) {
+  std::string data(size, '\0');
+
+  for (std::size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>((i * 31 + seed) % 251);
+
+  return data;
+}
+
+std::uint64_t fileSize(const std::string& path) {
+  struct stat status;
+
+  return ::stat(path.c_str(), &status) == 0 ? static_cast<std::uint64_t>(status.st_size) : 0;
+}
+
+struct Parsed {
+  ResponseParser::Result result;
+  unsigned status;
+  ResponseParser::Framing framing;
+  std::uint64_t contentLength;
+  std::size_t headerLength; // of the final response
+  Header header;
+};
+
+// parses \p response given in two parts, split at \p split
+void parse(const std::string& response, std::size_t split, Parsed& parsed) {
+  ResponseParser parser;
+
+  parsed.header.append(boost::string_view{response}.substr(0, split));
+  parsed.result = parser.parse(parsed.header);
+
+  if (parsed.result == ResponseParser::Result::Incomplete) {
+    parsed.header.append(boost::string_view{response}.substr(split));
+    parsed.result = parser.parse(parsed.header);
+  } else {
+    parsed.header.append(boost::string_view{response}.substr(split));
+  }
+
+  parsed.status = parsed.header.status();
+  parsed.framing = parser.framing();
+  parsed.contentLength = parser.contentLength();
+  parsed.headerLength = parser.headerLength();
+}
+
+// checks that \p response parses the same at every split
+template <class Check>
+void forEachSplit(const std::string& response, Check check) {
+  for (std::size_t split = 0; split <= response.size(); ++split) {
+    Parsed parsed;
+
+    parse(response, split, parsed);
+    check(parsed);
+  }
+}
+
+void checkResponseParser() {
+  forEachSplit("HTTP/1.1 200 OK\r\nContent-Length: 5\r\nX-A:  spaced value \t\r\n\r\nhello", [](const Parsed& p) {
+    CHECK(p.result == ResponseParser::Result::Complete);
+    CHECK(p.status == 200 && p.headerLength == 60);
+    CHECK(p.framing == ResponseParser::Framing::Length && p.contentLength == 5);
+    CHECK(p.header.field("x-a") && *p.header.field("x-a") == "spaced value");
+    CHECK(p.header.field(FieldId::ContentLength) && *p.header.field(FieldId::ContentLength) == "5");
+  });
+
+  // bare line feeds
+  forEachSplit("HTTP/1.1 200 OK\nContent-Length: 0\n\n", [](const Parsed& p) {
+    CHECK(p.result == ResponseParser::Result::Complete);
+    CHECK(p.framing == ResponseParser::Framing::Length && p.contentLength == 0);
+  });
+
+  // a repeated content-length is fine if it is the same, not if it differs
+  forEachSplit("HTTP/1.1 200 OK\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\n", [](const Parsed& p) {
+    CHECK(p.result == ResponseParser::Result::Complete && p.contentLength == 3);
+  });
+  forEachSplit("HTTP/1.1 200 OK\r\nContent-Length: 3\r\nContent-Length: 4\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.result == ResponseParser::Result::Error); });
+  forEachSplit("HTTP/1.1 200 OK\r\nContent-Length: 3x\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.result == ResponseParser::Result::Error); });
+  forEachSplit("HTTP/1.1 200 OK\r\nContent-Length: 99999999999999999999\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.result == ResponseParser::Result::Error); });
+
+  // chunked must be the last transfer coding, and overrides content-length
+  forEachSplit("HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, chunked\r\nContent-Length: 10\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.framing == ResponseParser::Framing::Chunked); });
+  forEachSplit("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked, gzip\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.framing == ResponseParser::Framing::UntilClose); });
+  forEachSplit("HTTP/1.1 200 OK\r\nTransfer-Encoding: xchunked\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.framing == ResponseParser::Framing::UntilClose); });
+  forEachSplit("HTTP/1.1 200 OK\r\n\r\n", [](const Parsed& p) {
+    CHECK(p.result == ResponseParser::Result::Complete && p.framing == ResponseParser::Framing::UntilClose);
+  });
+
+  // responses without a body
+  forEachSplit("HTTP/1.1 204 No Content\r\nContent-Length: 7\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.framing == ResponseParser::Framing::None); });
+  forEachSplit("HTTP/1.1 304 Not Modified\r\nTransfer-Encoding: chunked\r\n\r\n",
+               [](const Parsed& p) { CHECK(p.framing == ResponseParser::Framing::None); });
+  forEachSplit("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n", [](const Parsed& p) {
+    CHECK(p.status == 101 && p.framing == ResponseParser::Framing::None);
+  });
+
+  // interim responses are skipped
+  forEachSplit("HTTP/1.1 103 Early Hints\r\nLink: </a.css>\r\n\r\nHTTP/1.1 100 Continue\r\n\r\n"
+               "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabc",
+               [](const Parsed& p) {
+                 CHECK(p.result == ResponseParser::Result::Complete && p.status == 200);
+                 CHECK(p.framing == ResponseParser::Framing::Length && p.contentLength == 3);
+                 CHECK(p.headerLength == std::string{"HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\n"}.size());
+                 CHECK(!p.header.field("link"));
+                 CHECK(p.header.fieldCount() == 1);
+               });
+
+  // malformed
+  for (const char* response : {"HTTP/1.1 20 OK\r\n\r\n", "HTTP/1.1 2000 OK\r\n\r\n", "HTTX/1.1 200 OK\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nNo colon\r\n\r\n", "HTTP/1.1 200 OK\r\n: no name\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nBad name: x\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nA: x\r\n folded\r\n\r\n"}) {
+    forEachSplit(response, [](const Parsed& p) { CHECK(p.result == ResponseParser::Result::Error); });
+  }
+}
+
+struct Decoded {
+  ChunkDecoder::Result result;
+  std::string body;
+  std::size_t left; // bytes after the body
+};
+
+// decodes \p encoded as the body receiver does, given in two parts split at \p split
+Decoded decode(const std::string& encoded, std::size_t split) {
+  ChunkDecoder decoder;
+  Decoded decoded{ChunkDecoder::Result::Incomplete, std::string{}, 0};
+  std::string buffer;
+  std::size_t received = 0;
+  std::uint64_t chunkLeft = 0;
+
+  for (const auto& part : {encoded.substr(0, split), encoded.substr(split)}) {
+    buffer += part;
+    received += part.size();
+
+    for (;;) {
+      if (chunkLeft > 0) { // the data of the current chunk
+        const auto size = static_cast<std::size_t>(std::min<std::uint64_t>(chunkLeft, buffer.size()));
+
+        decoded.body.append(buffer, 0, size);
+        buffer.erase(0, size);
+        chunkLeft -= size;
+
+        if (chunkLeft > 0)
+          break;
+      }
+
+      std::size_t consumed;
+      std::uint64_t chunkSize;
+
+      decoded.result = decoder.decode(buffer.data(), buffer.data() + buffer.size(), consumed, chunkSize);
+      buffer.erase(0, consumed);
+
+      if (decoded.result == ChunkDecoder::Result::Chunk)
+        chunkLeft = chunkSize;
+      else
+        break;
+    }
+
+    if (decoded.result == ChunkDecoder::Result::Done || decoded.result == ChunkDecoder::Result::Error)
+      break;
+  }
+
+  decoded.left = buffer.size() + (encoded.size() - received);
+
+  return decoded;
+}
+
+template <class Check>
+void forEachSplitDecoded(const std::string& encoded, Check check) {
+  for (std::size_t split = 0; split <= encoded.size(); ++split)
+    check(decode(encoded, split));
+}
+
+void checkChunkDecoder() {
+  forEachSplitDecoded("5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n", [](const Decoded& d) {
+    CHECK(d.result == ChunkDecoder::Result::Done && d.body == "hello world" && d.left == 0);
+  });
+
+  // extensions, upper case hex, bare line feeds and trailers; what follows the body is left
+  forEachSplitDecoded("A;name=value;x\r\n0123456789\n1 \r\n!\r\n0\r\nTrailer: a\r\nOther: b\n\r\nHTTP", [](const Decoded& d) {
+    CHECK(d.result == ChunkDecoder::Result::Done && d.body == "0123456789!" && d.left == 4);
+  });
+
+  // a chunk size split over many reads
+  forEachSplitDecoded("00000010\r\n0123456789abcdef\r\n0\r\n\r\n", [](const Decoded& d) {
+    CHECK(d.result == ChunkDecoder::Result::Done && d.body == "0123456789abcdef");
+  });
+
+  forEachSplitDecoded("5\r\nhello\r\n", [](const Decoded& d) {
+    CHECK(d.result == ChunkDecoder::Result::Incomplete && d.body == "hello");
+  });
+
+  // malformed
+  for (const char* encoded : {"x\r\n", "\r\n", "5\r\nhelloXX0\r\n\r\n", "5x\r\nhello\r\n0\r\n\r\n",
+                              "10000000000000000\r\n"}) {
+    forEachSplitDecoded(encoded, [](const Decoded& d) { CHECK(d.result == ChunkDecoder::Result::Error); });
+  }
+}
+
+// gives \p data to \p sink in pieces of at most \p piece bytes, the way they are received
+void sinkWrite(FileSink& sink, const std::string& data, std::size_t piece) {
+  for (std::size_t offset = 0; offset < data.size();) {
+    const auto buffer = sink.buffer();
+    const auto size = std::min({piece, data.size() - offset, buffer.size()});
+
+    std::memcpy(buffer.data(), data.data() + offset, size);
+    CHECK(!sink.commit(size));
+    offset += size;
+  }
+
+  CHECK(!sink.flush());
+}
+
+void checkFileSink() {
+  const auto directory = makeDirectory();
+  const auto path = directory + "/body";
+  ErrorCode ec;
+
+  FileSink::Options options;
+
+  options.bufferSize = 4096;
+
+  {
+    const auto data = pattern(10000, 1);
+    const auto sink = FileSink::open(path, ec, 0, options);
+
+    CHECK(sink && !ec);
+
+    if (sink) {
+      // the space is reserved without changing the size of the file
+      CHECK(!sink->preallocate(data.size()));
+      CHECK(readFile(path).empty());
+
+      sinkWrite(*sink, data, 1000);
+      CHECK(sink->size() == data.size());
+    }
+
+    CHECK(readFile(path) == data);
+  }
+
+  {
+    // two sinks write the halves of one file, the second one does not truncate it
+    const auto data = pattern(9000, 2);
+    const auto first = FileSink::open(path, ec, 0, options);
+
+    options.truncate = false;
+
+    const auto second = FileSink::open(path, ec, 4500, options);
+
+    options.truncate = true;
+
+    CHECK(first && second);
+
+    if (first && second) {
+      sinkWrite(*second, data.substr(4500), 777);
+      sinkWrite(*first, data.substr(0, 4500), 4096);
+      CHECK(first->size() == 4500 && second->size() == 4500);
+    }
+
+    CHECK(readFile(path) == data);
+  }
+
+  {
+    // the aligned part is written with O_DIRECT and the tail without
+    const auto data = pattern(3 * 4096 + 100, 3);
+
+    options.direct = true;
+
+    const auto sink = FileSink::open(path, ec, 0, options);
+
+    // not every file system supports O_DIRECT
+    if (sink || ec != boost::system::errc::invalid_argument) {
+      CHECK(sink != nullptr);
+
+      if (sink) {
+        CHECK(sink->options().direct && !sink->canSplice());
+        sinkWrite(*sink, data, 5000);
+      }
+
+      CHECK(readFile(path) == data);
+    }
+
+    // not at an aligned offset
+    const auto unaligned = FileSink::open(path, ec, 100, options);
+
+    CHECK(unaligned && !unaligned->options().direct);
+
+    options.direct = false;
+  }
+
+  CHECK(!FileSink::open(directory + "/missing/body", ec) && ec);
+
+  removeDirectory(directory);
+}
+
+void checkMemoryBudget() {
+  const auto parent = std::make_shared<MemoryBudget>(100, nullptr);
+  MemoryBudget first{60, parent};
+  MemoryBudget second{MemoryBudget::Unlimited, parent};
+  bool firstWoken = false;
+  bool secondWoken = false;
+
+  CHECK(first.fits(60) && !first.fits(61) && second.fits(100) && !second.fits(101));
+
+  CHECK(first.tryReserve(50, [] { }));
+  CHECK(first.stats().used == 50 && parent->stats().used == 50);
+
+  // full in the first budget
+  CHECK(!first.tryReserve(20, [&firstWoken] { firstWoken = true; }));
+  CHECK(first.stats().waiting == 1 && first.stats().pressure == 1 && parent->stats().used == 50);
+
+  // full in the parent, what the second budget reserved is given back
+  CHECK(!second.tryReserve(60, [&secondWoken] { secondWoken = true; }));
+  CHECK(second.stats().used == 0 && parent->stats().waiting == 1 && parent->stats().pressure == 1);
+
+  CHECK(second.tryReserve(50, [] { }));
+  CHECK(parent->stats().used == 100 && parent->stats().peak == 100);
+
+  first.release(50);
+  CHECK(firstWoken && secondWoken);
+  CHECK(first.stats().used == 0 && first.stats().waiting == 0 && parent->stats().used == 50);
+
+  second.release(50);
+  CHECK(parent->stats().used == 0 && parent->stats().peak == 100 && parent->stats().reservations == 2);
+
+  // raising the limit wakes the waiters up
+  bool woken = false;
+
+  first.limit(10);
+  CHECK(!first.tryReserve(20, [&woken] { woken = true; }));
+  first.limit(20);
+  CHECK(woken && first.tryReserve(20, [] { }));
+  first.release(20);
+}
+
+// \p data compressed by zlib with \p windowBits, see deflateInit2()
+std::string compress(const std::string& data, int windowBits) {
+  z_stream stream;
+
+  std::memset(&stream, 0, sizeof(stream));
+
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return std::string{};
+
+  std::string compressed(deflateBound(&stream, data.size()), '\0');
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+  stream.avail_out = static_cast<uInt>(compressed.size());
+
+  deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return compressed;
+}
+
+struct Inflated {
+  std::string body;
+  ContentDecoder::Result result;
+  std::size_t consumed;
+};
+
+// decodes \p encoded given in pieces of \p inStep bytes into an output buffer of \p outStep bytes
+Inflated inflate(ContentDecoder& decoder, ContentDecoder::Coding coding, const std::string& encoded, std::size_t inStep,
+                 std::size_t outStep) {
+  Inflated inflated{std::string{}, ContentDecoder::Result::Ok, 0};
+  std::vector<char> buffer(outStep);
+  const auto begin = encoded.data();
+  const char* in = begin;
+
+  decoder.reset(coding);
+
+  for (;;) {
+    const auto inEnd = begin + std::min(encoded.size(), static_cast<std::size_t>(in - begin) + inStep);
+    const auto previous = in;
+    auto out = buffer.data();
+
+    inflated.result = decoder.decode(in, inEnd, out, buffer.data() + buffer.size());
+    inflated.body.append(buffer.data(), out);
+
+    if (inflated.result == ContentDecoder::Result::Error)
+      break;
+
+    // another gzip member may start in the next piece
+    if (inflated.result == ContentDecoder::Result::End) {
+      if (in != inEnd || inEnd == begin + encoded.size())
+        break;
+
+      continue;
+    }
+
+    // the decoder wants more input than there is
+    if (in == previous && out == buffer.data() && inEnd == begin + encoded.size())
+      break;
+  }
+
+  inflated.consumed = static_cast<std::size_t>(in - begin);
+
+  return inflated;
+}
+
+void checkContentDecoder() {
+  using Coding = ContentDecoder::Coding;
+  using Result = ContentDecoder::Result;
+
+  CHECK(ContentDecoder::coding("") == Coding::Identity);
+  CHECK(ContentDecoder::coding("identity") == Coding::Identity);
+  CHECK(ContentDecoder::coding("GZip") == Coding::Gzip);
+  CHECK(ContentDecoder::coding("x-gzip") == Coding::Gzip);
+  CHECK(ContentDecoder::coding("deflate") == Coding::Deflate);
+  CHECK(ContentDecoder::coding("compress") == Coding::Unsupported);
+  CHECK(ContentDecoder::coding("gzip, deflate") == Coding::Unsupported);
+
+  std::string plain;
+
+  for (int i = 0; i < 2000; ++i)
+    plain += "{\"id\":" + std::to_string(i) + ",\"name\":\"item\"},";
+
+  const auto half = plain.size() / 2;
+  const auto gzip = compress(plain, 15 + 16);
+  const auto zlib = compress(plain, 15);
+  const auto raw = compress(plain, -15);
+  const auto members = compress(plain.substr(0, half), 15 + 16) + compress(plain.substr(half), 15 + 16);
+
+  struct Case {
+    Coding coding;
+    const std::string& encoded;
+  };
+
+  // one decoder for all, as a connection keeps it
+  ContentDecoder decoder;
+
+  for (const auto& c : {Case{Coding::Gzip, gzip}, Case{Coding::Deflate, zlib}, Case{Coding::Deflate, raw},
+                        Case{Coding::Gzip, members}, Case{Coding::Gzip, zlib}}) {
+    for (std::size_t inStep : {std::size_t{1}, std::size_t{7}, std::size_t{1000}, c.encoded.size()}) {
+      for (std::size_t outStep : {std::size_t{1}, std::size_t{100}, std::size_t{65536}}) {
+        const auto inflated = inflate(decoder, c.coding, c.encoded, inStep, outStep);
+
+        CHECK(inflated.result == Result::End && inflated.body == plain && inflated.consumed == c.encoded.size());
+        CHECK(decoder.finished());
+      }
+    }
+  }
+
+  // what follows the stream is not consumed
+  auto inflated = inflate(decoder, Coding::Gzip, gzip + "trailing", 100, 4096);
+  CHECK(inflated.result == Result::End && inflated.body == plain && inflated.consumed == gzip.size());
+
+  inflated = inflate(decoder, Coding::Deflate, raw + "trailing", 100, 4096);
+  CHECK(inflated.result == Result::End && inflated.body == plain && inflated.consumed == raw.size());
+
+  // truncated
+  inflated = inflate(decoder, Coding::Gzip, gzip.substr(0, gzip.size() / 2), 100, 4096);
+  CHECK(inflated.result == Result::Ok && !decoder.finished() && plain.compare(0, inflated.body.size(), inflated.body) == 0);
+
+  // corrupted
+  auto corrupted = gzip;
+  corrupted[gzip.size() / 2] ^= 0x55;
+  corrupted[gzip.size() / 2 + 1] ^= 0x55;
+  CHECK(inflate(decoder, Coding::Gzip, corrupted, 100, 4096).result == Result::Error);
+  CHECK(inflate(decoder, Coding::Gzip, "not compressed", 100, 4096).result == Result::Error);
+
+  inflated = inflate(decoder, Coding::Identity, plain, 1000, 333);
+  CHECK(inflated.body == plain && decoder.finished());
+}
+
+// the entry the cache makes for \p response, nullptr if it is not stored
+std::shared_ptr<Cache::Entry> entryFor(const std::string& response) {
+  Header header;
+  ResponseParser parser;
+
+  header.append(response);
+
+  if (parser.parse(header) != ResponseParser::Result::Complete) {
+    CHECK(!"the response parses");
+
+    return nullptr;
+  }
+
+  return Cache::entryFor(header);
+}
+
+void checkCache() {
+  using std::chrono::seconds;
+
+  CHECK(Cache::parseDate("Sun, 06 Nov 1994 08:49:37 GMT") == std::time_t{784111777});
+  CHECK(Cache::parseDate("Thu, 01 Jan 1970 00:00:00 GMT") == std::time_t{0});
+  CHECK(Cache::parseDate("Sat, 31 Dec 2033 23:59:60 GMT") == std::time_t{2019686400});
+
+  for (const char* date : {"", "Sun, 06 Nov 1994 08:49:37", "Sun, 06 Nov 1994 08:49:37 UTC",
+                           "Sunday, 06-Nov-94 08:49:37 GMT", "Sun Nov  6 08:49:37 1994", "Sun, 06 Nox 1994 08:49:37 GMT",
+                           "Sun, 06 ovD 1994 08:49:37 GMT", "Sun, 00 Nov 1994 08:49:37 GMT", "Sun, 32 Nov 1994 08:49:37 GMT",
+                           "Sun, 06 Nov 1994 24:49:37 GMT", "Sun, 06 Nov 1994 08:60:37 GMT", "Sun, 06 Nov 1994 08:49:61 GMT",
+                           "Sun, 0x Nov 1994 08:49:37 GMT", "Sun, 06 Nov 1899 08:49:37 GMT", "Sun, 06 Nov 1994 08-49-37 GMT",
+                           "Sun, 06 Nov 1994 08:49:37 GMT "}) {
+    CHECK(!Cache::parseDate(date));
+  }
+
+  auto entry = entryFor("HTTP/1.1 200 OK\r\nCache-Control: public, max-age=60\r\nAge: 10\r\n\r\n");
+  CHECK(entry && entry->lifetime == seconds{60} && entry->initialAge == seconds{10});
+
+  // max-age is preferred to expires, and may be quoted
+  entry = entryFor("HTTP/1.1 200 OK\r\nCache-Control: MAX-AGE=\"5\"\r\n"
+                   "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\nExpires: Sun, 06 Nov 1994 09:49:37 GMT\r\n\r\n");
+  CHECK(entry && entry->lifetime == seconds{5});
+
+  entry = entryFor("HTTP/1.1 200 OK\r\nDate: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+                   "Expires: Sun, 06 Nov 1994 09:49:37 GMT\r\n\r\n");
+  CHECK(entry && entry->lifetime == seconds{3600});
+
+  // a large max-age is taken as the largest
+  entry = entryFor("HTTP/1.1 200 OK\r\nCache-Control: max-age=99999999999999999999999\r\n\r\n");
+  CHECK(entry && entry->lifetime == seconds{std::numeric_limits<std::int32_t>::max()});
+
+  // stored to be revalidated every time
+  for (const char* response : {"HTTP/1.1 200 OK\r\nCache-Control: no-cache, max-age=60\r\nETag: \"a\"\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nPragma: no-cache\r\nLast-Modified: Sun, 06 Nov 1994 08:49:37 GMT\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nCache-Control: max-age=x\r\nETag: \"a\"\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nExpires: 0\r\nETag: \"a\"\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nDate: Sun, 06 Nov 1994 09:49:37 GMT\r\n"
+                               "Expires: Sun, 06 Nov 1994 08:49:37 GMT\r\nETag: \"a\"\r\n\r\n"}) {
+    entry = entryFor(response);
+    CHECK(entry && entry->lifetime == seconds{0} && entry->revalidatable());
+  }
+
+  // not stored
+  for (const char* response : {"HTTP/1.1 200 OK\r\nCache-Control: max-age=60, no-store\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nCache-Control: no-cache, max-age=60\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nExpires: 0\r\n\r\n", "HTTP/1.1 200 OK\r\n\r\n",
+                               "HTTP/1.1 206 Partial Content\r\nCache-Control: max-age=60\r\n\r\n",
+                               "HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nVary: *\r\n\r\n"}) {
+    CHECK(!entryFor(response));
+  }
+}
+
+void checkCacheStore() {
+  using std::chrono::seconds;
+
+  const std::string body(400, 'b');
+  Cache cache{1000};
+  std::shared_ptr<const Cache::Entry> found;
+
+  CHECK(cache.find("a", true, found) == Cache::Lookup::Miss && !found);
+
+  const auto fresh = [&body](const char* response) {
+    auto entry = entryFor(response);
+
+    if (entry) {
+      entry->body = body;
+      entry->storedAt = Cache::Clock::now();
+    }
+
+    return entry;
+  };
+
+  const auto a = fresh("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\n\r\n");
+  const auto b = fresh("HTTP/1.1 200 OK\r\nETag: \"b1\"\r\n\r\n");
+
+  if (!a || !b)
+    return;
+
+  cache.store("a", a);
+  cache.store("b", b);
+  CHECK(cache.find("a", true, found) == Cache::Lookup::Fresh && found == a);
+  CHECK(cache.find("b", true, found) == Cache::Lookup::Stale && found == b);
+
+  // a 304 gives the stale entry a new lifetime and validator, the body is kept
+  Header notModified;
+  ResponseParser parser;
+
+  notModified.append(std::string{"HTTP/1.1 304 Not Modified\r\nCache-Control: max-age=30\r\nETag: \"b2\"\r\n\r\n"});
+  CHECK(parser.parse(notModified) == ResponseParser::Result::Complete);
+
+  const auto refreshed = cache.revalidated("b", found, notModified);
+  CHECK(refreshed->lifetime == seconds{30} && refreshed->etag == "\"b2\"" && refreshed->body.data() == body.data());
+  CHECK(cache.find("b", true, found) == Cache::Lookup::Fresh && found == refreshed);
+
+  // the least recently used entry is evicted
+  CHECK(cache.find("a", true, found) == Cache::Lookup::Fresh);
+  cache.store("c", fresh("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\n\r\n"));
+  CHECK(cache.find("b", true, found) == Cache::Lookup::Miss);
+  CHECK(cache.find("a", true, found) == Cache::Lookup::Fresh);
+  CHECK(cache.find("c", true, found) == Cache::Lookup::Fresh);
+
+  auto stats = cache.stats();
+  CHECK(stats.hits == 5 && stats.misses == 2 && stats.stale == 1 && stats.notModified == 1 && stats.stores == 4);
+  CHECK(stats.evictions == 1 && stats.entries == 2 && stats.size <= cache.capacity());
+  // a compressed body is a miss for a request that can not take it
+  const auto encoded = fresh("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nContent-Encoding: gzip\r\n\r\n");
+  CHECK(encoded && encoded->encoded);
+  cache.store("a", encoded);
+  CHECK(cache.find("a", false, found) == Cache::Lookup::Miss && !found);
+  CHECK(cache.find("a", true, found) == Cache::Lookup::Fresh && found == encoded);
+
+  stats = cache.stats();
+  CHECK(stats.hits == 6 && stats.misses == 3);
+  cache.erase("a");
+  CHECK(cache.find("a", true, found) == Cache::Lookup::Miss);
+  cache.clear();
+  CHECK(cache.stats().entries == 0 && cache.stats().size == 0);
+}
+
+// waits until \p disk has written \p stores entries
+void waitStores(const DiskCache& disk, std::uint64_t stores) {
+  for (int i = 0; i < 10000 && disk.stats().stores < stores; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+  CHECK(disk.stats().stores >= stores);
+}
+
+void checkDiskCache() {
+  const auto directory = makeDirectory();
+  const auto index = directory + "/index";
+  const auto body = pattern(1000, 4);
+  auto entry = entryFor("HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nETag: \"d\"\r\nContent-Encoding: gzip\r\n\r\n");
+  ErrorCode ec;
+
+  if (!entry)
+    return;
+
+  entry->body = body;
+  entry->storedAt = Cache::Clock::now();
+
+  DiskCache::Options options;
+
+  options.segmentSize = 64 * 1024;
+  options.capacity = 4 * options.segmentSize;
+
+  {
+    const auto disk = DiskCache::open(directory, ec, options);
+
+    CHECK(disk && !ec);
+
+    if (!disk) {
+      removeDirectory(directory);
+
+      return;
+    }
+
+    disk->store("a", entry);
+    disk->store("b", entry);
+
+    // found whether it is written yet or not
+    const auto found = disk->find("a");
+    CHECK(found && found->body == body);
+
+    disk->erase("b");
+    CHECK(!disk->find("b") && !disk->find("c"));
+  } // the queued writes are done before the cache is destroyed
+
+  std::uint64_t record = 0;
+
+  {
+    // reopened
+    const auto disk = DiskCache::open(directory, ec, options);
+
+    CHECK(disk && disk->stats().entries == 1);
+
+    if (!disk) {
+      removeDirectory(directory);
+
+      return;
+    }
+
+    // the index is compacted on open, to one record
+    record = fileSize(index);
+
+    const auto found = disk->find("a");
+    CHECK(found && found->body == body && found->bodyOwner && found->header == entry->header);
+    CHECK(found && found->etag == "\"d\"" && found->encoded && found->lifetime == std::chrono::seconds{60});
+    CHECK(found && found->fresh(Cache::Clock::now()));
+    CHECK(!disk->find("b"));
+
+    // served by a cache from the disk tier
+    Cache cache{0};
+    std::shared_ptr<const Cache::Entry> cached;
+
+    cache.disk(disk);
+    CHECK(cache.find("a", true, cached) == Cache::Lookup::Fresh && cached && cached->body == body);
+
+    // the index is compacted while it is written too
+    for (std::uint64_t i = 1; i <= 100; ++i) {
+      disk->store("k", entry);
+      waitStores(*disk, i);
+    }
+
+    CHECK(record > 0 && fileSize(index) < 70 * record);
+  }
+
+  {
+    const auto disk = DiskCache::open(directory, ec, options);
+
+    CHECK(disk && disk->stats().entries == 2 && fileSize(index) == 2 * record);
+  }
+
+  removeDirectory(directory);
+
+  // the oldest segments are evicted with their entries
+  const auto small = makeDirectory();
+
+  options.segmentSize = 4096;
+  options.capacity = 2 * options.segmentSize;
+
+  if (const auto disk = DiskCache::open(small, ec, options)) {
+    for (int i = 0; i < 12; ++i) {
+      disk->store("e" + std::to_string(i), entry);
+      waitStores(*disk, i + 1);
+    }
+
+    const auto stats = disk->stats();
+    CHECK(stats.evictions > 0 && stats.size <= options.capacity);
+    CHECK(!disk->find("e0") && disk->find("e11"));
+
+    std::size_t segments = 0;
+
+    if (const auto dir = ::opendir(small.c_str())) {
+      while (const auto file = ::readdir(dir))
+        segments += std::strncmp(file->d_name, "segment-", 8) == 0;
+
+      ::closedir(dir);
+    }
+
+    CHECK(segments == stats.segments);
+  } else {
+    CHECK(!"the disk cache is opened");
+  }
+
+  removeDirectory(small);
+}
+
+void checkContentRange() {
+  auto range = parseContentRange("bytes 0-99/1000");
+  CHECK(range && range->first == 0 && range->last == 99 && range->size == std::uint64_t{1000});
+
+  range = parseContentRange("bytes 100-100/*");
+  CHECK(range && range->first == 100 && range->last == 100 && !range->size);
+
+  range = parseContentRange("bytes 0-18446744073709551614/18446744073709551615");
+  CHECK(range && range->last == 18446744073709551614u && range->size == 18446744073709551615u);
+
+  for (const char* value : {"", "bytes", "bytes ", "bytes 0-99", "bytes 0-99/", "bytes -99/1000", "bytes 0-/1000",
+                            "bytes 99-0/1000", "bytes 0-99/99", "bytes 0-99/1000x", "bytes 0-99/ 1000",
+                            "bytes  0-99/1000", "Bytes 0-99/1000", "items 0-99/1000", "bytes */1000",
+                            "bytes 0-99/18446744073709551616", "bytes 0-18446744073709551616/*"}) {
+    CHECK(!parseContentRange(value));
+  }
+
+  CHECK(parseUnsatisfiedRange("bytes */1000") == std::uint64_t{1000});
+  CHECK(parseUnsatisfiedRange("bytes */0") == std::uint64_t{0});
+
+  for (const char* value : {"", "bytes */", "bytes */*", "bytes */10x", "bytes 0-99/1000", "bytes */99999999999999999999"})
+    CHECK(!parseUnsatisfiedRange(value));
+}
+
+void checkConcurrencyLimiter() {
+  using Clock = ConcurrencyLimiter::Clock;
+  using Outcome = ConcurrencyLimiter::Outcome;
+  using std::chrono::milliseconds;
+
+  ConcurrencyLimiter::Options options;
+
+  options.initialLimit = 2;
+  options.maxLimit = 4;
+
+  {
+    ConcurrencyLimiter limiter{options};
+
+    CHECK(limiter.tryAcquire([] { return true; }) && limiter.tryAcquire([] { return true; }));
+
+    // grows by one over about a limit of successes while the limit is used, up to maxLimit
+    for (int i = 0; i < 3; ++i) {
+      limiter.release(Clock::now(), Outcome::Success, milliseconds{10});
+      CHECK(limiter.tryAcquire([] { return true; }));
+    }
+
+    CHECK(limiter.stats().limit == 3 && limiter.stats().minLatency == milliseconds{10});
+
+    for (int i = 0; i < 100; ++i) {
+      limiter.release(Clock::now(), Outcome::Success, milliseconds{10});
+      CHECK(limiter.tryAcquire([] { return true; }));
+    }
+
+    CHECK(limiter.stats().limit == 4);
+
+    // a latency above the tolerance cuts it
+    limiter.release(Clock::now(), Outcome::Success, milliseconds{25});
+    CHECK(limiter.stats().limit == 3 && limiter.stats().drops == 1);
+  }
+
+  {
+    ConcurrencyLimiter limiter{options};
+    const auto startedAt = Clock::now();
+
+    CHECK(limiter.tryAcquire([] { return true; }) && limiter.tryAcquire([] { return true; }));
+
+    // the requests of one overload cut the limit once
+    limiter.release(startedAt, Outcome::Dropped);
+    limiter.release(startedAt, Outcome::Dropped);
+    CHECK(limiter.stats().drops == 1 && limiter.stats().limit == 1);
+
+    // a request started after the cut cuts it again
+    CHECK(limiter.tryAcquire([] { return true; }));
+    limiter.release(Clock::now(), Outcome::Dropped);
+    CHECK(limiter.stats().drops == 2 && limiter.stats().inFlight == 0);
+  }
+
+  {
+    options.initialLimit = 1;
+
+    ConcurrencyLimiter limiter{options};
+    int woken = 0;
+    bool acquired = false;
+
+    CHECK(limiter.tryAcquire([] { return true; }));
+
+    // the waiter is called once a slot is free, and takes it
+    CHECK(!limiter.tryAcquire([&limiter, &woken, &acquired] {
+      ++woken;
+      acquired = limiter.tryAcquire([] { return true; });
+
+      return true;
+    }));
+    CHECK(limiter.stats().waiting == 1 && limiter.stats().rejected == 1);
+
+    limiter.release(Clock::now(), Outcome::Ignored);
+    CHECK(woken == 1 && acquired && limiter.stats().inFlight == 1 && limiter.stats().waiting == 0);
+
+    // the wakeup of a waiter that is gone goes to the next one
+    bool next = false;
+
+    CHECK(!limiter.tryAcquire([] { return false; }));
+    CHECK(!limiter.tryAcquire([&limiter, &next] { return next = limiter.tryAcquire([] { return true; }); }));
+
+    limiter.release(Clock::now(), Outcome::Ignored);
+    CHECK(next && limiter.stats().inFlight == 1 && limiter.stats().waiting == 0);
+  }
+}
+
+void checkEndpointBalancer() {
+  using Endpoint = EndpointBalancer::Endpoint;
+  using Outcome = EndpointBalancer::Outcome;
+  using Policy = EndpointBalancer::Policy;
+
+  const auto address = [](int i) { return Endpoint{boost::asio::ip::address_v4{static_cast<unsigned>(0x7f000000 + i)}, 80}; };
+  const std::vector<Endpoint> endpoints{address(1), address(2), address(3), address(4)};
+
+  EndpointBalancer::Options options;
+
+  options.policy = Policy::RoundRobin;
+
+  {
+    EndpointBalancer balancer{options};
+    std::vector<Endpoint> firsts;
+
+    balancer.update(endpoints);
+
+    // every one is first in turn, and the others follow
+    for (std::size_t i = 0; i < endpoints.size(); ++i) {
+      auto candidates = balancer.candidates();
+
+      firsts.push_back(candidates.front());
+      std::sort(candidates.begin(), candidates.end());
+      CHECK(candidates == endpoints);
+    }
+
+    std::sort(firsts.begin(), firsts.end());
+    CHECK(firsts == endpoints);
+  }
+
+  for (const auto policy : {Policy::LeastOutstanding, Policy::PowerOfTwoChoices}) {
+    options.policy = policy;
+
+    EndpointBalancer balancer{options};
+
+    // the idle one is picked; the power of two choices compares two different ones
+    balancer.update({address(1), address(2)});
+    balancer.started(address(1));
+
+    for (int i = 0; i < 20; ++i)
+      CHECK(balancer.candidates().front() == address(2));
+
+    balancer.finished(address(1), Outcome::Success);
+    CHECK(balancer.stats()[0].outstanding == 0 && balancer.stats()[0].requests == 1);
+  }
+
+  {
+    options.policy = Policy::RoundRobin;
+    options.ejectAfter = 3;
+    options.maxEjectedRatio = 0.5;
+
+    EndpointBalancer balancer{options};
+
+    balancer.update(endpoints);
+
+    // a success in between resets the failures in a row
+    balancer.failed(address(1));
+    balancer.failed(address(1));
+    balancer.started(address(1));
+    balancer.finished(address(1), Outcome::Success);
+    balancer.failed(address(1));
+    balancer.failed(address(1));
+    CHECK(!balancer.stats()[0].ejected);
+
+    // ejected after ejectAfter failures in a row, and listed last
+    balancer.started(address(1));
+    balancer.finished(address(1), Outcome::Failure);
+    CHECK(balancer.stats()[0].ejected && balancer.stats()[0].ejections == 1 && balancer.stats()[0].failures == 5);
+
+    for (int i = 0; i < 8; ++i)
+      CHECK(balancer.candidates().back() == address(1));
+
+    for (int i = 0; i < 3; ++i)
+      balancer.failed(address(2));
+
+    // no more than maxEjectedRatio of them, the ejected in the order they come back
+    for (int i = 0; i < 3; ++i)
+      balancer.failed(address(3));
+
+    const auto stats = balancer.stats();
+    CHECK(stats[1].ejected && !stats[2].ejected && !stats[3].ejected);
+
+    const auto candidates = balancer.candidates();
+    CHECK(candidates.size() == 4 && candidates[2] == address(1) && candidates[3] == address(2));
+
+    // the ejected ones are kept across updates
+    balancer.update({address(2), address(5)});
+    CHECK(balancer.stats()[0].ejected && balancer.candidates().back() == address(2));
+  }
+
+  {
+    // never all of them
+    options.maxEjectedRatio = 1;
+
+    EndpointBalancer balancer{options};
+
+    balancer.update({address(1)});
+
+    for (int i = 0; i < 10; ++i)
+      balancer.failed(address(1));
+
+    CHECK(!balancer.stats()[0].ejected && balancer.candidates() == std::vector<Endpoint>{address(1)});
+  }
+}
+
+void checkHedgePolicy() {
+  using std::chrono::milliseconds;
+
+  {
+    HedgePolicy::Options options;
+
+    options.minSamples = 10;
+
+    HedgePolicy policy{options};
+
+    // the fixed delay until there are enough latencies
+    for (int i = 1; i < 10; ++i)
+      policy.answered(milliseconds{i}, false);
+
+    CHECK(policy.delay() == options.delay);
+
+    for (int i = 10; i <= 20; ++i)
+      policy.answered(milliseconds{i}, i == 20);
+
+    // the 95th percentile of 1..20 ms
+    CHECK(policy.delay() == milliseconds{19});
+    CHECK(policy.stats().wins == 1 && policy.stats().delay == milliseconds{19});
+  }
+
+  {
+    HedgePolicy::Options options;
+
+    options.minSamples = 5;
+    options.window = 5;
+    options.minDelay = milliseconds{2};
+
+    HedgePolicy policy{options};
+
+    // only the last window of latencies count
+    for (int i = 0; i < 5; ++i)
+      policy.answered(milliseconds{100}, false);
+
+    CHECK(policy.delay() == milliseconds{100});
+
+    for (int i = 0; i < 5; ++i)
+      policy.answered(milliseconds{1}, false);
+
+    CHECK(policy.delay() == milliseconds{2});
+  }
+
+  {
+    HedgePolicy::Options options;
+
+    options.maxExtra = 0.25;
+    options.burst = 2;
+
+    HedgePolicy policy{options};
+
+    // one hedge to start with, then a quarter of one per request
+    CHECK(policy.tryHedge() && !policy.tryHedge());
+
+    for (int i = 0; i < 4; ++i)
+      policy.requested();
+
+    CHECK(policy.tryHedge() && !policy.tryHedge());
+
+    // no more than burst saved up
+    for (int i = 0; i < 100; ++i)
+      policy.requested();
+
+    CHECK(policy.tryHedge() && policy.tryHedge() && !policy.tryHedge());
+
+    const auto stats = policy.stats();
+    CHECK(stats.requests == 104 && stats.hedges == 4 && stats.throttled == 3);
+  }
+}
+
+void checkRetryPolicy() {
+  using std::chrono::milliseconds;
+  using std::chrono::seconds;
+
+  {
+    RetryPolicy policy;
+
+    CHECK(policy.retryable(error::timeout) && policy.retryable(ErrorCode{boost::asio::error::connection_reset}));
+    CHECK(policy.retryable(ErrorCode{boost::asio::error::eof}) && policy.retryable(ErrorCode{boost::asio::error::connection_refused}));
+    CHECK(!policy.retryable(error::canceled) && !policy.retryable(error::headerParse));
+    CHECK(!policy.retryable(error::fileTooLarge) && !policy.retryable(ErrorCode{}));
+
+    for (unsigned status : {429u, 502u, 503u, 504u})
+      CHECK(policy.retryable(status));
+
+    for (unsigned status : {200u, 404u, 500u, 501u})
+      CHECK(!policy.retryable(status));
+  }
+
+  {
+    RetryPolicy::Options options;
+
+    options.connectionErrors = false;
+    options.timeouts = false;
+    options.statuses = {500};
+
+    RetryPolicy policy{options};
+
+    CHECK(!policy.retryable(error::timeout) && !policy.retryable(ErrorCode{boost::asio::error::connection_reset}));
+    CHECK(policy.retryable(500u) && !policy.retryable(503u));
+  }
+
+  {
+    RetryPolicy::Options options;
+
+    options.baseDelay = milliseconds{100};
+    options.maxDelay = seconds{2};
+
+    RetryPolicy policy{options};
+
+    // up to baseDelay * 2^retries, at most maxDelay
+    for (unsigned retries = 0; retries < 10; ++retries) {
+      const auto bound = std::min<RetryPolicy::Clock::duration>(milliseconds{100} * (1 << retries), seconds{2});
+
+      for (int i = 0; i < 100; ++i) {
+        const auto delay = policy.delay(retries);
+
+        CHECK(delay >= RetryPolicy::Clock::duration::zero() && delay <= bound);
+      }
+    }
+
+    CHECK(policy.delay(1000) <= seconds{2});
+
+    // a longer Retry-After is waited for, one over maxDelay gives up; a date is ignored
+    CHECK(policy.delay(0, "1") >= seconds{1} && policy.delay(0, "1") <= seconds{1});
+    CHECK(policy.delay(0, "2") == seconds{2});
+    CHECK(policy.delay(0, "3") == RetryPolicy::Clock::duration::max());
+    CHECK(policy.delay(0, "99999999999999999999") == RetryPolicy::Clock::duration::max());
+    CHECK(policy.delay(0, "Sun, 06 Nov 1994 08:49:37 GMT") <= milliseconds{100});
+  }
+
+  {
+    RetryPolicy::Options options;
+
+    options.maxAttempts = 3;
+    options.budgetRatio = 0.5;
+    options.burst = 2;
+
+    RetryPolicy policy{options};
+
+    // two retries after the first attempt
+    CHECK(policy.tryRetry(0) && !policy.tryRetry(2));
+    CHECK(policy.stats().retries == 1 && policy.stats().exhausted == 1);
+
+    // the budget starts full; half a retry per request
+    CHECK(policy.tryRetry(1) && !policy.tryRetry(0));
+    CHECK(policy.stats().throttled == 1);
+
+    policy.requested();
+    CHECK(!policy.tryRetry(0));
+    policy.requested();
+    CHECK(policy.tryRetry(0));
+
+    for (int i = 0; i < 100; ++i)
+      policy.requested();
+
+    CHECK(policy.tryRetry(0) && policy.tryRetry(0) && !policy.tryRetry(0));
+
+    const auto stats = policy.stats();
+    CHECK(stats.requests == 102 && stats.retries == 5 && stats.throttled == 3 && stats.exhausted == 1);
+  }
+}
+
+void checkHistogram() {
+  // every value falls in the bucket whose bounds hold it, within 12.5%
+  for (std::uint64_t us = 0; us < (std::uint64_t{1} << 20); ++us) {
+    const auto i = Histogram::bucket(us);
+    const auto lower = i == 0 ? 0 : Histogram::upperBound(i - 1);
+
+    if (us < lower || us >= Histogram::upperBound(i) || (us >= 8 && Histogram::upperBound(i) - lower > lower / 8)) {
+      CHECK(!"the bucket holds the value");
+      break;
+    }
+  }
+
+  for (std::size_t i = 1; i < Histogram::Buckets; ++i) {
+    CHECK(Histogram::upperBound(i) > Histogram::upperBound(i - 1));
+    CHECK(Histogram::bucket(Histogram::upperBound(i - 1)) == i);
+  }
+
+  CHECK(Histogram::bucket(Histogram::upperBound(Histogram::Buckets - 1)) == Histogram::Buckets - 1);
+  CHECK(Histogram::bucket(std::numeric_limits<std::uint64_t>::max()) == Histogram::Buckets - 1);
+
+  // below() counts the latencies of at most the bound
+  Histogram::Snapshot snapshot;
+
+  snapshot.counts.fill(0);
+  snapshot.count = 0;
+
+  for (const std::uint64_t us : {3, 7, 8, 15, 16, 17, 1000}) {
+    ++snapshot.counts[Histogram::bucket(us)];
+    ++snapshot.count;
+  }
+
+  using std::chrono::microseconds;
+
+  CHECK(snapshot.below(microseconds{0}) == 0);
+  CHECK(snapshot.below(microseconds{3}) == 1);
+  CHECK(snapshot.below(microseconds{7}) == 2);
+  CHECK(snapshot.below(microseconds{15}) == 4);
+  CHECK(snapshot.below(microseconds{1023}) == 7);
+  CHECK(snapshot.below(microseconds{std::numeric_limits<std::int64_t>::max()}) == 7);
+}
+
+void checkExposition() {
+  using std::chrono::microseconds;
+
+  Metrics metrics;
+  const auto host = metrics.host("example.com");
+
+  host->headerLatency(microseconds{15});
+  host->headerLatency(microseconds{16});
+
+  // a bound is the last value of its bucket, so the counts are exact
+  const auto text = metrics.expose();
+
+  CHECK(text.find("le=\"0.000015\"} 1\n") != std::string::npos);
+  CHECK(text.find("le=\"0.000063\"} 2\n") != std::string::npos);
+  CHECK(text.find("le=\"0.000016\"") == std::string::npos);
+}
+
+}
+
+int main() {
+  checkResponseParser();
+  checkChunkDecoder();
+  checkFileSink();
+  checkMemoryBudget();
+  checkContentDecoder();
+  checkCache();
+  checkCacheStore();
+  checkDiskCache();
+  checkContentRange();
+  checkConcurrencyLimiter();
+  checkEndpointBalancer();
+  checkHedgePolicy();
+  checkRetryPolicy();
+  checkHistogram();
+  checkExposition();
+
+  if (failures > 0) {
+    std::cerr << failures << " checks failed" << std::endl;
+
+    return 1;
+  }
+
+  std::cout << "all checks passed" << std::endl;
+
+  return 0;
+}